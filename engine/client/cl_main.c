@@ -1499,6 +1499,7 @@ void CL_Disconnect( void )
 	// send a disconnect message to the server
 	CL_SendDisconnectMessage();
 	CL_ClearState ();
+	FS_PrefetchFlush();
 
 	S_StopBackgroundTrack ();
 	SCR_EndLoadingPlaque (); // get rid of loading plaque
@@ -2662,6 +2663,19 @@ qboolean CL_PrecacheResources( void )
 {
 	resource_t	*pRes;
 
+	// read the whole list in background while world is loading,
+	// models are already loaded by the local server
+	for( pRes = cl.resourcesonhand.pNext; pRes && pRes != &cl.resourcesonhand; pRes = pRes->pNext )
+	{
+		if( FBitSet( pRes->ucFlags, RES_PRECACHED|RES_WASMISSING ))
+			continue;
+
+		if( pRes->type == t_sound && pRes->szFileName[0] != '!' && pRes->szFileName[0] != '*' )
+			FS_Prefetch( va( DEFAULT_SOUNDPATH "%s", pRes->szFileName ));
+		else if( pRes->type == t_model && pRes->szFileName[0] != '*' && pRes->nIndex != WORLD_INDEX && !SV_Active( ))
+			FS_Prefetch( pRes->szFileName );
+	}
+
 	// NOTE: world need to be loaded as first model
 	for( pRes = cl.resourcesonhand.pNext; pRes && pRes != &cl.resourcesonhand; pRes = pRes->pNext )
 	{
@@ -2796,6 +2810,10 @@ qboolean CL_PrecacheResources( void )
 	if( cls.state != ca_active )
 		S_EndRegistration();
 
+	// everything that was going to be loaded is loaded now,
+	// don't let the rest hold the prefetch budget
+	FS_PrefetchFlush();
+
 	return true;
 }
 
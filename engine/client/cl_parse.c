@@ -916,7 +916,8 @@ void CL_ParseServerData( sizebuf_t *msg, qboolean legacy )
 	}
 
 	Q_snprintf( mapfile, sizeof( mapfile ), "maps/%s.bsp", clgame.mapname );
-	if( CRC32_MapFile( &mapCRC, mapfile, cl.maxclients > 1 ))
+	// digest cache is writable by user, never trust it on client
+	if( CRC32_MapFile( &mapCRC, mapfile, cl.maxclients > 1, false ))
 	{
 		// validate map checksum
 		if( mapCRC != cl.checksum )
@@ -18,21 +18,23 @@ GNU General Public License for more details.
 #include "server.h"
 #include "base_cmd.h"
 
-#define MAX_CMD_BUFFER	32768
+#define MAX_CMD_BUFFER	32768	// initial size, grows when needed
+#define MAX_CMD_BUFFER_LIMIT	( 4 * 1024 * 1024 )
 #define MAX_CMD_LINE	2048
 #define MAX_ALIAS_NAME	32
 
+// unexecuted text is kept between start and cursize, executed commands only
+// move the start and inserted text goes into the space before it
 typedef struct
 {
 	byte		*data;
+	int		start;
 	int		cursize;
 	int		maxsize;
 } cmdbuf_t;
 
 int			cmd_wait;
 cmdbuf_t			cmd_text, filteredcmd_text;
-byte			cmd_text_buf[MAX_CMD_BUFFER];
-byte			filteredcmd_text_buf[MAX_CMD_BUFFER];
 cmdalias_t		*cmd_alias;
 uint			cmd_condition;
 int			cmd_condlevel;
@@ -55,10 +57,14 @@ Cbuf_Init
 */
 void Cbuf_Init( void )
 {
-	cmd_text.data = cmd_text_buf;
-	filteredcmd_text.data = filteredcmd_text_buf;
+	if( !cmd_text.data )
+		cmd_text.data = Z_Malloc( MAX_CMD_BUFFER );
+
+	if( !filteredcmd_text.data )
+		filteredcmd_text.data = Z_Malloc( MAX_CMD_BUFFER );
 
 	filteredcmd_text.maxsize = cmd_text.maxsize = MAX_CMD_BUFFER;
+	filteredcmd_text.start = cmd_text.start = 0;
 	filteredcmd_text.cursize = cmd_text.cursize = 0;
 }
 
@@ -71,9 +77,53 @@ void Cbuf_Clear( void )
 {
 	memset( cmd_text.data, 0, cmd_text.maxsize );
 	memset( filteredcmd_text.data, 0, filteredcmd_text.maxsize );
+	cmd_text.start = filteredcmd_text.start = 0;
 	cmd_text.cursize = filteredcmd_text.cursize = 0;
 }
 
+/*
+============
+Cbuf_Relocate
+
+move unexecuted text to the offset and make sure there is
+room for extra bytes after it, growing the buffer if needed
+============
+*/
+static qboolean Cbuf_Relocate( cmdbuf_t *buf, int offset, int extra )
+{
+	int	len = buf->cursize - buf->start;
+	int	size = offset + len + extra;
+
+	if( size > MAX_CMD_BUFFER_LIMIT )
+		return false;
+
+	if( size > buf->maxsize )
+	{
+		int	maxsize = buf->maxsize;
+		byte	*data;
+
+		while( maxsize < size )
+			maxsize *= 2;
+		maxsize = Q_min( maxsize, MAX_CMD_BUFFER_LIMIT );
+
+		data = Z_Malloc( maxsize );
+		memcpy( data + offset, buf->data + buf->start, len );
+		Mem_Free( buf->data );
+
+		buf->data = data;
+		buf->maxsize = maxsize;
+	}
+	else if( offset != buf->start )
+	{
+		memmove( buf->data + offset, buf->data + buf->start, len );
+	}
+
+	buf->start = offset;
+	buf->cursize = offset + len;
+
+	return true;
+}
+
 /*
 ============
 Cbuf_GetSpace
@@ -83,9 +133,9 @@ void *Cbuf_GetSpace( cmdbuf_t *buf, int length )
 {
 	void    *data;
 
-	if(( buf->cursize + length ) > buf->maxsize )
+	if(( buf->cursize + length ) > buf->maxsize && !Cbuf_Relocate( buf, 0, length ))
 	{
-		buf->cursize = 0;
+		buf->start = buf->cursize = 0;
 		Host_Error( "Cbuf_GetSpace: overflow\n" );
 	}
 
@@ -99,7 +149,7 @@ static void Cbuf_AddTextToBuffer( cmdbuf_t *buf, const char *text )
 {
 	int l = Q_strlen( text );
 
-	if(( buf->cursize + l ) >= buf->maxsize )
+	if(( buf->cursize - buf->start + l ) >= MAX_CMD_BUFFER_LIMIT )
 	{
 		Con_Reportf( S_WARN "%s: overflow\n", __func__ );
 		return;
@@ -154,16 +204,21 @@ static void Cbuf_InsertTextToBuffer( cmdbuf_t *buf, const char *text )
 {
 	int	l = Q_strlen( text );
 
-	if(( buf->cursize + l ) >= buf->maxsize )
+	if( l > buf->start )
 	{
-		Con_Reportf( S_WARN "Cbuf_InsertText: overflow\n" );
-	}
-	else
-	{
-		memmove( buf->data + l, buf->data, buf->cursize );
-		memcpy( buf->data, text, l );
-		buf->cursize += l;
+		int len = buf->cursize - buf->start;
+
+		// leave room in front proportional to the text, so
+		// repeated inserts like alias expansion are amortized
+		if( !Cbuf_Relocate( buf, l + len / 2 + MAX_CMD_LINE, 0 ) && !Cbuf_Relocate( buf, l, 0 ))
+		{
+			Con_Reportf( S_WARN "Cbuf_InsertText: overflow\n" );
+			return;
+		}
 	}
+
+	buf->start -= l;
+	memcpy( buf->data + buf->start, text, l );
 }
 
 void Cbuf_InsertText( const char *text )
@@ -180,10 +235,10 @@ void Cbuf_ExecuteCommandsFromBuffer( cmdbuf_t *buf, qboolean isPrivileged, int c
 {
 	char	*text;
 	char	line[MAX_CMD_LINE];
-	int	i, quotes;
+	int	i, quotes, size;
 	char	*comment;
 
-	while( buf->cursize )
+	while( buf->cursize > buf->start )
 	{
 		if( cmd_wait > 0 )
 		{
@@ -201,12 +256,13 @@ void Cbuf_ExecuteCommandsFromBuffer( cmdbuf_t *buf, qboolean isPrivileged, int c
 		}
 
 		// find a \n or ; line break
-		text = (char *)buf->data;
+		text = (char *)buf->data + buf->start;
+		size = buf->cursize - buf->start;
 
 		quotes = false;
 		comment = NULL;
 
-		for( i = 0; i < buf->cursize; i++ )
+		for( i = 0; i < size; i++ )
 		{
 			if( !comment )
 			{
@@ -214,13 +270,13 @@ void Cbuf_ExecuteCommandsFromBuffer( cmdbuf_t *buf, qboolean isPrivileged, int c
 
 				if( quotes )
 				{
-					// make sure i doesn't get > cursize which causes a negative size in memmove, which is fatal --blub
-					if( i < ( buf->cursize - 1 ) && ( text[i+0] == '\\' && (text[i+1] == '"' || text[i+1] == '\\')))
+					// make sure i doesn't get > size which causes a negative size in memmove, which is fatal --blub
+					if( i < ( size - 1 ) && ( text[i+0] == '\\' && (text[i+1] == '"' || text[i+1] == '\\')))
 						i++;
 				}
 				else
 				{
-					if( text[i+0] == '/' && text[i+1] == '/' && ( i == 0 || (byte)text[i - 1] <= ' ' ))
+					if( i < ( size - 1 ) && text[i+0] == '/' && text[i+1] == '/' && ( i == 0 || (byte)text[i - 1] <= ' ' ))
 						comment = &text[i];
 					if( text[i] == ';' ) break; // don't break if inside a quoted string or comment
 				}
@@ -241,18 +297,18 @@ void Cbuf_ExecuteCommandsFromBuffer( cmdbuf_t *buf, qboolean isPrivileged, int c
 			line[comment ? (comment - text) : i] = 0;
 		}
 
-		// delete the text from the command buffer and move remaining commands down
-		// this is necessary because commands (exec) can insert data at the
-		// beginning of the text buffer
-		if( i == buf->cursize )
+		// skip the text in the command buffer, commands (exec) can
+		// insert data right before the remaining text
+		if( i == size )
 		{
-			buf->cursize = 0;
+			buf->start = buf->cursize = 0;
 		}
 		else
 		{
-			i++;
-			buf->cursize -= i;
-			memmove( buf->data, text + i, buf->cursize );
+			buf->start += i + 1;
+
+			if( buf->start == buf->cursize )
+				buf->start = buf->cursize = 0;
 		}
 
 		// execute the command line
@@ -1449,6 +1505,63 @@ static void Test_FilteredCommand_f( void )
 	test_flags[2] = Cmd_CurrentCommandIsPrivileged() ? PRIV : UNPRIV;
 }
 
+static int test_count;
+static string test_order;
+
+static void Test_CountCommand_f( void )
+{
+	test_count++;
+}
+
+static void Test_OrderCommand_f( void )
+{
+	Q_strncat( test_order, Cmd_Argv( 1 ), sizeof( test_order ));
+}
+
+static void Test_RunCbuf( void )
+{
+	const int numlines = 10000;
+	const char *line = "test_count; // comment\n";
+	int i, len = Q_strlen( line );
+	char *cfg = Z_Malloc( numlines * len + 1 );
+	double start;
+
+	Cmd_AddCommand( "test_count", Test_CountCommand_f, "count calls" );
+	Cmd_AddCommand( "test_order", Test_OrderCommand_f, "append argument" );
+
+	// text inserted by a command goes before the remaining text
+	test_order[0] = 0;
+	Cbuf_AddText( "alias test_alias \"test_order b; test_order c\"; test_order a; test_alias; test_order d\n" );
+	Cbuf_Execute();
+	TASSERT_STR( test_order, "abcd" );
+
+	test_order[0] = 0;
+	Cbuf_AddText( "test_order a; wait; test_order b\n" );
+	Cbuf_Execute();
+	TASSERT_STR( test_order, "a" );
+	Cbuf_Execute();
+	TASSERT_STR( test_order, "ab" );
+
+	// big config is executed in linear time and doesn't overflow
+	for( i = 0; i < numlines; i++ )
+		memcpy( cfg + i * len, line, len );
+	cfg[numlines * len] = 0;
+
+	test_count = 0;
+	start = Sys_DoubleTime();
+	Cbuf_AddText( "test_count\n" );
+	Cbuf_InsertText( cfg );
+	Cbuf_Execute();
+	Msg( "%s: %d lines in %.3f ms\n", __func__, numlines + 1, ( Sys_DoubleTime() - start ) * 1000.0 );
+	TASSERT_EQi( test_count, numlines + 1 );
+
+	Cbuf_AddText( "unalias test_alias\n" );
+	Cbuf_Execute();
+	Cmd_RemoveCommand( "test_order" );
+	Cmd_RemoveCommand( "test_count" );
+	Mem_Free( cfg );
+}
+
 void Test_RunCmd( void )
 {
 	Cmd_AddCommand( "test_privileged", Test_PrivilegedCommand_f, "bark bark" );
@@ -1480,5 +1593,7 @@ void Test_RunCmd( void )
 	Cmd_RemoveCommand( "hud_filtered" );
 	Cmd_RemoveCommand( "test_unprivileged" );
 	Cmd_RemoveCommand( "test_privileged" );
+
+	Test_RunCbuf();
 }
 #endif
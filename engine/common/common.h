@@ -382,6 +382,8 @@ qboolean FS_LoadProgs( void );
 void FS_Init( void );
 void FS_Shutdown( void );
 void *FS_GetNativeObject( const char *obj );
+void FS_Prefetch( const char *path );
+void FS_Frame( void );
 
 //
 // cmd.c
@@ -432,6 +434,21 @@ void _Mem_Check( const char *filename, int fileline );
 qboolean Mem_IsAllocatedExt( poolhandle_t poolptr, void *data );
 void Mem_PrintList( size_t minallocationsize );
 void Mem_PrintStats( void );
+void *_Mem_FrameAlloc( size_t size, qboolean clear, const char *filename, int fileline );
+void Mem_FrameReset( qboolean poison );
+
+enum
+{
+	MEMPROF_SORT_LIVE = 0,
+	MEMPROF_SORT_PEAK,
+	MEMPROF_SORT_ALLOCS,
+	MEMPROF_SORT_FRAME,
+};
+
+void Mem_ProfileEnable( qboolean enable );
+qboolean Mem_ProfileEnabled( void );
+void Mem_ProfilePrint( int count, int sortkey );
+qboolean Mem_ProfileWriteCSV( const char *filename );
 
 #define Mem_Malloc( pool, size ) _Mem_Alloc( pool, size, false, __FILE__, __LINE__ )
 #define Mem_Calloc( pool, size ) _Mem_Alloc( pool, size, true, __FILE__, __LINE__ )
@@ -442,6 +459,8 @@ void Mem_PrintStats( void );
 #define Mem_EmptyPool( pool ) _Mem_EmptyPool( pool, __FILE__, __LINE__ )
 #define Mem_IsAllocated( mem ) Mem_IsAllocatedExt( NULL, mem )
 #define Mem_Check() _Mem_Check( __FILE__, __LINE__ )
+#define Mem_FrameAlloc( size ) _Mem_FrameAlloc( size, false, __FILE__, __LINE__ )
+#define Mem_FrameCalloc( size ) _Mem_FrameAlloc( size, true, __FILE__, __LINE__ )
 
 //
 // imagelib
@@ -26,6 +26,10 @@ fs_globals_t *FI;
 static pfnCreateInterface_t fs_pfnCreateInterface;
 static HINSTANCE fs_hInstance;
 
+static CVAR_DEFINE_AUTO( fs_prefetch, "0", FCVAR_ARCHIVE, "read precached resources ahead of use in background threads" );
+static CVAR_DEFINE_AUTO( fs_asyncwrite, "0", FCVAR_ARCHIVE, "write logs, demos, saves and configs in background thread, output written right before a crash may be lost" );
+static CVAR_DEFINE_AUTO( fs_blobcache, "0", FCVAR_ARCHIVE, "size limit in megabytes of on-disk cache of inflated pk3 entries, 0 to disable" );
+
 void *FS_GetNativeObject( const char *obj )
 {
 	if( fs_pfnCreateInterface )
@@ -49,6 +53,46 @@ static void FS_Path_f_( void )
 	FS_Path_f();
 }
 
+static void FS_PrefetchInfo_f( void )
+{
+	FS_PrefetchInfo( Cmd_Argc() > 1 && !Q_stricmp( Cmd_Argv( 1 ), "reset" ));
+}
+
+/*
+================
+FS_Prefetch
+
+queue resource for background loading
+================
+*/
+void FS_Prefetch( const char *path )
+{
+	if( fs_prefetch.value && COM_CheckString( path ))
+		FS_PrefetchFile( path, false );
+}
+
+/*
+================
+FS_Frame
+
+apply filesystem settings changes
+================
+*/
+void FS_Frame( void )
+{
+	if( FBitSet( fs_asyncwrite.flags, FCVAR_CHANGED ))
+	{
+		ClearBits( fs_asyncwrite.flags, FCVAR_CHANGED );
+		FS_SetAsyncWrite( fs_asyncwrite.value != 0.0f );
+	}
+
+	if( FBitSet( fs_blobcache.flags, FCVAR_CHANGED ))
+	{
+		ClearBits( fs_blobcache.flags, FCVAR_CHANGED );
+		FS_SetBlobCacheSize( (fs_offset_t)( fs_blobcache.value * 1024 * 1024 ));
+	}
+}
+
 static fs_interface_t fs_memfuncs =
 {
 	Con_Printf,
@@ -131,6 +175,10 @@ void FS_Init( void )
 	Cmd_AddRestrictedCommand( "fs_rescan", FS_Rescan_f, "rescan filesystem search pathes" );
 	Cmd_AddRestrictedCommand( "fs_path", FS_Path_f_, "show filesystem search pathes" );
 	Cmd_AddRestrictedCommand( "fs_clearpaths", FS_ClearPaths_f, "clear filesystem search pathes" );
+	Cmd_AddCommand( "fs_prefetchinfo", FS_PrefetchInfo_f, "show cold and warm file load statistics, 'reset' to clear them" );
+	Cvar_RegisterVariable( &fs_prefetch );
+	Cvar_RegisterVariable( &fs_asyncwrite );
+	Cvar_RegisterVariable( &fs_blobcache );
 
 	if( !Sys_GetParmFromCmdLine( "-game", gamedir ))
 		Q_strncpy( gamedir, SI.basedirName, sizeof( gamedir )); // gamedir == basedir
@@ -141,6 +189,8 @@ void FS_Init( void )
 		return;
 	}
 
+	FS_SetAsyncWrite( fs_asyncwrite.value != 0.0f );
+
 	if( !Sys_GetParmFromCmdLine( "-dll", SI.gamedll ))
 		SI.gamedll[0] = 0;
 
@@ -39,6 +39,7 @@ GNU General Public License for more details.
 #include "mod_local.h"
 #include "xash3d_mathlib.h"
 #include "input.h"
+#include "threads.h"
 #include "enginefeatures.h"
 #include "render_api.h"	// decallist_t
 #include "tests.h"
@@ -464,6 +465,53 @@ void Host_MemStats_f( void )
 	}
 }
 
+/*
+===============
+Host_MemProfile_f
+===============
+*/
+static void Host_MemProfile_f( void )
+{
+	static const char *sortkeys[] = { "live", "peak", "allocs", "frame" };
+	const char *cmd = Cmd_Argv( 1 );
+	int i, sortkey = MEMPROF_SORT_LIVE;
+
+	if( !Q_stricmp( cmd, "start" ))
+	{
+		Mem_ProfileEnable( true );
+		Con_Printf( "memory profiling started\n" );
+		return;
+	}
+	else if( !Q_stricmp( cmd, "stop" ))
+	{
+		Mem_ProfileEnable( false );
+		Con_Printf( "memory profiling stopped\n" );
+		return;
+	}
+	else if( !Q_stricmp( cmd, "csv" ))
+	{
+		const char *filename = Cmd_Argc() > 2 ? Cmd_Argv( 2 ) : "memprofile.csv";
+
+		if( Mem_ProfileWriteCSV( filename ))
+			Con_Printf( "memory profile saved to %s\n", filename );
+		else Con_Printf( S_ERROR "can't write memory profile to %s, is profiling started?\n", filename );
+		return;
+	}
+	else if( Cmd_Argc() > 3 || ( Cmd_Argc() > 1 && !Q_isdigit( cmd )))
+	{
+		Con_Printf( S_USAGE "memprofile <start|stop|csv [file]|[count] [live|peak|allocs|frame]>\n" );
+		return;
+	}
+
+	for( i = 0; Cmd_Argc() > 2 && i < ARRAYSIZE( sortkeys ); i++ )
+	{
+		if( !Q_stricmp( Cmd_Argv( 2 ), sortkeys[i] ))
+			sortkey = i;
+	}
+
+	Mem_ProfilePrint( Cmd_Argc() > 1 ? Q_atoi( cmd ) : 20, sortkey );
+}
+
 void Host_Minimize_f( void )
 {
 #ifdef XASH_SDL
@@ -711,10 +759,14 @@ void Host_Frame( float time )
 	Host_InputFrame ();  // input frame
 	Host_ClientBegin (); // begin client
 	Host_GetCommands (); // dedicated in
+	FS_Frame ();         // filesystem settings
 	Host_ServerFrame (); // server frame
 	Host_ClientFrame (); // client frame
 	HTTP_Run();			 // both server and client
 
+	// transient allocations of this frame are gone
+	Mem_FrameReset( host_developer.value >= DEV_EXTENDED );
+
 	t2 = Sys_DoubleTime();
 
 	host.pureframetime = t2 - t1;
@@ -1105,6 +1157,7 @@ void Host_InitCommon( int argc, char **argv, const char *progname, qboolean bCha
 
 	Cmd_AddCommand( "exec", Host_Exec_f, "execute a script file" );
 	Cmd_AddCommand( "memlist", Host_MemStats_f, "prints memory pool information" );
+	Cmd_AddCommand( "memprofile", Host_MemProfile_f, "count allocations by call site, print top sites or save them as csv" );
 	Cmd_AddRestrictedCommand( "userconfigd", Host_Userconfigd_f, "execute all scripts from userconfig.d" );
 
 	Image_Init();
@@ -1316,6 +1369,7 @@ void EXPORT Host_Shutdown( void )
 	Mod_Shutdown();
 	NET_Shutdown();
 	HTTP_Shutdown();
+	Thread_Shutdown();
 	Host_FreeCommon();
 	Platform_Shutdown();
 
@@ -130,11 +130,10 @@ void HPAK_CreatePak( const char *filename, resource_t *pResource, byte *pData, f
 
 		// there are better ways
 		filelocation = FS_Tell( fin );
-		temp = Z_Malloc( pResource->nDownloadSize );
+		temp = Mem_FrameAlloc( pResource->nDownloadSize );
 		FS_Read( fin, temp, pResource->nDownloadSize );
 		FS_Seek( fin, filelocation, SEEK_SET );
 		MD5Update( &ctx, temp, pResource->nDownloadSize );
-		Mem_Free( temp );
 	}
 	else
 	{
@@ -231,11 +230,10 @@ void HPAK_AddLump( qboolean bUseQueue, const char *name, resource_t *pResource,
 
 		// there are better ways
 		position = FS_Tell( pFile );
-		temp = Z_Malloc( pResource->nDownloadSize );
+		temp = Mem_FrameAlloc( pResource->nDownloadSize );
 		FS_Read( pFile, temp, pResource->nDownloadSize );
 		FS_Seek( pFile, position, SEEK_SET );
 		MD5Update( &ctx, temp, pResource->nDownloadSize );
-		Mem_Free( temp );
 	}
 	else
 	{
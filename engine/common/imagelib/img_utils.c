@@ -739,7 +739,7 @@ void Image_Resample32Lerp( const void *indata, int inwidth, int inheight, void *
 
 	fstep = (int)(inheight * 65536.0f / outheight);
 
-	resamplerow1 = (byte *)Mem_Malloc( host.imagepool, outwidth * 4 * 2);
+	resamplerow1 = (byte *)Mem_FrameAlloc( outwidth * 4 * 2);
 	resamplerow2 = resamplerow1 + outwidth * 4;
 
 	inrow = (const byte *)indata;
@@ -831,8 +831,6 @@ void Image_Resample32Lerp( const void *indata, int inwidth, int inheight, void *
 			memcpy( out, resamplerow1, outwidth4 );
 		}
 	}
-
-	Mem_Free( resamplerow1 );
 }
 
 void Image_Resample32Nolerp( const void *indata, int inwidth, int inheight, void *outdata, int outwidth, int outheight )
@@ -886,7 +884,7 @@ void Image_Resample24Lerp( const void *indata, int inwidth, int inheight, void *
 
 	fstep = (int)(inheight * 65536.0f / outheight);
 
-	resamplerow1 = (byte *)Mem_Malloc( host.imagepool, outwidth * 3 * 2 );
+	resamplerow1 = (byte *)Mem_FrameAlloc( outwidth * 3 * 2 );
 	resamplerow2 = resamplerow1 + outwidth*3;
 
 	inrow = (const byte *)indata;
@@ -971,8 +969,6 @@ void Image_Resample24Lerp( const void *indata, int inwidth, int inheight, void *
 			memcpy( out, resamplerow1, outwidth3 );
 		}
 	}
-
-	Mem_Free( resamplerow1 );
 }
 
 void Image_Resample24Nolerp( const void *indata, int inwidth, int inheight, void *outdata, int outwidth, int outheight )
@@ -270,6 +270,7 @@ qboolean Image_LoadLMP( const char *name, const byte *buffer, fs_offset_t filesi
 	byte	*fin, *pal;
 	int	rendermode;
 	int	i, pixels;
+	qboolean	conchars = false;
 
 	if( filesize < sizeof( lmp ))
 		return false;
@@ -285,9 +286,7 @@ qboolean Image_LoadLMP( const char *name, const byte *buffer, fs_offset_t filesi
 		rendermode = LUMP_QUAKE1;
 		filesize += sizeof( lmp );
 		fin = (byte *)buffer;
-
-		// need to remap transparent color from first to last entry
-		for( i = 0; i < 16384; i++ ) if( !fin[i] ) fin[i] = 0xFF;
+		conchars = true;
 	}
 	else
 	{
@@ -345,6 +344,22 @@ qboolean Image_LoadLMP( const char *name, const byte *buffer, fs_offset_t filesi
 	image.type = PF_INDEXED_32; // 32-bit palete
 	image.depth = 1;
 
+	if( conchars )
+	{
+		// need to remap transparent color from first to last entry
+		// source buffer may be read-only, so do it on a copy
+		byte	*remap = Mem_Malloc( host.imagepool, pixels );
+		qboolean	result;
+
+		for( i = 0; i < pixels; i++ )
+			remap[i] = fin[i] ? fin[i] : 0xFF;
+
+		result = Image_AddIndexedImageToPack( remap, image.width, image.height );
+		Mem_Free( remap );
+
+		return result;
+	}
+
 	return Image_AddIndexedImageToPack( fin, image.width, image.height );
 }
 
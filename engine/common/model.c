@@ -253,7 +253,7 @@ model_t *Mod_LoadModel( model_t *mod, qboolean crash )
 	char		tempname[MAX_QPATH];
 	fs_offset_t		length = 0;
 	qboolean		loaded;
-	byte		*buf;
+	const byte	*buf;
 	model_info_t	*p;
 
 	ASSERT( mod != NULL );
@@ -271,7 +271,8 @@ model_t *Mod_LoadModel( model_t *mod, qboolean crash )
 	Q_strncpy( tempname, mod->name, sizeof( tempname ));
 	COM_FixSlashes( tempname );
 
-	buf = FS_LoadFile( tempname, &length, false );
+	// loaders never modify the source buffer, so it can be mapped from disk
+	buf = FS_MapFile( tempname, &length, false );
 
 	if( !buf )
 	{
@@ -288,7 +289,7 @@ model_t *Mod_LoadModel( model_t *mod, qboolean crash )
 	mod->type = mod_bad;
 
 	// call the apropriate loader
-	switch( *(uint *)buf )
+	switch( *(const uint *)buf )
 	{
 	case IDSTUDIOHEADER:
 		Mod_LoadStudioModel( mod, buf, &loaded );
@@ -307,7 +308,7 @@ model_t *Mod_LoadModel( model_t *mod, qboolean crash )
 		// ref.dllFuncs.Mod_LoadModel( mod_brush, mod, buf, &loaded, 0 );
 		break;
 	default:
-		Mem_Free( buf );
+		FS_UnmapFile( buf );
 		if( crash ) Host_Error( "%s has unknown format\n", tempname );
 		else Con_Printf( S_ERROR "%s has unknown format\n", tempname );
 		return NULL;
@@ -336,7 +337,7 @@ model_t *Mod_LoadModel( model_t *mod, qboolean crash )
 	if( !loaded )
 	{
 		Mod_FreeModel( mod );
-		Mem_Free( buf );
+		FS_UnmapFile( buf );
 
 		if( crash ) Host_Error( "Could not load model %s\n", tempname );
 		else Con_Printf( S_ERROR "Could not load model %s\n", tempname );
@@ -366,7 +367,7 @@ model_t *Mod_LoadModel( model_t *mod, qboolean crash )
 			p->initialCRC = currentCRC;
 		}
 	}
-	Mem_Free( buf );
+	FS_UnmapFile( buf );
 
 	return mod;
 }
@@ -25,6 +25,7 @@ GNU General Public License for more details.
 #include "event_args.h"
 #include "protocol.h"
 #include "client.h"
+#include "threads.h"
 
 #define DELTA_PATH		"delta.lst"
 
@@ -40,6 +41,8 @@ GNU General Public License for more details.
 
 #define NUM_FIELDS( x )	((sizeof( x ) / sizeof( x[0] )) - 1)
 
+#define DELTA_MAX_WORDS	1024	// largest delta encoded struct size in 32-bit words
+
 // helper macroses
 #define ENTS_DEF( x )	#x, offsetof( entity_state_t, x ), sizeof( ((entity_state_t *)0)->x )
 #define UCMD_DEF( x )	#x, offsetof( usercmd_t, x ), sizeof( ((usercmd_t *)0)->x )
@@ -325,6 +328,7 @@ enum
 	DT_ENTITY_STATE_T,
 	DT_ENTITY_STATE_PLAYER_T,
 	DT_CUSTOM_ENTITY_STATE_T,
+	DT_MAX_TABLES,
 };
 
 static delta_info_t dt_info[] =
@@ -340,6 +344,35 @@ static delta_info_t dt_info[] =
 { NULL },
 };
 
+// custom encoders are toggling bInactive in delta tables, so every
+// worker thread gets it's own copy while parallel encoding is active
+static struct
+{
+	delta_t	*pFields[MAX_WORKER_THREADS][DT_MAX_TABLES];
+	int	num_workers;
+} delta_workers;
+
+// words of the struct that covers each field
+typedef struct
+{
+	word		firstWord;
+	word		lastWord;
+} delta_plan_field_t;
+
+// encoding plan is compiled from delta table and used to quickly
+// find unchanged fields by comparing whole struct word by word
+typedef struct
+{
+	delta_plan_field_t	*fields;
+	int		numWords;
+	qboolean		valid;	// plan matches delta table
+	qboolean		usable;	// false if struct is too big
+} delta_plan_t;
+
+static delta_plan_t	delta_plans[DT_MAX_TABLES];
+
+static const delta_plan_t *Delta_GetPlan( const delta_info_t *dt );
+
 static delta_info_t *Delta_FindStruct( const char *name )
 {
 	int	i;
@@ -387,7 +420,7 @@ static delta_info_t *Delta_FindStructByEncoder( const char *encoderName )
 
 static delta_info_t *Delta_FindStructByDelta( const delta_t *pFields )
 {
-	int	i;
+	int	i, j;
 
 	if( !pFields ) return NULL;
 
@@ -395,12 +428,214 @@ static delta_info_t *Delta_FindStructByDelta( const delta_t *pFields )
 	{
 		if( dt_info[i].pFields == pFields )
 			return &dt_info[i];
+
+		// maybe it's a worker copy
+		for( j = 1; j < delta_workers.num_workers; j++ )
+		{
+			if( delta_workers.pFields[j][i] == pFields )
+				return &dt_info[i];
+		}
 	}
 	// found nothing
 	return NULL;
 }
 
-static void Delta_CustomEncode( delta_info_t *dt, const void *from, const void *to )
+/*
+=====================
+Delta_GetFields
+
+returns delta table for current thread
+=====================
+*/
+static delta_t *Delta_GetFields( delta_info_t *dt )
+{
+	int	worker;
+
+	if( !delta_workers.num_workers )
+		return dt->pFields;
+
+	worker = Thread_WorkerIndex();
+
+	if( worker <= 0 || worker >= delta_workers.num_workers )
+		return dt->pFields;
+
+	return delta_workers.pFields[worker][dt - dt_info];
+}
+
+/*
+=====================
+Delta_BeginParallelEncode
+
+prepare delta tables copies for worker threads
+encoders are never called from multiple threads outside of
+Delta_BeginParallelEncode/Delta_EndParallelEncode
+=====================
+*/
+void Delta_BeginParallelEncode( int numworkers )
+{
+	int	i, j;
+
+	numworkers = bound( 1, numworkers, MAX_WORKER_THREADS );
+
+	// plans are compiled lazily, do it before workers are started
+	for( j = 0; j < NUM_FIELDS( dt_info ); j++ )
+		Delta_GetPlan( &dt_info[j] );
+
+	for( i = 1; i < numworkers; i++ )
+	{
+		for( j = 0; j < NUM_FIELDS( dt_info ); j++ )
+		{
+			delta_info_t *dt = &dt_info[j];
+
+			if( !dt->pFields )
+				continue;
+
+			if( !delta_workers.pFields[i][j] )
+				delta_workers.pFields[i][j] = Z_Malloc( dt->maxFields * sizeof( delta_t ));
+
+			memcpy( delta_workers.pFields[i][j], dt->pFields, dt->numFields * sizeof( delta_t ));
+		}
+	}
+
+	delta_workers.num_workers = numworkers;
+}
+
+void Delta_EndParallelEncode( void )
+{
+	delta_workers.num_workers = 0;
+}
+
+static void Delta_FreeWorkerTables( void )
+{
+	int	i, j;
+
+	for( i = 0; i < MAX_WORKER_THREADS; i++ )
+	{
+		for( j = 0; j < DT_MAX_TABLES; j++ )
+		{
+			if( delta_workers.pFields[i][j] )
+			{
+				Z_Free( delta_workers.pFields[i][j] );
+				delta_workers.pFields[i][j] = NULL;
+			}
+		}
+	}
+
+	delta_workers.num_workers = 0;
+}
+
+/*
+=====================
+Delta_InvalidatePlan
+
+must be called when fields are added or removed
+=====================
+*/
+static void Delta_InvalidatePlan( const delta_info_t *dt )
+{
+	delta_plans[dt - dt_info].valid = false;
+}
+
+/*
+=====================
+Delta_GetPlan
+
+compile delta table into encoding plan, returns NULL if can't be used
+=====================
+*/
+static const delta_plan_t *Delta_GetPlan( const delta_info_t *dt )
+{
+	delta_plan_t	*plan = &delta_plans[dt - dt_info];
+	int		i;
+
+	if( plan->valid )
+		return plan->usable ? plan : NULL;
+
+	plan->valid = true;
+	plan->usable = false;
+	plan->numWords = 0;
+
+	if( plan->fields )
+	{
+		Z_Free( plan->fields );
+		plan->fields = NULL;
+	}
+
+	if( !dt->numFields || !dt->pFields )
+		return NULL;
+
+	plan->fields = Z_Malloc( dt->numFields * sizeof( delta_plan_field_t ));
+
+	for( i = 0; i < dt->numFields; i++ )
+	{
+		const delta_t *pField = &dt->pFields[i];
+		int lastWord = ( pField->offset + Q_max( pField->size, 1 ) - 1 ) >> 2;
+
+		if( pField->offset < 0 || lastWord >= DELTA_MAX_WORDS )
+			return NULL;
+
+		plan->fields[i].firstWord = pField->offset >> 2;
+		plan->fields[i].lastWord = lastWord;
+		plan->numWords = Q_max( plan->numWords, lastWord + 1 );
+	}
+
+	plan->usable = true;
+
+	return plan;
+}
+
+static void Delta_FreePlans( void )
+{
+	int	i;
+
+	for( i = 0; i < DT_MAX_TABLES; i++ )
+	{
+		if( delta_plans[i].fields )
+			Z_Free( delta_plans[i].fields );
+
+		delta_plans[i].fields = NULL;
+		delta_plans[i].valid = false;
+	}
+}
+
+/*
+=====================
+Delta_ComputeDirtyWords
+
+set bit for every struct word that differs
+=====================
+*/
+static void Delta_ComputeDirtyWords( const delta_plan_t *plan, const void *from, const void *to, uint32_t *dirty )
+{
+	const byte	*a = from, *b = to;
+	uint32_t		wa, wb;
+	int		i;
+
+	memset( dirty, 0, (( plan->numWords + 31 ) >> 5 ) * sizeof( uint32_t ));
+
+	for( i = 0; i < plan->numWords; i++ )
+	{
+		memcpy( &wa, a + i * 4, sizeof( wa ));
+		memcpy( &wb, b + i * 4, sizeof( wb ));
+
+		dirty[i >> 5] |= (uint32_t)( wa != wb ) << ( i & 31 );
+	}
+}
+
+static qboolean Delta_FieldDirty( const delta_plan_field_t *field, const uint32_t *dirty )
+{
+	int	i;
+
+	for( i = field->firstWord; i <= field->lastWord; i++ )
+	{
+		if( FBitSet( dirty[i >> 5], BIT( i & 31 )))
+			return true;
+	}
+
+	return false;
+}
+
+static void Delta_CustomEncode( delta_info_t *dt, delta_t *pFields, const void *from, const void *to )
 {
 	int	i;
 
@@ -408,11 +643,18 @@ static void Delta_CustomEncode( delta_info_t *dt, const void *from, const void *
 
 	// set all fields is active by default
 	for( i = 0; i < dt->numFields; i++ )
-		dt->pFields[i].bInactive = false;
+		pFields[i].bInactive = false;
 
 	if( dt->userCallback )
 	{
-		dt->userCallback( dt->pFields, from, to );
+		// game dll encoders aren't reentrant
+		if( delta_workers.num_workers )
+		{
+			Thread_Lock();
+			dt->userCallback( pFields, from, to );
+			Thread_Unlock();
+		}
+		else dt->userCallback( pFields, from, to );
 	}
 }
 
@@ -480,6 +722,7 @@ static qboolean Delta_AddField( delta_info_t *dt, const char *pName, int flags,
 
 	// allocate a new one
 	dt->pFields = Z_Realloc( dt->pFields, (dt->numFields + 1) * sizeof( delta_t ));
+	Delta_InvalidatePlan( dt );
 	for( i = 0, pField = dt->pFields; i < dt->numFields; i++, pField++ );
 
 	// copy info to new field
@@ -731,6 +974,7 @@ static void Delta_ParseTable( char **delta_script, delta_info_t *dt, const char
 	pField = dt->pFields;
 	pInfo = dt->pInfo;
 	dt->numFields = 0;
+	Delta_InvalidatePlan( dt );
 
 	// assume we have handled '{'
 	while(( *delta_script = COM_ParseFile( *delta_script, token, sizeof( token ))) != NULL )
@@ -908,6 +1152,8 @@ void Delta_Shutdown( void )
 		dt_info[i].bInitialized = false;
 	}
 
+	Delta_FreeWorkerTables();
+	Delta_FreePlans();
 	delta_init = false;
 }
 
@@ -1084,6 +1330,8 @@ compare baselines to find optimal
 */
 int Delta_TestBaseline( entity_state_t *from, entity_state_t *to, qboolean player, double timebase )
 {
+	const delta_plan_t	*plan;
+	uint32_t		dirty[DELTA_MAX_WORDS / 32];
 	delta_info_t	*dt = NULL;
 	delta_t		*pField;
 	int		i, countBits;
@@ -1107,11 +1355,14 @@ int Delta_TestBaseline( entity_state_t *from, entity_state_t *to, qboolean playe
 
 	countBits++; // entityType flag
 
-	pField = dt->pFields;
+	pField = Delta_GetFields( dt );
 	Assert( pField != NULL );
 
 	// activate fields and call custom encode func
-	Delta_CustomEncode( dt, from, to );
+	Delta_CustomEncode( dt, pField, from, to );
+
+	plan = Delta_GetPlan( dt );
+	if( plan ) Delta_ComputeDirtyWords( plan, from, to, dirty );
 
 	// process fields
 	for( i = 0; i < dt->numFields; i++, pField++ )
@@ -1119,6 +1370,9 @@ int Delta_TestBaseline( entity_state_t *from, entity_state_t *to, qboolean playe
 		// flag about field change (sets always)
 		countBits++;
 
+		if( plan && !Delta_FieldDirty( &plan->fields[i], dirty ))
+			continue;
+
 		if( !Delta_CompareField( pField, from, to, timebase ))
 		{
 			// strings are handled difference
@@ -1140,21 +1394,13 @@ write fields by offsets
 assume from and to is valid
 =====================
 */
-static qboolean Delta_WriteField( sizebuf_t *msg, delta_t *pField, void *from, void *to, double timebase )
+static void Delta_WriteFieldValue( sizebuf_t *msg, delta_t *pField, void *to, double timebase )
 {
 	int		signbit = FBitSet( pField->flags, DT_SIGNED ) ? 1 : 0;
 	float		flValue, flAngle;
 	uint		iValue;
 	const char	*pStr;
 
-	if( Delta_CompareField( pField, from, to, timebase ))
-	{
-		MSG_WriteOneBit( msg, 0 );	// unchanged
-		return false;
-	}
-
-	MSG_WriteOneBit( msg, 1 );	// changed
-
 	if( pField->flags & DT_BYTE )
 	{
 		if( signbit )
@@ -1230,9 +1476,91 @@ static qboolean Delta_WriteField( sizebuf_t *msg, delta_t *pField, void *from, v
 		pStr = (char *)((byte *)to + pField->offset );
 		MSG_WriteString( msg, pStr );
 	}
+}
+
+static qboolean Delta_WriteField( sizebuf_t *msg, delta_t *pField, void *from, void *to, double timebase )
+{
+	if( Delta_CompareField( pField, from, to, timebase ))
+	{
+		MSG_WriteOneBit( msg, 0 );	// unchanged
+		return false;
+	}
+
+	MSG_WriteOneBit( msg, 1 );	// changed
+	Delta_WriteFieldValue( msg, pField, to, timebase );
+
 	return true;
 }
 
+/*
+=====================
+Delta_WriteUnchanged
+
+write a run of "unchanged" flags at once
+=====================
+*/
+static void Delta_WriteUnchanged( sizebuf_t *msg, int count )
+{
+	while( count > 0 )
+	{
+		int bits = Q_min( count, 32 );
+
+		MSG_WriteUBitLong( msg, 0, bits );
+		count -= bits;
+	}
+}
+
+/*
+=====================
+Delta_WriteFields
+
+write all fields of delta table using encoding plan,
+returns number of changed fields
+=====================
+*/
+static int Delta_WriteFields( sizebuf_t *msg, delta_info_t *dt, delta_t *pFields, void *from, void *to, double timebase )
+{
+	const delta_plan_t	*plan = Delta_GetPlan( dt );
+	uint32_t		dirty[DELTA_MAX_WORDS / 32];
+	int		i, numChanges = 0;
+	int		unchanged = 0;
+	delta_t		*pField;
+
+	if( !plan )
+	{
+		for( i = 0, pField = pFields; i < dt->numFields; i++, pField++ )
+		{
+			if( Delta_WriteField( msg, pField, from, to, timebase ))
+				numChanges++;
+		}
+
+		return numChanges;
+	}
+
+	Delta_ComputeDirtyWords( plan, from, to, dirty );
+
+	for( i = 0, pField = pFields; i < dt->numFields; i++, pField++ )
+	{
+		// field memory wasn't touched or value is same after conversion
+		if( !Delta_FieldDirty( &plan->fields[i], dirty ) || Delta_CompareField( pField, from, to, timebase ))
+		{
+			unchanged++;
+			continue;
+		}
+
+		Delta_WriteUnchanged( msg, unchanged );
+		unchanged = 0;
+
+		MSG_WriteOneBit( msg, 1 );	// changed
+		Delta_WriteFieldValue( msg, pField, to, timebase );
+		numChanges++;
+	}
+
+	Delta_WriteUnchanged( msg, unchanged );
+
+	return numChanges;
+}
+
 /*
 ====================
 Delta_CopyField
@@ -1408,17 +1736,14 @@ void MSG_WriteDeltaUsercmd( sizebuf_t *msg, usercmd_t *from, usercmd_t *to )
 	dt = Delta_FindStructByIndex( DT_USERCMD_T );
 	Assert( dt && dt->bInitialized );
 
-	pField = dt->pFields;
+	pField = Delta_GetFields( dt );
 	Assert( pField != NULL );
 
 	// activate fields and call custom encode func
-	Delta_CustomEncode( dt, from, to );
+	Delta_CustomEncode( dt, pField, from, to );
 
 	// process fields
-	for( i = 0; i < dt->numFields; i++, pField++ )
-	{
-		Delta_WriteField( msg, pField, from, to, 0.0f );
-	}
+	Delta_WriteFields( msg, dt, pField, from, to, 0.0f );
 }
 
 /*
@@ -1470,17 +1795,14 @@ void MSG_WriteDeltaEvent( sizebuf_t *msg, event_args_t *from, event_args_t *to )
 	dt = Delta_FindStructByIndex( DT_EVENT_T );
 	Assert( dt && dt->bInitialized );
 
-	pField = dt->pFields;
+	pField = Delta_GetFields( dt );
 	Assert( pField != NULL );
 
 	// activate fields and call custom encode func
-	Delta_CustomEncode( dt, from, to );
+	Delta_CustomEncode( dt, pField, from, to );
 
 	// process fields
-	for( i = 0; i < dt->numFields; i++, pField++ )
-	{
-		Delta_WriteField( msg, pField, from, to, 0.0f );
-	}
+	Delta_WriteFields( msg, dt, pField, from, to, 0.0f );
 }
 
 /*
@@ -1526,22 +1848,18 @@ qboolean MSG_WriteDeltaMovevars( sizebuf_t *msg, movevars_t *from, movevars_t *t
 	dt = Delta_FindStructByIndex( DT_MOVEVARS_T );
 	Assert( dt && dt->bInitialized );
 
-	pField = dt->pFields;
+	pField = Delta_GetFields( dt );
 	Assert( pField != NULL );
 
 	startBit = msg->iCurBit;
 
 	// activate fields and call custom encode func
-	Delta_CustomEncode( dt, from, to );
+	Delta_CustomEncode( dt, pField, from, to );
 
 	MSG_BeginServerCmd( msg, svc_deltamovevars );
 
 	// process fields
-	for( i = 0; i < dt->numFields; i++, pField++ )
-	{
-		if( Delta_WriteField( msg, pField, from, to, 0.0f ))
-			numChanges++;
-	}
+	numChanges += Delta_WriteFields( msg, dt, pField, from, to, 0.0f );
 
 	// if we have no changes - kill the message
 	if( !numChanges )
@@ -1598,7 +1916,7 @@ void MSG_WriteClientData( sizebuf_t *msg, clientdata_t *from, clientdata_t *to,
 	dt = Delta_FindStructByIndex( DT_CLIENTDATA_T );
 	Assert( dt && dt->bInitialized );
 
-	pField = dt->pFields;
+	pField = Delta_GetFields( dt );
 	Assert( pField != NULL );
 
 	startBit = msg->iCurBit;
@@ -1606,14 +1924,10 @@ void MSG_WriteClientData( sizebuf_t *msg, clientdata_t *from, clientdata_t *to,
 	MSG_WriteOneBit( msg, 1 ); // have clientdata
 
 	// activate fields and call custom encode func
-	Delta_CustomEncode( dt, from, to );
+	Delta_CustomEncode( dt, pField, from, to );
 
 	// process fields
-	for( i = 0; i < dt->numFields; i++, pField++ )
-	{
-		if( Delta_WriteField( msg, pField, from, to, timebase ))
-			numChanges++;
-	}
+	numChanges += Delta_WriteFields( msg, dt, pField, from, to, timebase );
 
 	if( numChanges ) return; // we have updates
 
@@ -1679,11 +1993,11 @@ void MSG_WriteWeaponData( sizebuf_t *msg, weapon_data_t *from, weapon_data_t *to
 	dt = Delta_FindStructByIndex( DT_WEAPONDATA_T );
 	Assert( dt && dt->bInitialized );
 
-	pField = dt->pFields;
+	pField = Delta_GetFields( dt );
 	Assert( pField != NULL );
 
 	// activate fields and call custom encode func
-	Delta_CustomEncode( dt, from, to );
+	Delta_CustomEncode( dt, pField, from, to );
 
 	startBit = msg->iCurBit;
 
@@ -1691,11 +2005,7 @@ void MSG_WriteWeaponData( sizebuf_t *msg, weapon_data_t *from, weapon_data_t *to
 	MSG_WriteUBitLong( msg, index, MAX_WEAPON_BITS );
 
 	// process fields
-	for( i = 0; i < dt->numFields; i++, pField++ )
-	{
-		if( Delta_WriteField( msg, pField, from, to, timebase ))
-			numChanges++;
-	}
+	numChanges += Delta_WriteFields( msg, dt, pField, from, to, timebase );
 
 	// if we have no changes - kill the message
 	if( !numChanges ) MSG_SeekToBit( msg, startBit, SEEK_SET );
@@ -1734,6 +2044,30 @@ entity_state_t communication
 
 =============================================================================
 */
+/*
+==================
+Delta_HasEntityEncoder
+
+game dll encoder may produce different delta
+for the same states, depending on current player
+==================
+*/
+qboolean Delta_HasEntityEncoder( const entity_state_t *to, int delta_type )
+{
+	delta_info_t	*dt;
+
+	if( to == NULL )
+		return false;
+
+	if( FBitSet( to->entityType, ENTITY_BEAM ))
+		dt = Delta_FindStructByIndex( DT_CUSTOM_ENTITY_STATE_T );
+	else if( delta_type == DELTA_PLAYER )
+		dt = Delta_FindStructByIndex( DT_ENTITY_STATE_PLAYER_T );
+	else dt = Delta_FindStructByIndex( DT_ENTITY_STATE_T );
+
+	return dt && dt->userCallback;
+}
+
 /*
 ==================
 MSG_WriteDeltaEntity
@@ -1810,27 +2144,23 @@ void MSG_WriteDeltaEntity( entity_state_t *from, entity_state_t *to, sizebuf_t *
 
 	Assert( dt && dt->bInitialized );
 
-	pField = dt->pFields;
+	pField = Delta_GetFields( dt );
 	Assert( pField != NULL );
 
 	if( delta_type == DELTA_STATIC )
 	{
 		// static entities won't to be custom encoded
 		for( i = 0; i < dt->numFields; i++ )
-			dt->pFields[i].bInactive = false;
+			pField[i].bInactive = false;
 	}
 	else
 	{
 		// activate fields and call custom encode func
-		Delta_CustomEncode( dt, from, to );
+		Delta_CustomEncode( dt, pField, from, to );
 	}
 
 	// process fields
-	for( i = 0; i < dt->numFields; i++, pField++ )
-	{
-		if( Delta_WriteField( msg, pField, from, to, timebase ))
-			numChanges++;
-	}
+	numChanges += Delta_WriteFields( msg, dt, pField, from, to, timebase );
 
 	// if we have no changes - kill the message
 	if( !numChanges && !force ) MSG_SeekToBit( msg, startBit, SEEK_SET );
@@ -2019,7 +2349,7 @@ void GAME_EXPORT Delta_SetField( delta_t *pFields, const char *fieldname )
 	if( dt == NULL || !fieldname || !fieldname[0] )
 		return;
 
-	for( i = 0, pField = dt->pFields; i < dt->numFields; i++, pField++ )
+	for( i = 0, pField = pFields; i < dt->numFields; i++, pField++ )
 	{
 		if( !Q_strcmp( pField->name, fieldname ))
 		{
@@ -2039,7 +2369,7 @@ void GAME_EXPORT Delta_UnsetField( delta_t *pFields, const char *fieldname )
 	if( dt == NULL || !fieldname || !fieldname[0] )
 		return;
 
-	for( i = 0, pField = dt->pFields; i < dt->numFields; i++, pField++ )
+	for( i = 0, pField = pFields; i < dt->numFields; i++, pField++ )
 	{
 		if( !Q_strcmp( pField->name, fieldname ))
 		{
@@ -2057,7 +2387,7 @@ void GAME_EXPORT Delta_SetFieldByIndex( delta_t *pFields, int fieldNumber )
 	if( dt == NULL || fieldNumber < 0 || fieldNumber >= dt->numFields )
 		return;
 
-	dt->pFields[fieldNumber].bInactive = false;
+	pFields[fieldNumber].bInactive = false;
 }
 
 void GAME_EXPORT Delta_UnsetFieldByIndex( delta_t *pFields, int fieldNumber )
@@ -2068,5 +2398,168 @@ void GAME_EXPORT Delta_UnsetFieldByIndex( delta_t *pFields, int fieldNumber )
 	if( dt == NULL || fieldNumber < 0 || fieldNumber >= dt->numFields )
 		return;
 
-	dt->pFields[fieldNumber].bInactive = true;
+	pFields[fieldNumber].bInactive = true;
+}
+
+#if XASH_ENGINE_TESTS
+#include "tests.h"
+
+#define TEST_DELTA_PAIRS	4096
+#define TEST_DELTA_ROUNDS	32
+
+static uint32_t test_delta_seed = 0x1234567;
+
+static uint32_t Test_DeltaRandom( void )
+{
+	// deterministic LCG, so failures can be reproduced
+	test_delta_seed = test_delta_seed * 1664525 + 1013904223;
+	return test_delta_seed >> 8;
+}
+
+static void Test_DeltaMutateState( delta_info_t *dt, entity_state_t *state, int changes )
+{
+	int	i;
+
+	for( i = 0; i < changes; i++ )
+	{
+		delta_t	*pField = &dt->pFields[Test_DeltaRandom() % dt->numFields];
+		byte	*p = (byte *)state + pField->offset;
+		uint32_t	value = Test_DeltaRandom();
+
+		if( FBitSet( pField->flags, DT_FLOAT|DT_ANGLE|DT_TIMEWINDOW_8|DT_TIMEWINDOW_BIG ))
+		{
+			float f = (float)( value % 8192 ) - 4096.0f;
+
+			// sometimes change only fraction, it may be lost after conversion
+			if( value & 1 ) f = *(float *)p + 0.001f;
+			*(float *)p = f;
+		}
+		else if( FBitSet( pField->flags, DT_BYTE ))
+			*(byte *)p = value;
+		else if( FBitSet( pField->flags, DT_SHORT ))
+			*(short *)p = value;
+		else *(int *)p = value;
+	}
+}
+
+static int Test_DeltaEncode( sizebuf_t *msg, delta_info_t *dt, entity_state_t *from, entity_state_t *to, qboolean reference )
+{
+	int	i;
+
+	// this is how fields were written before encoding plans
+	if( reference )
+	{
+		for( i = 0; i < dt->numFields; i++ )
+			Delta_WriteField( msg, &dt->pFields[i], from, to, 1.0 );
+		return MSG_GetNumBitsWritten( msg );
+	}
+
+	Delta_WriteFields( msg, dt, dt->pFields, from, to, 1.0 );
+	return MSG_GetNumBitsWritten( msg );
+}
+
+static void Test_DeltaBenchmark( delta_info_t *dt, entity_state_t *states, qboolean reference )
+{
+	byte	buf[2048];
+	double	start, end;
+	sizebuf_t	msg;
+	int	i, j;
+
+	start = Sys_DoubleTime();
+
+	for( i = 0; i < TEST_DELTA_ROUNDS; i++ )
+	{
+		for( j = 0; j < TEST_DELTA_PAIRS; j++ )
+		{
+			MSG_Init( &msg, "DeltaBench", buf, sizeof( buf ));
+			Test_DeltaEncode( &msg, dt, &states[j * 2], &states[j * 2 + 1], reference );
+		}
+	}
+
+	end = Sys_DoubleTime();
+
+	Msg( "%s delta encoder: %.2f Mpairs/s\n", reference ? "reference" : "planned",
+		( TEST_DELTA_ROUNDS * TEST_DELTA_PAIRS ) / (( end - start ) * 1000000.0 ));
+}
+
+void Test_RunDelta( void )
+{
+	delta_info_t	*dt = Delta_FindStructByIndex( DT_ENTITY_STATE_T );
+	byte		buf1[2048], buf2[2048];
+	entity_state_t	*states;
+	sizebuf_t		msg1, msg2;
+	int		i, bits1, bits2;
+
+	// tests are running before netchan is initialized
+	MSG_InitMasks();
+
+	// same fields as in delta.lst from HLSDK
+	TASSERT( dt->numFields == 0 );
+	Delta_AddField( dt, "animtime", DT_TIMEWINDOW_8, 8, 1.0f, 1.0f );
+	Delta_AddField( dt, "frame", DT_FLOAT, 8, 1.0f, 1.0f );
+	Delta_AddField( dt, "origin[0]", DT_SIGNED|DT_FLOAT, 21, 8.0f, 1.0f );
+	Delta_AddField( dt, "angles[0]", DT_ANGLE, 16, 1.0f, 1.0f );
+	Delta_AddField( dt, "angles[1]", DT_ANGLE, 16, 1.0f, 1.0f );
+	Delta_AddField( dt, "origin[1]", DT_SIGNED|DT_FLOAT, 21, 8.0f, 1.0f );
+	Delta_AddField( dt, "origin[2]", DT_SIGNED|DT_FLOAT, 21, 8.0f, 1.0f );
+	Delta_AddField( dt, "sequence", DT_INTEGER, 8, 1.0f, 1.0f );
+	Delta_AddField( dt, "modelindex", DT_INTEGER, 10, 1.0f, 1.0f );
+	Delta_AddField( dt, "movetype", DT_INTEGER, 4, 1.0f, 1.0f );
+	Delta_AddField( dt, "solid", DT_SHORT, 3, 1.0f, 1.0f );
+	Delta_AddField( dt, "mins[0]", DT_SIGNED|DT_FLOAT, 16, 1.0f, 1.0f );
+	Delta_AddField( dt, "maxs[0]", DT_SIGNED|DT_FLOAT, 16, 1.0f, 1.0f );
+	Delta_AddField( dt, "owner", DT_INTEGER, 10, 1.0f, 1.0f );
+	Delta_AddField( dt, "effects", DT_INTEGER, 8, 1.0f, 1.0f );
+	Delta_AddField( dt, "framerate", DT_SIGNED|DT_FLOAT, 8, 16.0f, 1.0f );
+	Delta_AddField( dt, "skin", DT_SHORT|DT_SIGNED, 9, 1.0f, 1.0f );
+	Delta_AddField( dt, "controller[0]", DT_BYTE, 8, 1.0f, 1.0f );
+	Delta_AddField( dt, "blending[0]", DT_BYTE, 8, 1.0f, 1.0f );
+	Delta_AddField( dt, "body", DT_INTEGER, 8, 1.0f, 1.0f );
+	Delta_AddField( dt, "rendermode", DT_INTEGER, 8, 1.0f, 1.0f );
+	Delta_AddField( dt, "renderamt", DT_INTEGER, 8, 1.0f, 1.0f );
+	Delta_AddField( dt, "rendercolor.r", DT_BYTE, 8, 1.0f, 1.0f );
+	Delta_AddField( dt, "renderfx", DT_INTEGER, 8, 1.0f, 1.0f );
+	Delta_AddField( dt, "scale", DT_FLOAT, 16, 256.0f, 1.0f );
+	Delta_AddField( dt, "velocity[0]", DT_SIGNED|DT_FLOAT, 16, 8.0f, 1.0f );
+	Delta_AddField( dt, "aiment", DT_INTEGER, 11, 1.0f, 1.0f );
+	Delta_AddField( dt, "fuser1", DT_SIGNED|DT_FLOAT, 22, 128.0f, 1.0f );
+	Delta_AddField( dt, "iuser1", DT_SIGNED|DT_INTEGER, 8, 1.0f, 1.0f );
+
+	// same way client sets up tables received from server
+	Delta_InitClient();
+	TASSERT( dt->bInitialized );
+
+	TASSERT( Delta_GetPlan( dt ) != NULL );
+
+	// pairs of states like they are sent on server, most fields are unchanged
+	states = Z_Calloc( sizeof( *states ) * TEST_DELTA_PAIRS * 2 );
+	for( i = 0; i < TEST_DELTA_PAIRS; i++ )
+	{
+		Test_DeltaMutateState( dt, &states[i * 2], 16 );
+		states[i * 2 + 1] = states[i * 2];
+		Test_DeltaMutateState( dt, &states[i * 2 + 1], i % 6 );
+	}
+
+	for( i = 0; i < TEST_DELTA_PAIRS; i++ )
+	{
+		memset( buf1, 0, sizeof( buf1 ));
+		memset( buf2, 0, sizeof( buf2 ));
+		MSG_Init( &msg1, "DeltaReference", buf1, sizeof( buf1 ));
+		MSG_Init( &msg2, "DeltaPlanned", buf2, sizeof( buf2 ));
+
+		bits1 = Test_DeltaEncode( &msg1, dt, &states[i * 2], &states[i * 2 + 1], true );
+		bits2 = Test_DeltaEncode( &msg2, dt, &states[i * 2], &states[i * 2 + 1], false );
+
+		TASSERT_EQi( bits1, bits2 );
+		TASSERT( !memcmp( buf1, buf2, ( bits1 + 7 ) >> 3 ));
+	}
+
+	Test_DeltaBenchmark( dt, states, true );
+	Test_DeltaBenchmark( dt, states, false );
+
+	Z_Free( states );
+
+	Delta_Shutdown();
+	TASSERT( dt->numFields == 0 && !dt->bInitialized );
 }
+#endif /* XASH_ENGINE_TESTS */
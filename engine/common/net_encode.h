@@ -109,5 +109,8 @@ void MSG_ReadWeaponData( sizebuf_t *msg, struct weapon_data_s *from, struct weap
 void MSG_WriteDeltaEntity( struct entity_state_s *from, struct entity_state_s *to, sizebuf_t *msg, qboolean force, int type, double timebase, int ofs );
 qboolean MSG_ReadDeltaEntity( sizebuf_t *msg, struct entity_state_s *from, struct entity_state_s *to, int num, int type, double timebase );
 int Delta_TestBaseline( struct entity_state_s *from, struct entity_state_s *to, qboolean player, double timebase );
+qboolean Delta_HasEntityEncoder( const struct entity_state_s *to, int type );
+void Delta_BeginParallelEncode( int numworkers );
+void Delta_EndParallelEncode( void );
 
 #endif//NET_ENCODE_H
@@ -32,6 +32,11 @@ static const struct in6_addr in6addr_any;
 
 #define NET_USE_FRAGMENTS
 
+// batched datagram syscalls, linux only
+#if XASH_LINUX && defined( MSG_WAITFORONE )
+#define NET_USE_MMSG 1
+#endif
+
 #define PORT_ANY			-1
 #define MAX_LOOPBACK		4
 #define MASK_LOOPBACK		(MAX_LOOPBACK - 1)
@@ -41,6 +46,10 @@ static const struct in6_addr in6addr_any;
 #define SPLITPACKET_MAX_SIZE			64000
 #define NET_MAX_FRAGMENTS		( NET_MAX_FRAGMENT / (SPLITPACKET_MIN_SIZE - sizeof( SPLITPACKET )))
 
+#define NET_RECV_BATCH		16		// packets per recvmmsg, every one needs NET_MAX_FRAGMENT
+#define NET_SEND_BATCH		64		// packets per sendmmsg
+#define NET_SENDQUEUE_SIZE		( 256 * 1024 )
+
 // ff02:1
 static const uint8_t k_ipv6Bytes_LinkLocalAllNodes[16] =
 { 0xff, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01 };
@@ -86,6 +95,39 @@ typedef struct
 } SPLITPACKET;
 #pragma pack(pop)
 
+#if NET_USE_MMSG
+typedef struct
+{
+	byte		*data;	// NET_RECV_BATCH * NET_MAX_FRAGMENT
+	struct mmsghdr	msgs[NET_RECV_BATCH];
+	struct iovec	iov[NET_RECV_BATCH];
+	struct sockaddr_storage	addr[NET_RECV_BATCH];
+	int		count;	// received by last call
+	int		current;	// next to return
+} net_recvring_t;
+
+typedef struct
+{
+	byte		data[NET_SENDQUEUE_SIZE];
+	size_t		datalen;
+	struct mmsghdr	msgs[NET_SEND_BATCH];
+	struct iovec	iov[NET_SEND_BATCH];
+	struct sockaddr_storage	addr[NET_SEND_BATCH];
+	int		sockets[NET_SEND_BATCH];
+	netadr_t		to[NET_SEND_BATCH];	// for error messages
+	int		count;
+} net_sendqueue_t;
+#endif
+
+typedef struct
+{
+	uint		recv_calls;
+	uint		recv_packets;
+	uint		send_calls;
+	uint		send_packets;
+	uint		framecount;	// when stats were reset
+} net_iostats_t;
+
 typedef struct
 {
 	net_loopback_t	loopbacks[NS_COUNT];
@@ -102,6 +144,13 @@ typedef struct
 	qboolean		configured;
 	qboolean		allow_ip;
 	qboolean		allow_ip6;
+#if NET_USE_MMSG
+	net_recvring_t	*recvring[2];	// for server IPv4 and IPv6 sockets
+	net_sendqueue_t	*sendqueue;
+	qboolean		sendbatch;	// queue server packets until NET_EndSendBatch
+	qboolean		mmsg_unsupported;	// kernel without recvmmsg/sendmmsg
+#endif
+	net_iostats_t	iostats;
 #if XASH_WIN32
 	WSADATA		winsockdata;
 #endif
@@ -116,6 +165,7 @@ static CVAR_DEFINE( net_ipclientport, "ip_clientport", "0", FCVAR_READ_ONLY, "ne
 static CVAR_DEFINE( net_clientport, "clientport", "0", FCVAR_READ_ONLY, "network default client port" );
 static CVAR_DEFINE( net_fakelag, "fakelag", "0", FCVAR_PRIVILEGED, "lag all incoming network data (including loopback) by xxx ms." );
 static CVAR_DEFINE( net_fakeloss, "fakeloss", "0", FCVAR_PRIVILEGED, "act like we dropped the packet this % of the time." );
+static CVAR_DEFINE_AUTO( net_batchio, "1", FCVAR_PRIVILEGED, "receive and send server packets with recvmmsg/sendmmsg where available" );
 CVAR_DEFINE( net_clockwindow, "clockwindow", "0.5", FCVAR_PRIVILEGED, "timewindow to execute client moves" );
 
 netadr_t			net_local;
@@ -1441,6 +1491,95 @@ qboolean NET_GetLong( byte *pData, int size, size_t *outSize, int splitsize )
 	return false;
 }
 
+#if NET_USE_MMSG
+/*
+==================
+NET_RecvBatched
+
+return next packet from the ring, refill it with
+a single recvmmsg call when it's empty
+==================
+*/
+static int NET_RecvBatched( int protocol, int net_socket, byte **buf, struct sockaddr_storage *addr )
+{
+	net_recvring_t	*ring = net.recvring[protocol];
+	int		i, ret;
+
+	if( !ring )
+	{
+		ring = net.recvring[protocol] = Z_Calloc( sizeof( *ring ));
+		ring->data = Z_Malloc( NET_RECV_BATCH * NET_MAX_FRAGMENT );
+	}
+
+	if( ring->current >= ring->count )
+	{
+		ring->current = ring->count = 0;
+
+		for( i = 0; i < NET_RECV_BATCH; i++ )
+		{
+			ring->iov[i].iov_base = ring->data + i * NET_MAX_FRAGMENT;
+			ring->iov[i].iov_len = NET_MAX_FRAGMENT;
+			memset( &ring->msgs[i], 0, sizeof( ring->msgs[i] ));
+			ring->msgs[i].msg_hdr.msg_name = &ring->addr[i];
+			ring->msgs[i].msg_hdr.msg_namelen = sizeof( ring->addr[i] );
+			ring->msgs[i].msg_hdr.msg_iov = &ring->iov[i];
+			ring->msgs[i].msg_hdr.msg_iovlen = 1;
+		}
+
+		ret = recvmmsg( net_socket, ring->msgs, NET_RECV_BATCH, MSG_DONTWAIT, NULL );
+		net.iostats.recv_calls++;
+
+		if( ret <= 0 )
+		{
+			if( ret < 0 && WSAGetLastError() == ENOSYS )
+				net.mmsg_unsupported = true;
+			return SOCKET_ERROR;
+		}
+
+		ring->count = ret;
+	}
+
+	i = ring->current++;
+	*buf = ring->iov[i].iov_base;
+	memcpy( addr, &ring->addr[i], sizeof( *addr ));
+	net.iostats.recv_packets++;
+
+	return ring->msgs[i].msg_len;
+}
+
+/*
+==================
+NET_RecvPending
+
+ring has packets that weren't returned yet
+==================
+*/
+static qboolean NET_RecvPending( int protocol )
+{
+	net_recvring_t	*ring = net.recvring[protocol];
+
+	return ring && ring->current < ring->count;
+}
+
+/*
+==================
+NET_ClearRecvRings
+
+drop packets of closed sockets
+==================
+*/
+static void NET_ClearRecvRings( void )
+{
+	int	i;
+
+	for( i = 0; i < ARRAYSIZE( net.recvring ); i++ )
+	{
+		if( net.recvring[i] )
+			net.recvring[i]->current = net.recvring[i]->count = 0;
+	}
+}
+#endif // NET_USE_MMSG
+
 /*
 ==================
 NET_QueuePacket
@@ -1450,7 +1589,8 @@ queue normal and lagged packets
 */
 static qboolean NET_QueuePacket( netsrc_t sock, netadr_t *from, byte *data, size_t *length )
 {
-	byte		buf[NET_MAX_FRAGMENT];
+	byte		stackbuf[NET_MAX_FRAGMENT];
+	byte		*buf;
 	int		ret, protocol;
 	int		net_socket;
 	WSAsize_t	addr_len;
@@ -1469,8 +1609,23 @@ static qboolean NET_QueuePacket( netsrc_t sock, netadr_t *from, byte *data, size
 		if( !NET_IsSocketValid( net_socket ))
 			continue;
 
-		addr_len = sizeof( addr );
-		ret = recvfrom( net_socket, buf, sizeof( buf ), 0, (struct sockaddr *)&addr, &addr_len );
+#if NET_USE_MMSG
+		// drain the ring even if net_batchio was just turned off
+		if( sock == NS_SERVER && (( net_batchio.value && !net.mmsg_unsupported ) || NET_RecvPending( protocol )))
+		{
+			ret = NET_RecvBatched( protocol, net_socket, &buf, &addr );
+		}
+		else
+#endif
+		{
+			buf = stackbuf;
+			addr_len = sizeof( addr );
+			ret = recvfrom( net_socket, buf, sizeof( stackbuf ), 0, (struct sockaddr *)&addr, &addr_len );
+			net.iostats.recv_calls++;
+
+			if( !NET_IsSocketError( ret ))
+				net.iostats.recv_packets++;
+		}
 
 		NET_SockadrToNetadr( &addr, from );
 
@@ -1593,8 +1748,11 @@ int NET_SendLong( netsrc_t sock, int net_socket, const char *buf, size_t len, in
 			}
 
 			ret = sendto( net_socket, packet, size + sizeof( SPLITPACKET ), flags, (const struct sockaddr *)to, tolen );
+			net.iostats.send_calls++;
 			if( ret < 0 ) return ret; // error
 
+			net.iostats.send_packets++;
+
 			if( ret >= size )
 				total_sent += size;
 			len -= size;
@@ -1607,9 +1765,172 @@ int NET_SendLong( netsrc_t sock, int net_socket, const char *buf, size_t len, in
 	else
 #endif
 	{
+		int	ret;
+
 		// no fragmenantion for client connection
-		return sendto( net_socket, buf, len, flags, (const struct sockaddr *)to, tolen );
+		ret = sendto( net_socket, buf, len, flags, (const struct sockaddr *)to, tolen );
+		net.iostats.send_calls++;
+
+		if( !NET_IsSocketError( ret ))
+			net.iostats.send_packets++;
+
+		return ret;
+	}
+}
+
+/*
+==================
+NET_SendPacketError
+==================
+*/
+static void NET_SendPacketError( netadr_t to )
+{
+	int err = WSAGetLastError();
+
+	// WSAEWOULDBLOCK is silent
+	if( err == WSAEWOULDBLOCK )
+		return;
+
+	// some PPP links don't allow broadcasts
+	if( err == WSAEADDRNOTAVAIL && ( to.type == NA_BROADCAST || to.type6 == NA_MULTICAST_IP6 ))
+		return;
+
+	if( Host_IsDedicated( ))
+	{
+		Con_DPrintf( S_ERROR "NET_SendPacket: %s to %s\n", NET_ErrorString(), NET_AdrToString( to ));
+	}
+	else if( err == WSAEADDRNOTAVAIL || err == WSAENOBUFS )
+	{
+		Con_DPrintf( S_ERROR "NET_SendPacket: %s to %s\n", NET_ErrorString(), NET_AdrToString( to ));
+	}
+	else
+	{
+		Con_Printf( S_ERROR "NET_SendPacket: %s to %s\n", NET_ErrorString(), NET_AdrToString( to ));
+	}
+}
+
+#if NET_USE_MMSG
+/*
+==================
+NET_FlushSendQueue
+
+one sendmmsg per run of packets going through the same socket
+==================
+*/
+static void NET_FlushSendQueue( void )
+{
+	net_sendqueue_t	*q = net.sendqueue;
+	int		i, j, ret;
+
+	if( !q || !q->count )
+		return;
+
+	for( i = 0; i < q->count; )
+	{
+		for( j = i + 1; j < q->count && q->sockets[j] == q->sockets[i]; j++ );
+
+		if( !net.mmsg_unsupported )
+		{
+			ret = sendmmsg( q->sockets[i], &q->msgs[i], j - i, 0 );
+			net.iostats.send_calls++;
+
+			if( ret > 0 )
+			{
+				net.iostats.send_packets += ret;
+				i += ret;
+				continue;
+			}
+
+			if( ret < 0 && WSAGetLastError() == ENOSYS )
+				net.mmsg_unsupported = true;
+		}
+
+		// no sendmmsg, or nothing was sent and errno is stale, try this one alone
+		if( net.mmsg_unsupported || ret == 0 )
+		{
+			struct msghdr *hdr = &q->msgs[i].msg_hdr;
+
+			ret = sendto( q->sockets[i], hdr->msg_iov->iov_base, hdr->msg_iov->iov_len, 0, hdr->msg_name, hdr->msg_namelen );
+			net.iostats.send_calls++;
+
+			if( !NET_IsSocketError( ret ))
+				net.iostats.send_packets++;
+			else NET_SendPacketError( q->to[i] );
+		}
+		else NET_SendPacketError( q->to[i] );
+
+		// skip the failed one, sendmmsg reports only first error
+		i++;
 	}
+
+	q->count = 0;
+	q->datalen = 0;
+}
+
+/*
+==================
+NET_QueueSend
+==================
+*/
+static qboolean NET_QueueSend( int net_socket, const void *data, size_t length, const struct sockaddr_storage *addr, netadr_t to )
+{
+	net_sendqueue_t	*q;
+	int		i;
+
+	if( length > NET_SENDQUEUE_SIZE )
+		return false;
+
+	if( !net.sendqueue )
+		net.sendqueue = Z_Calloc( sizeof( *net.sendqueue ));
+
+	q = net.sendqueue;
+
+	if( q->count == NET_SEND_BATCH || q->datalen + length > NET_SENDQUEUE_SIZE )
+		NET_FlushSendQueue();
+
+	i = q->count++;
+	memcpy( q->data + q->datalen, data, length );
+	memcpy( &q->addr[i], addr, sizeof( *addr ));
+	q->iov[i].iov_base = q->data + q->datalen;
+	q->iov[i].iov_len = length;
+	memset( &q->msgs[i], 0, sizeof( q->msgs[i] ));
+	q->msgs[i].msg_hdr.msg_name = &q->addr[i];
+	q->msgs[i].msg_hdr.msg_namelen = NET_SockAddrLen( addr );
+	q->msgs[i].msg_hdr.msg_iov = &q->iov[i];
+	q->msgs[i].msg_hdr.msg_iovlen = 1;
+	q->sockets[i] = net_socket;
+	q->to[i] = to;
+	q->datalen += length;
+
+	return true;
+}
+#endif // NET_USE_MMSG
+
+/*
+==================
+NET_BeginSendBatch
+
+server packets are queued until NET_EndSendBatch
+==================
+*/
+void NET_BeginSendBatch( void )
+{
+#if NET_USE_MMSG
+	net.sendbatch = net_batchio.value && !net.mmsg_unsupported;
+#endif
+}
+
+/*
+==================
+NET_EndSendBatch
+==================
+*/
+void NET_EndSendBatch( void )
+{
+#if NET_USE_MMSG
+	NET_FlushSendQueue();
+	net.sendbatch = false;
+#endif
 }
 
 /*
@@ -1647,34 +1968,58 @@ void NET_SendPacketEx( netsrc_t sock, size_t length, const void *data, netadr_t
 
 	NET_NetadrToSockadr( &to, &addr );
 
+#if NET_USE_MMSG
+	// net_batchio was turned off in the middle of the batch
+	if( net.sendbatch && !net_batchio.value )
+	{
+		NET_FlushSendQueue();
+		net.sendbatch = false;
+	}
+
+	if( net.sendbatch && sock == NS_SERVER )
+	{
+		// split packets are sent with delays between them, keep them in order
+		if( splitsize <= sizeof( SPLITPACKET ) || length <= splitsize )
+		{
+			if( NET_QueueSend( net_socket, data, length, &addr, to ))
+				return;
+		}
+
+		NET_FlushSendQueue();
+	}
+#endif
+
 	ret = NET_SendLong( sock, net_socket, data, length, 0, &addr, NET_SockAddrLen( &addr ), splitsize );
 
 	if( NET_IsSocketError( ret ))
-	{
-		int err = WSAGetLastError();
+		NET_SendPacketError( to );
+}
 
-		// WSAEWOULDBLOCK is silent
-		if( err == WSAEWOULDBLOCK )
-			return;
+/*
+==================
+NET_IOStats_f
 
-		// some PPP links don't allow broadcasts
-		if( err == WSAEADDRNOTAVAIL && ( to.type == NA_BROADCAST || to.type6 == NA_MULTICAST_IP6 ))
-			return;
+print datagram syscalls and packets since last call
+==================
+*/
+static void NET_IOStats_f( void )
+{
+	net_iostats_t	*s = &net.iostats;
+	uint		frames = Q_max( 1, host.framecount - s->framecount );
 
-		if( Host_IsDedicated( ))
-		{
-			Con_DPrintf( S_ERROR "NET_SendPacket: %s to %s\n", NET_ErrorString(), NET_AdrToString( to ));
-		}
-		else if( err == WSAEADDRNOTAVAIL || err == WSAENOBUFS )
-		{
-			Con_DPrintf( S_ERROR "NET_SendPacket: %s to %s\n", NET_ErrorString(), NET_AdrToString( to ));
-		}
-		else
-		{
-			Con_Printf( S_ERROR "NET_SendPacket: %s to %s\n", NET_ErrorString(), NET_AdrToString( to ));
-		}
-	}
+	Con_Printf( "%u frames, batched io %s\n", frames,
+#if NET_USE_MMSG
+		!net_batchio.value ? "disabled" : net.mmsg_unsupported ? "unsupported by kernel" : "enabled" );
+#else
+		"unavailable" );
+#endif
+	Con_Printf( "recv: %u syscalls, %u packets (%.2f / %.2f per frame)\n", s->recv_calls, s->recv_packets,
+		(float)s->recv_calls / frames, (float)s->recv_packets / frames );
+	Con_Printf( "send: %u syscalls, %u packets (%.2f / %.2f per frame)\n", s->send_calls, s->send_packets,
+		(float)s->send_calls / frames, (float)s->send_packets / frames );
 
+	memset( s, 0, sizeof( *s ));
+	s->framecount = host.framecount;
 }
 
 /*
@@ -2019,6 +2364,12 @@ void NET_Config( qboolean multiplayer, qboolean changeport )
 				net.ip6_sockets[i] = INVALID_SOCKET;
 			}
 		}
+
+#if NET_USE_MMSG
+		NET_ClearRecvRings();
+		if( net.sendqueue )
+			net.sendqueue->count = net.sendqueue->datalen = 0;
+#endif
 	}
 
 	NET_ClearLoopback ();
@@ -2112,6 +2463,9 @@ void NET_Init( void )
 	Cvar_RegisterVariable( &net_clientport );
 	Cvar_RegisterVariable( &net_fakelag );
 	Cvar_RegisterVariable( &net_fakeloss );
+	Cvar_RegisterVariable( &net_batchio );
+
+	Cmd_AddRestrictedCommand( "net_iostats", NET_IOStats_f, "show network syscalls and packets per frame since last call" );
 
 	Q_snprintf( cmd, sizeof( cmd ), "%i", PORT_SERVER );
 	Cvar_FullSet( "hostport", cmd, FCVAR_READ_ONLY );
@@ -2179,6 +2533,10 @@ NET_Shutdown
 */
 void NET_Shutdown( void )
 {
+#if NET_USE_MMSG
+	int	i;
+#endif
+
 	if( !net.initialized )
 		return;
 
@@ -2187,6 +2545,23 @@ void NET_Shutdown( void )
 	NET_Config( false, false );
 #if XASH_WIN32
 	WSACleanup();
+#endif
+#if NET_USE_MMSG
+	for( i = 0; i < ARRAYSIZE( net.recvring ); i++ )
+	{
+		if( !net.recvring[i] )
+			continue;
+
+		Mem_Free( net.recvring[i]->data );
+		Mem_Free( net.recvring[i] );
+		net.recvring[i] = NULL;
+	}
+
+	if( net.sendqueue )
+	{
+		Mem_Free( net.sendqueue );
+		net.sendqueue = NULL;
+	}
 #endif
 	net.initialized = false;
 }
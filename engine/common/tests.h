@@ -38,13 +38,17 @@ void Test_RunCvar( void );
 void Test_RunCon( void );
 void Test_RunVOX( void );
 void Test_RunIPFilter( void );
+void Test_RunDelta( void );
+void Test_RunZone( void );
 
 #define TEST_LIST_0 \
 	Test_RunLibCommon(); \
 	Test_RunCommon(); \
 	Test_RunCmd(); \
 	Test_RunCvar(); \
-	Test_RunIPFilter();
+	Test_RunIPFilter(); \
+	Test_RunDelta(); \
+	Test_RunZone();
 
 #define TEST_LIST_0_CLIENT \
 	Test_RunCon();
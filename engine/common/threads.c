@@ -0,0 +1,280 @@
+/*
+threads.c - engine worker thread pool
+Copyright (C) 2024 Xash3D FWGS contributors
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include "common.h"
+#include "xash3d_mathlib.h"
+#include "threads.h"
+
+static XASH_THREAD_LOCAL int thread_worker_index;
+
+#if XASH_HAVE_THREADS
+#include <pthread.h>
+#include <unistd.h>
+
+static struct
+{
+	pthread_t		threads[MAX_WORKER_THREADS];
+	int		num_threads;	// not including main thread
+	qboolean		initialized;
+	qboolean		quit;
+
+	pthread_mutex_t	lock;
+	pthread_cond_t	wake;
+	pthread_cond_t	done;
+
+	// current job, protected by lock
+	pfnParallelJob	func;
+	void		*data;
+	int		count;
+	int		next;
+	int		finished;
+	uint		generation;
+
+	pthread_mutex_t	critical;	// Thread_Lock, separate from the job queue
+} workers = { .lock = PTHREAD_MUTEX_INITIALIZER, .wake = PTHREAD_COND_INITIALIZER, .done = PTHREAD_COND_INITIALIZER, .critical = PTHREAD_MUTEX_INITIALIZER };
+
+/*
+=================
+Thread_RunJobs
+
+grab job indices until nothing left, lock must be held
+=================
+*/
+static void Thread_RunJobs( int worker )
+{
+	while( workers.next < workers.count )
+	{
+		int index = workers.next++;
+
+		pthread_mutex_unlock( &workers.lock );
+		workers.func( workers.data, index, worker );
+		pthread_mutex_lock( &workers.lock );
+
+		if( ++workers.finished == workers.count )
+			pthread_cond_signal( &workers.done );
+	}
+}
+
+static void *Thread_WorkerLoop( void *arg )
+{
+	int	worker = (int)(size_t)arg;
+	uint	generation = 0;
+
+	thread_worker_index = worker;
+
+	pthread_mutex_lock( &workers.lock );
+
+	while( 1 )
+	{
+		while( !workers.quit && workers.generation == generation )
+			pthread_cond_wait( &workers.wake, &workers.lock );
+
+		if( workers.quit )
+			break;
+
+		generation = workers.generation;
+		Thread_RunJobs( worker );
+	}
+
+	pthread_mutex_unlock( &workers.lock );
+
+	return NULL;
+}
+
+/*
+=================
+Thread_Init
+
+spawn worker threads, one per available CPU core
+=================
+*/
+void Thread_Init( void )
+{
+	char	token[16];
+	int	i, numcpus = 1;
+
+	if( workers.initialized )
+		return;
+
+	workers.initialized = true;
+
+	// CRC32 tables are built lazily, do it while we're single threaded
+	CRC32_SetBackend( -1 );
+
+#ifdef _SC_NPROCESSORS_ONLN
+	numcpus = sysconf( _SC_NPROCESSORS_ONLN );
+#endif
+	if( Sys_GetParmFromCmdLine( "-numthreads", token ))
+		numcpus = Q_atoi( token );
+
+	numcpus = bound( 1, numcpus, MAX_WORKER_THREADS );
+	workers.quit = false;
+
+	for( i = 1; i < numcpus; i++ )
+	{
+		if( pthread_create( &workers.threads[workers.num_threads], NULL, Thread_WorkerLoop, (void *)(size_t)i ))
+		{
+			Con_Printf( S_ERROR "%s: can't create worker thread #%d\n", __func__, i );
+			break;
+		}
+
+		workers.num_threads++;
+	}
+
+	Con_Reportf( "%s: %d worker threads\n", __func__, workers.num_threads + 1 );
+}
+
+/*
+=================
+Thread_Shutdown
+=================
+*/
+void Thread_Shutdown( void )
+{
+	int	i;
+
+	if( !workers.initialized )
+		return;
+
+	pthread_mutex_lock( &workers.lock );
+	workers.quit = true;
+	pthread_cond_broadcast( &workers.wake );
+	pthread_mutex_unlock( &workers.lock );
+
+	for( i = 0; i < workers.num_threads; i++ )
+		pthread_join( workers.threads[i], NULL );
+
+	workers.num_threads = 0;
+	workers.initialized = false;
+}
+
+/*
+=================
+Thread_NumWorkers
+=================
+*/
+int Thread_NumWorkers( void )
+{
+	Thread_Init();
+
+	return workers.num_threads + 1;
+}
+
+/*
+=================
+Thread_ParallelFor
+
+run func for every index in range [0, count) on worker threads,
+main thread participates too and returns when all jobs are done
+=================
+*/
+void Thread_ParallelFor( pfnParallelJob func, void *data, int count )
+{
+	int	i;
+
+	Thread_Init();
+
+	if( count <= 0 )
+		return;
+
+	// nothing to wait for
+	if( count == 1 || !workers.num_threads )
+	{
+		for( i = 0; i < count; i++ )
+			func( data, i, 0 );
+		return;
+	}
+
+	pthread_mutex_lock( &workers.lock );
+	workers.func = func;
+	workers.data = data;
+	workers.count = count;
+	workers.next = 0;
+	workers.finished = 0;
+	workers.generation++;
+	pthread_cond_broadcast( &workers.wake );
+
+	Thread_RunJobs( 0 );
+
+	while( workers.finished < workers.count )
+		pthread_cond_wait( &workers.done, &workers.lock );
+
+	workers.func = NULL;
+	workers.data = NULL;
+	workers.count = 0;
+	pthread_mutex_unlock( &workers.lock );
+}
+
+/*
+=================
+Thread_Lock
+
+serializes code that isn't reentrant, like game dll callbacks, between jobs
+=================
+*/
+void Thread_Lock( void )
+{
+	pthread_mutex_lock( &workers.critical );
+}
+
+void Thread_Unlock( void )
+{
+	pthread_mutex_unlock( &workers.critical );
+}
+
+#else // !XASH_HAVE_THREADS
+
+void Thread_Init( void )
+{
+}
+
+void Thread_Shutdown( void )
+{
+}
+
+int Thread_NumWorkers( void )
+{
+	return 1;
+}
+
+void Thread_ParallelFor( pfnParallelJob func, void *data, int count )
+{
+	int	i;
+
+	for( i = 0; i < count; i++ )
+		func( data, i, 0 );
+}
+
+void Thread_Lock( void )
+{
+}
+
+void Thread_Unlock( void )
+{
+}
+
+#endif // !XASH_HAVE_THREADS
+
+/*
+=================
+Thread_WorkerIndex
+
+returns index of worker executing current job, 0 for main thread
+=================
+*/
+int Thread_WorkerIndex( void )
+{
+	return thread_worker_index;
+}
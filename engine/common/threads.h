@@ -0,0 +1,43 @@
+/*
+threads.h - engine worker thread pool
+Copyright (C) 2024 Xash3D FWGS contributors
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+#ifndef THREADS_H
+#define THREADS_H
+
+#if XASH_POSIX && !XASH_DOS4GW
+#define XASH_HAVE_THREADS 1
+#define XASH_THREAD_LOCAL __thread
+#else
+#undef XASH_HAVE_THREADS
+#define XASH_THREAD_LOCAL
+#endif
+
+#define MAX_WORKER_THREADS	16	// including the main thread
+
+// index is a job number in range [0, count), worker is a unique worker
+// number in range [0, Thread_NumWorkers()), main thread is always worker 0
+typedef void (*pfnParallelJob)( void *data, int index, int worker );
+
+//
+// threads.c
+//
+void Thread_Init( void );
+void Thread_Shutdown( void );
+int Thread_NumWorkers( void );
+int Thread_WorkerIndex( void );
+void Thread_ParallelFor( pfnParallelJob func, void *data, int count );
+void Thread_Lock( void );
+void Thread_Unlock( void );
+
+#endif // THREADS_H
@@ -32,6 +32,10 @@ ENTITY AREA CHECKING
 #define MAX_TOTAL_ENT_LEAFS		128
 #define AREA_NODES			32
 #define AREA_DEPTH			4
+#define AREA_MAX_NODES		1024	// adaptive tree, see sv_world_tree
+#define AREA_MAX_DEPTH		9
+#define AREA_MIN_SIZE		256.0f	// adaptive tree never splits smaller nodes
+#define AREA_LEAF_EDICTS		4	// adaptive tree stops splitting sparse nodes
 
 #include "lightstyle.h"
 
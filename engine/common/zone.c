@@ -46,6 +46,23 @@ typedef struct memheader_s
 	// immediately followed by data, which is followed by a MEMHEADER_SENTINEL2 byte
 } memheader_t;
 
+#if XASH_ZONE_SLAB
+#define MEMSLAB_MINSHIFT	6	// smallest block is 64 bytes with header
+#define MEMSLAB_CLASSES	7	// up to 4096 bytes with header
+#define MEMSLAB_MAXBLOCK	( 1U << ( MEMSLAB_MINSHIFT + MEMSLAB_CLASSES - 1 ))
+#define MEMSLAB_CHUNK	( 64 * 1024 )	// largest slab
+#define MEMSLAB_MINBLOCKS	8	// in first slab of class, doubles for each next one
+
+// slab of small blocks or a single big block, all of them are freed together with the pool
+typedef struct memchunk_s
+{
+	struct memchunk_s	*next;
+	struct memchunk_s	*prev;
+	size_t		size;		// with this header
+	size_t		pad0;		// keep data aligned to 16 bytes on 64-bit
+} memchunk_t;
+#endif
+
 typedef struct mempool_s
 {
 	uint32_t		sentinel1;	// should always be MEMHEADER_SENTINEL1
@@ -60,32 +77,166 @@ typedef struct mempool_s
 	poolhandle_t idx;
 #endif
 	char		name[64];		// name of the pool
+#if XASH_ZONE_SLAB
+	memchunk_t	*chunks;		// all memory owned by the pool
+	memheader_t	*freeblocks[MEMSLAB_CLASSES];	// freed small blocks, linked by next
+	byte		*slabptr[MEMSLAB_CLASSES];	// unused part of the last slab
+	byte		*slabend[MEMSLAB_CLASSES];
+	int		numslabs[MEMSLAB_CLASSES];
+#endif
 	uint32_t		sentinel2;	// should always be MEMHEADER_SENTINEL1
 } mempool_t;
 
 static mempool_t *poolchain = NULL; // critical stuff
 
+#define MEMFRAME_CHUNK	( 1024 * 1024 )
+#define MEMFRAME_ALIGN( x )	((( x ) + 15 ) & ~(size_t)15 )
+#define MEMFRAME_POISON	0xCD
+#define MEMFRAME_TRIM_FRAMES	256	// frames using under half of reserve before spare chunks are freed
+
+// linear memory that lives until the end of the frame
+typedef struct memframechunk_s
+{
+	struct memframechunk_s	*next;
+	size_t		size;		// usable size after this header
+	size_t		used;
+	size_t		pad0;		// keep data aligned to 16 bytes on 64-bit
+} memframechunk_t;
+
+static struct
+{
+	memframechunk_t	*chunks;
+	memframechunk_t	*current;		// chunks after it are unused this frame
+	size_t		used;		// in this frame
+	size_t		lastused;		// in previous frame
+	size_t		peak;		// high-water mark over all frames
+	size_t		reserved;		// total size of chunks
+	size_t		recent;		// most used by a frame since usage dropped
+	int		quietframes;	// in a row with usage under half of reserve
+	int		allocs;		// in this frame
+} memframe;
+
+static void Mem_CheckHeaderSentinels( void *data, const char *filename, int fileline );
+
+#define MEMPROF_SITES	8192	// must be power of two
+
+// allocation counters of a single Mem_Alloc call site
+typedef struct memsite_s
+{
+	const char	*filename;	// NULL if entry is unused
+	int		fileline;
+	int		frame;		// last frame with allocation
+	size_t		live;		// bytes allocated and not freed yet
+	size_t		peak;		// of live bytes
+	size_t		liveblocks;
+	size_t		allocs;
+	size_t		frees;
+	size_t		allocbytes;	// total
+	size_t		frameallocs;	// in last frame with allocation
+	size_t		maxframeallocs;
+} memsite_t;
+
+static struct
+{
+	memsite_t		*sites;		// non NULL while profiling is enabled
+	int		numsites;
+	int		frame;
+	int		dropped;		// allocations from sites that didn't fit into table
+	double		starttime;
+} memprof;
+
+static void Mem_ProfileAlloc( const memheader_t *mem, qboolean seed );
+static void Mem_ProfileFree( const memheader_t *mem );
+
 #if XASH_64BIT
 // a1ba: due to mempool being passed with the model through reused 32-bit field
 // which makes engine incompatible with 64-bit pointers I changed mempool type
 // from pointer to 32-bit handle, thankfully mempool structure is private
-// But! Mempools are handled through linked list so we can't index them safely
-static poolhandle_t lastidx = 0;
+// Handle is a slot index in the low bits and slot generation in the high bits,
+// so stale handles of freed pools are still caught. Free slots are reused in
+// FIFO order, so generation of one slot wraps only after that many reuses of all of them
+#define POOLHANDLE_INDEXBITS	16
+#define POOLHANDLE_MAXSLOTS	(( 1U << POOLHANDLE_INDEXBITS ) - 1 )	// zero handle is never valid
+#define POOLHANDLE_GENMASK	(( 1U << ( 32 - POOLHANDLE_INDEXBITS )) - 1 )
+
+typedef struct poolslot_s
+{
+	mempool_t	*pool;		// NULL if slot is free
+	uint32_t	generation;	// incremented when pool is freed
+	uint32_t	nextfree;		// index of next free slot + 1
+} poolslot_t;
+
+static poolslot_t	*poolslots = NULL;
+static uint32_t	numpoolslots = 0;
+static uint32_t	maxpoolslots = 0;
+static uint32_t	freepoolslot = 0;	// index of first free slot + 1, reused first
+static uint32_t	lastfreepoolslot = 0;	// index of last free slot + 1
 
 static mempool_t *Mem_FindPool( poolhandle_t poolptr )
 {
-	mempool_t *pool;
+	uint32_t	index = ( poolptr & POOLHANDLE_MAXSLOTS ) - 1;
+	uint32_t	generation = poolptr >> POOLHANDLE_INDEXBITS;
 
-	for( pool = poolchain; pool; pool = pool->next )
-	{
-		if( pool->idx == poolptr )
-			return pool;
-	}
+	if( index < numpoolslots && poolslots[index].pool && poolslots[index].generation == generation )
+		return poolslots[index].pool;
 
 	Sys_Error( "%s: not allocated or double freed pool %d", __FUNCTION__, poolptr );
 
 	return NULL;
 }
+
+static poolhandle_t Mem_AllocPoolHandle( mempool_t *pool, const char *filename, int fileline )
+{
+	uint32_t index;
+
+	if( freepoolslot )
+	{
+		index = freepoolslot - 1;
+		freepoolslot = poolslots[index].nextfree;
+
+		if( !freepoolslot )
+			lastfreepoolslot = 0;
+	}
+	else
+	{
+		if( numpoolslots == POOLHANDLE_MAXSLOTS )
+			Sys_Error( "Mem_AllocPool: too many pools (allocpool at %s:%i)\n", filename, fileline );
+
+		if( numpoolslots == maxpoolslots )
+		{
+			poolslot_t *slots;
+
+			maxpoolslots = maxpoolslots ? maxpoolslots * 2 : 256;
+			slots = (poolslot_t *)realloc( poolslots, maxpoolslots * sizeof( *poolslots ));
+			if( slots == NULL )
+				Sys_Error( "Mem_AllocPool: out of memory (allocpool at %s:%i)\n", filename, fileline );
+			poolslots = slots;
+		}
+
+		index = numpoolslots++;
+		poolslots[index].generation = 0;
+	}
+
+	poolslots[index].pool = pool;
+	poolslots[index].nextfree = 0;
+
+	return ( poolslots[index].generation << POOLHANDLE_INDEXBITS ) | ( index + 1 );
+}
+
+static void Mem_FreePoolHandle( poolhandle_t poolptr )
+{
+	uint32_t index = ( poolptr & POOLHANDLE_MAXSLOTS ) - 1;
+
+	poolslots[index].pool = NULL;
+	poolslots[index].generation = ( poolslots[index].generation + 1 ) & POOLHANDLE_GENMASK;
+	poolslots[index].nextfree = 0;
+
+	if( lastfreepoolslot )
+		poolslots[lastfreepoolslot - 1].nextfree = index + 1;
+	else freepoolslot = index + 1;
+
+	lastfreepoolslot = index + 1;
+}
 #else
 static mempool_t *Mem_FindPool( poolhandle_t poolptr )
 {
@@ -93,6 +244,163 @@ static mempool_t *Mem_FindPool( poolhandle_t poolptr )
 }
 #endif
 
+#if XASH_ZONE_SLAB
+/*
+========================
+Mem_SlabClass
+
+slab class of the block with such data size, -1 for big blocks
+========================
+*/
+static int Mem_SlabClass( size_t size )
+{
+	size_t	blocksize = sizeof( memheader_t ) + size + 1; // sentinel2
+	int	i;
+
+	if( blocksize > MEMSLAB_MAXBLOCK )
+		return -1;
+
+	for( i = 0; ( 1U << ( MEMSLAB_MINSHIFT + i )) < blocksize; i++ );
+
+	return i;
+}
+
+static memchunk_t *Mem_AllocChunk( mempool_t *pool, size_t size, const char *filename, int fileline )
+{
+	memchunk_t *chunk;
+
+	size += sizeof( memchunk_t );
+	chunk = (memchunk_t *)Q_malloc( size );
+	if( chunk == NULL ) Sys_Error( "Mem_Alloc: out of memory (alloc at %s:%i)\n", filename, fileline );
+
+	chunk->size = size;
+	chunk->prev = NULL;
+	chunk->next = pool->chunks;
+	if( chunk->next ) chunk->next->prev = chunk;
+	pool->chunks = chunk;
+	pool->realsize += size;
+
+	return chunk;
+}
+
+static memheader_t *Mem_AllocBlock( mempool_t *pool, size_t size, const char *filename, int fileline )
+{
+	int		cls = Mem_SlabClass( size );
+	size_t		blocksize;
+	memheader_t	*mem;
+
+	// big blocks get their own chunk
+	if( cls < 0 )
+		return (memheader_t *)( Mem_AllocChunk( pool, sizeof( memheader_t ) + size + 1, filename, fileline ) + 1 );
+
+	if( pool->freeblocks[cls] )
+	{
+		mem = pool->freeblocks[cls];
+		pool->freeblocks[cls] = mem->next;
+		return mem;
+	}
+
+	blocksize = 1U << ( MEMSLAB_MINSHIFT + cls );
+
+	if( pool->slabptr[cls] == pool->slabend[cls] )
+	{
+		size_t count = (size_t)MEMSLAB_MINBLOCKS << pool->numslabs[cls];
+
+		if( count > MEMSLAB_CHUNK / blocksize )
+			count = MEMSLAB_CHUNK / blocksize;
+		pool->slabptr[cls] = (byte *)( Mem_AllocChunk( pool, count * blocksize, filename, fileline ) + 1 );
+		pool->slabend[cls] = pool->slabptr[cls] + count * blocksize;
+
+		// don't grow further once slabs are at max size
+		if(( MEMSLAB_MINBLOCKS << pool->numslabs[cls] ) * blocksize < MEMSLAB_CHUNK )
+			pool->numslabs[cls]++;
+	}
+
+	mem = (memheader_t *)pool->slabptr[cls];
+	pool->slabptr[cls] += blocksize;
+
+	return mem;
+}
+
+static void Mem_ReleaseBlock( mempool_t *pool, memheader_t *mem )
+{
+	int cls = Mem_SlabClass( mem->size );
+
+	if( cls < 0 )
+	{
+		memchunk_t *chunk = (memchunk_t *)mem - 1;
+
+		if( chunk->prev ) chunk->prev->next = chunk->next;
+		else pool->chunks = chunk->next;
+		if( chunk->next ) chunk->next->prev = chunk->prev;
+
+		pool->realsize -= chunk->size;
+		Q_free( chunk );
+		return;
+	}
+
+	// catch use after free
+	mem->sentinel1 = 0;
+	mem->prev = NULL;
+	mem->next = pool->freeblocks[cls];
+	pool->freeblocks[cls] = mem;
+}
+
+/*
+========================
+Mem_FreeChunks
+
+release everything owned by the pool at once
+========================
+*/
+static void Mem_FreeChunks( mempool_t *pool, const char *filename, int fileline )
+{
+	memheader_t *mem;
+
+	for( mem = pool->chain; mem; mem = mem->next )
+	{
+		Mem_CheckHeaderSentinels((void *)((byte *)mem + sizeof( memheader_t )), filename, fileline );
+
+		if( memprof.sites )
+			Mem_ProfileFree( mem );
+	}
+
+	while( pool->chunks )
+	{
+		memchunk_t *next = pool->chunks->next;
+
+		Q_free( pool->chunks );
+		pool->chunks = next;
+	}
+
+	pool->chain = NULL;
+	pool->totalsize = 0;
+	pool->realsize = sizeof( mempool_t );
+	memset( pool->freeblocks, 0, sizeof( pool->freeblocks ));
+	memset( pool->slabptr, 0, sizeof( pool->slabptr ));
+	memset( pool->slabend, 0, sizeof( pool->slabend ));
+	memset( pool->numslabs, 0, sizeof( pool->numslabs ));
+}
+#else // !XASH_ZONE_SLAB
+static memheader_t *Mem_AllocBlock( mempool_t *pool, size_t size, const char *filename, int fileline )
+{
+	memheader_t *mem;
+
+	// big allocations are not clumped
+	pool->realsize += sizeof( memheader_t ) + size + sizeof( size_t );
+	mem = (memheader_t *)Q_malloc( sizeof( memheader_t ) + size + sizeof( size_t ));
+	if( mem == NULL ) Sys_Error( "Mem_Alloc: out of memory (alloc at %s:%i)\n", filename, fileline );
+
+	return mem;
+}
+
+static void Mem_ReleaseBlock( mempool_t *pool, memheader_t *mem )
+{
+	pool->realsize -= sizeof( memheader_t ) + mem->size + sizeof( size_t );
+	Q_free( mem );
+}
+#endif // !XASH_ZONE_SLAB
+
 void *_Mem_Alloc( poolhandle_t poolptr, size_t size, qboolean clear, const char *filename, int fileline )
 {
 	memheader_t *mem;
@@ -104,11 +412,7 @@ void *_Mem_Alloc( poolhandle_t poolptr, size_t size, qboolean clear, const char
 	pool = Mem_FindPool( poolptr );
 
 	pool->totalsize += size;
-
-	// big allocations are not clumped
-	pool->realsize += sizeof( memheader_t ) + size + sizeof( size_t );
-	mem = (memheader_t *)Q_malloc( sizeof( memheader_t ) + size + sizeof( size_t ));
-	if( mem == NULL ) Sys_Error( "Mem_Alloc: out of memory (alloc at %s:%i)\n", filename, fileline );
+	mem = Mem_AllocBlock( pool, size, filename, fileline );
 
 	mem->filename = filename;
 	mem->fileline = fileline;
@@ -126,9 +430,411 @@ void *_Mem_Alloc( poolhandle_t poolptr, size_t size, qboolean clear, const char
 	if( clear )
 		memset((void *)((byte *)mem + sizeof( memheader_t )), 0, mem->size );
 
+	if( memprof.sites )
+		Mem_ProfileAlloc( mem, false );
+
 	return (void *)((byte *)mem + sizeof( memheader_t ));
 }
 
+/*
+========================
+Mem_ProfileSite
+
+counters of the call site, NULL if table is full
+========================
+*/
+static memsite_t *Mem_ProfileSite( const char *filename, int fileline )
+{
+	uint	hash = (uint)((size_t)filename >> 3 ) ^ ((uint)fileline * 2654435761U );
+	int	i;
+
+	for( i = 0; i < MEMPROF_SITES; i++, hash++ )
+	{
+		memsite_t *site = &memprof.sites[hash & ( MEMPROF_SITES - 1 )];
+
+		if( site->filename == filename && site->fileline == fileline )
+			return site;
+
+		if( !site->filename )
+		{
+			// keep a few free entries so lookups of unknown sites stop early
+			if( memprof.numsites >= MEMPROF_SITES - MEMPROF_SITES / 8 )
+				return NULL;
+
+			site->filename = filename;
+			site->fileline = fileline;
+			site->frame = -1;
+			memprof.numsites++;
+			return site;
+		}
+	}
+
+	return NULL;
+}
+
+static void Mem_ProfileAlloc( const memheader_t *mem, qboolean seed )
+{
+	memsite_t *site = Mem_ProfileSite( mem->filename, mem->fileline );
+
+	if( !site )
+	{
+		memprof.dropped++;
+		return;
+	}
+
+	site->live += mem->size;
+	site->liveblocks++;
+	if( site->peak < site->live )
+		site->peak = site->live;
+
+	// blocks that existed before profiling was started aren't new allocations
+	if( seed )
+		return;
+
+	site->allocs++;
+	site->allocbytes += mem->size;
+
+	if( site->frame != memprof.frame )
+	{
+		site->frame = memprof.frame;
+		site->frameallocs = 0;
+	}
+
+	site->frameallocs++;
+	if( site->maxframeallocs < site->frameallocs )
+		site->maxframeallocs = site->frameallocs;
+}
+
+static void Mem_ProfileFree( const memheader_t *mem )
+{
+	memsite_t *site = Mem_ProfileSite( mem->filename, mem->fileline );
+
+	if( !site || !site->liveblocks )
+		return;
+
+	site->live -= site->live > mem->size ? mem->size : site->live;
+	site->liveblocks--;
+	site->frees++;
+}
+
+/*
+========================
+Mem_ProfileEnable
+
+counters start from scratch, live memory of existing blocks is counted
+========================
+*/
+void Mem_ProfileEnable( qboolean enable )
+{
+	mempool_t	*pool;
+	memheader_t	*mem;
+
+	if( memprof.sites )
+		Q_free( memprof.sites );
+
+	memset( &memprof, 0, sizeof( memprof ));
+
+	if( !enable )
+		return;
+
+	memprof.sites = (memsite_t *)Q_malloc( MEMPROF_SITES * sizeof( memsite_t ));
+	if( !memprof.sites )
+	{
+		Con_Printf( S_ERROR "%s: out of memory\n", __func__ );
+		return;
+	}
+
+	memset( memprof.sites, 0, MEMPROF_SITES * sizeof( memsite_t ));
+	memprof.starttime = Sys_DoubleTime();
+
+	for( pool = poolchain; pool; pool = pool->next )
+	{
+		for( mem = pool->chain; mem; mem = mem->next )
+			Mem_ProfileAlloc( mem, true );
+	}
+}
+
+qboolean Mem_ProfileEnabled( void )
+{
+	return memprof.sites != NULL;
+}
+
+static int memprof_sortkey;
+
+static int Mem_ProfileCompare( const void *a, const void *b )
+{
+	const memsite_t *s1 = *(const memsite_t **)a, *s2 = *(const memsite_t **)b;
+	size_t v1, v2;
+
+	switch( memprof_sortkey )
+	{
+	case MEMPROF_SORT_ALLOCS: v1 = s1->allocs; v2 = s2->allocs; break;
+	case MEMPROF_SORT_FRAME: v1 = s1->maxframeallocs; v2 = s2->maxframeallocs; break;
+	case MEMPROF_SORT_PEAK: v1 = s1->peak; v2 = s2->peak; break;
+	default: v1 = s1->live; v2 = s2->live; break;
+	}
+
+	if( v1 != v2 )
+		return v1 < v2 ? 1 : -1;
+
+	return s1->fileline - s2->fileline;
+}
+
+/*
+========================
+Mem_ProfileSorted
+
+array of used sites, must be freed by caller
+========================
+*/
+static memsite_t **Mem_ProfileSorted( int sortkey, int *count )
+{
+	memsite_t	**sorted;
+	int	i;
+
+	*count = 0;
+
+	if( !memprof.sites || !( sorted = (memsite_t **)Q_malloc( MEMPROF_SITES * sizeof( *sorted ))))
+		return NULL;
+
+	for( i = 0; i < MEMPROF_SITES; i++ )
+	{
+		if( memprof.sites[i].filename )
+			sorted[(*count)++] = &memprof.sites[i];
+	}
+
+	memprof_sortkey = sortkey;
+	qsort( sorted, *count, sizeof( *sorted ), Mem_ProfileCompare );
+
+	return sorted;
+}
+
+/*
+========================
+Mem_ProfilePrint
+========================
+*/
+void Mem_ProfilePrint( int count, int sortkey )
+{
+	memsite_t	**sorted;
+	int	i, numsorted;
+	int	frames = memprof.frame > 0 ? memprof.frame : 1;
+
+	if( !( sorted = Mem_ProfileSorted( sortkey, &numsorted )))
+	{
+		Con_Printf( "memory profiling is disabled\n" );
+		return;
+	}
+
+	Con_Printf( "%d call sites, %d frames in %.1f seconds\n", numsorted, memprof.frame, Sys_DoubleTime() - memprof.starttime );
+	Con_Printf( "^3%10s %10s %8s %10s %8s %9s %8s  site\n", "live", "peak", "blocks", "allocs", "frees", "per frame", "max" );
+
+	for( i = 0; i < numsorted && i < count; i++ )
+	{
+		const memsite_t *site = sorted[i];
+
+		Con_Printf( "%10s ", Q_memprint( site->live ));
+		Con_Printf( "%10s %8lu %10lu %8lu %9.1f %8lu  %s:%i\n", Q_memprint( site->peak ), (unsigned long)site->liveblocks,
+			(unsigned long)site->allocs, (unsigned long)site->frees, (double)site->allocs / frames,
+			(unsigned long)site->maxframeallocs, site->filename, site->fileline );
+	}
+
+	if( memprof.dropped )
+		Con_Printf( S_WARN "%d allocations weren't counted, too many call sites\n", memprof.dropped );
+
+	Q_free( sorted );
+}
+
+/*
+========================
+Mem_ProfileWriteCSV
+
+snapshot of all sites for external tools
+========================
+*/
+qboolean Mem_ProfileWriteCSV( const char *filename )
+{
+	memsite_t	**sorted;
+	int	i, numsorted;
+	int	frames = memprof.frame > 0 ? memprof.frame : 1;
+	file_t	*f;
+
+	if( !( sorted = Mem_ProfileSorted( MEMPROF_SORT_LIVE, &numsorted )))
+		return false;
+
+	if( !( f = FS_Open( filename, "w", false )))
+	{
+		Q_free( sorted );
+		return false;
+	}
+
+	FS_Printf( f, "file,line,live_bytes,peak_bytes,live_blocks,allocs,frees,alloc_bytes,allocs_per_frame,max_allocs_per_frame\n" );
+
+	for( i = 0; i < numsorted; i++ )
+	{
+		const memsite_t *site = sorted[i];
+
+		FS_Printf( f, "%s,%i,%lu,%lu,%lu,%lu,%lu,%lu,%.3f,%lu\n", site->filename, site->fileline,
+			(unsigned long)site->live, (unsigned long)site->peak, (unsigned long)site->liveblocks,
+			(unsigned long)site->allocs, (unsigned long)site->frees, (unsigned long)site->allocbytes,
+			(double)site->allocs / frames, (unsigned long)site->maxframeallocs );
+	}
+
+	FS_Close( f );
+	Q_free( sorted );
+
+	return true;
+}
+
+/*
+========================
+_Mem_FrameAlloc
+
+transient memory, valid until Mem_FrameReset at the end of the frame
+========================
+*/
+void *_Mem_FrameAlloc( size_t size, qboolean clear, const char *filename, int fileline )
+{
+	memframechunk_t	*chunk = memframe.current;
+	byte		*data;
+
+	if( !size ) return NULL;
+
+	size = MEMFRAME_ALIGN( size );
+
+	if( !chunk || chunk->size - chunk->used < size )
+	{
+		// next chunk is reused if it's big enough, otherwise a new one is linked before it
+		if( chunk && chunk->next && chunk->next->size >= size )
+		{
+			chunk = chunk->next;
+		}
+		else if( !chunk && memframe.chunks && memframe.chunks->size >= size )
+		{
+			chunk = memframe.chunks;
+		}
+		else
+		{
+			memframechunk_t *newchunk;
+			size_t chunksize = size > MEMFRAME_CHUNK ? size : MEMFRAME_CHUNK;
+
+			newchunk = (memframechunk_t *)Q_malloc( sizeof( memframechunk_t ) + chunksize );
+			if( newchunk == NULL ) Sys_Error( "Mem_FrameAlloc: out of memory (alloc at %s:%i)\n", filename, fileline );
+
+			newchunk->size = chunksize;
+			newchunk->used = 0;
+
+			if( chunk )
+			{
+				newchunk->next = chunk->next;
+				chunk->next = newchunk;
+			}
+			else
+			{
+				newchunk->next = memframe.chunks;
+				memframe.chunks = newchunk;
+			}
+
+			memframe.reserved += chunksize;
+			chunk = newchunk;
+		}
+
+		memframe.current = chunk;
+	}
+
+	data = (byte *)( chunk + 1 ) + chunk->used;
+	chunk->used += size;
+	memframe.used += size;
+	memframe.allocs++;
+
+	if( memframe.peak < memframe.used )
+		memframe.peak = memframe.used;
+
+	if( clear )
+		memset( data, 0, size );
+
+	return data;
+}
+
+/*
+========================
+Mem_FrameTrim
+
+free chunks that don't fit into keep bytes, biggest ones
+are usually left by a single frame like level loading
+========================
+*/
+static void Mem_FrameTrim( size_t keep )
+{
+	memframechunk_t	**prev = &memframe.chunks;
+	memframechunk_t	*chunk;
+	size_t		kept = 0;
+
+	while(( chunk = *prev ) != NULL )
+	{
+		if( kept + chunk->size <= keep )
+		{
+			kept += chunk->size;
+			prev = &chunk->next;
+			continue;
+		}
+
+		*prev = chunk->next;
+		memframe.reserved -= chunk->size;
+		Q_free( chunk );
+	}
+}
+
+/*
+========================
+Mem_FrameReset
+
+release all frame memory, poison it to catch pointers kept across frames
+========================
+*/
+void Mem_FrameReset( qboolean poison )
+{
+	memframechunk_t *chunk;
+
+	for( chunk = memframe.chunks; chunk; chunk = chunk->next )
+	{
+		if( poison && chunk->used )
+			memset( chunk + 1, MEMFRAME_POISON, chunk->used );
+
+		chunk->used = 0;
+
+		if( chunk == memframe.current )
+			break;
+	}
+
+	if( memprof.sites )
+		memprof.frame++;
+
+	memframe.current = NULL;
+	memframe.lastused = memframe.used;
+	memframe.used = 0;
+	memframe.allocs = 0;
+
+	if( memframe.recent < memframe.lastused )
+		memframe.recent = memframe.lastused;
+
+	// don't keep the memory of one heavy frame forever
+	if( memframe.reserved > MEMFRAME_CHUNK && memframe.recent * 2 < memframe.reserved )
+	{
+		if( ++memframe.quietframes >= MEMFRAME_TRIM_FRAMES )
+		{
+			Mem_FrameTrim( memframe.recent > MEMFRAME_CHUNK ? memframe.recent : MEMFRAME_CHUNK );
+			memframe.quietframes = 0;
+			memframe.recent = 0;
+		}
+	}
+	else
+	{
+		memframe.quietframes = 0;
+		memframe.recent = 0;
+	}
+}
+
 static const char *Mem_CheckFilename( const char *filename )
 {
 	static const char	*dummy = "<corrupted>\0";
@@ -174,11 +880,12 @@ static void Mem_FreeBlock( memheader_t *mem, const char *filename, int fileline
 	if( mem->next )
 		mem->next->prev = mem->prev;
 
+	if( memprof.sites )
+		Mem_ProfileFree( mem );
+
 	// memheader has been unlinked, do the actual free now
 	pool->totalsize -= mem->size;
-
-	pool->realsize -= sizeof( memheader_t ) + mem->size + sizeof( size_t );
-	Q_free( mem );
+	Mem_ReleaseBlock( pool, mem );
 }
 
 void _Mem_Free( void *data, const char *filename, int fileline )
@@ -198,6 +905,30 @@ void *_Mem_Realloc( poolhandle_t poolptr, void *memptr, size_t size, qboolean cl
 	{
 		memhdr = (memheader_t *)((byte *)memptr - sizeof( memheader_t ));
 		if( size == memhdr->size ) return memptr;
+
+#if XASH_ZONE_SLAB
+		// still fits into the same slab block
+		if( poolptr && memhdr->pool == Mem_FindPool( poolptr ) && Mem_SlabClass( size ) >= 0
+			&& Mem_SlabClass( size ) == Mem_SlabClass( memhdr->size ))
+		{
+			Mem_CheckHeaderSentinels( memptr, filename, fileline );
+
+			if( clear && size > memhdr->size )
+				memset((byte *)memptr + memhdr->size, 0, size - memhdr->size );
+
+			// counted as free and allocation of new size by the same site
+			if( memprof.sites )
+				Mem_ProfileFree( memhdr );
+
+			memhdr->pool->totalsize += size - memhdr->size;
+			memhdr->size = size;
+
+			if( memprof.sites )
+				Mem_ProfileAlloc( memhdr, false );
+			*((byte *)memptr + size ) = MEMHEADER_SENTINEL2;
+			return memptr;
+		}
+#endif
 	}
 
 	nb = _Mem_Alloc( poolptr, size, clear, filename, fileline );
@@ -237,7 +968,7 @@ poolhandle_t _Mem_AllocPool( const char *name, const char *filename, int filelin
 	poolchain = pool;
 	
 #if XASH_64BIT
-	pool->idx = ++lastidx;
+	pool->idx = Mem_AllocPoolHandle( pool, filename, fileline );
 	return pool->idx;
 #else
 	return (poolhandle_t)pool;
@@ -259,8 +990,15 @@ void _Mem_FreePool( poolhandle_t *poolptr, const char *filename, int fileline )
 		*chainaddress = pool->next;
 
 		// free memory owned by the pool
+#if XASH_ZONE_SLAB
+		Mem_FreeChunks( pool, filename, fileline );
+#else
 		while( pool->chain ) Mem_FreeBlock( pool->chain, filename, fileline );
+#endif
 		// free the pool itself
+#if XASH_64BIT
+		Mem_FreePoolHandle( pool->idx );
+#endif
 		memset( pool, 0xBF, sizeof( mempool_t ));
 		Q_free( pool );
 		*poolptr = 0;
@@ -276,7 +1014,11 @@ void _Mem_EmptyPool( poolhandle_t poolptr, const char *filename, int fileline )
 	if( pool->sentinel2 != MEMHEADER_SENTINEL1 ) Sys_Error( "Mem_EmptyPool: trashed pool sentinel 2 (allocpool at %s:%i, emptypool at %s:%i)\n", pool->filename, pool->fileline, filename, fileline );
 
 	// free memory owned by the pool
+#if XASH_ZONE_SLAB
+	Mem_FreeChunks( pool, filename, fileline );
+#else
 	while( pool->chain ) Mem_FreeBlock( pool->chain, filename, fileline );
+#endif
 }
 
 static qboolean Mem_CheckAlloc( mempool_t *pool, void *data )
@@ -368,6 +1110,9 @@ void Mem_PrintStats( void )
 
 	Con_Printf( "^3%lu^7 memory pools, totalling: ^1%s\n", count, Q_memprint( size ));
 	Con_Printf( "total allocated size: ^1%s\n", Q_memprint( realsize ));
+	Con_Printf( "frame memory: ^1%s^7 last frame, ", Q_memprint( memframe.lastused ));
+	Con_Printf( "^1%s^7 peak, ", Q_memprint( memframe.peak ));
+	Con_Printf( "^1%s^7 reserved\n", Q_memprint( memframe.reserved ));
 }
 
 void Mem_PrintList( size_t minallocationsize )
@@ -411,3 +1156,177 @@ void Memory_Init( void )
 {
 	poolchain = NULL; // init mem chain
 }
+
+#if XASH_ENGINE_TESTS
+#include "tests.h"
+
+void Test_RunZone( void )
+{
+	poolhandle_t pool = Mem_AllocPool( "zone test" );
+	byte *blocks[512];
+	int i, j;
+
+	for( i = 0; i < 512; i++ )
+	{
+		size_t size = ( i * 37 ) % 6000 + 1; // small and big blocks
+
+		blocks[i] = Mem_Malloc( pool, size );
+		memset( blocks[i], i & 0xFF, size );
+	}
+
+	TASSERT( Mem_IsAllocatedExt( pool, blocks[100] ));
+
+	// freed blocks are reused
+	for( i = 0; i < 512; i += 2 )
+		Mem_Free( blocks[i] );
+
+	TASSERT( !Mem_IsAllocatedExt( pool, blocks[100] ));
+
+	for( i = 0; i < 512; i += 2 )
+		blocks[i] = Mem_Calloc( pool, ( i * 37 ) % 6000 + 1 );
+
+	// in place growth keeps contents and clears the tail
+	blocks[1] = Mem_Realloc( pool, blocks[1], 40 );
+	TASSERT( blocks[1][37] == 1 && blocks[1][38] == 0 && blocks[1][39] == 0 );
+
+	// move from slab to big block
+	blocks[3] = Mem_Realloc( pool, blocks[3], 10000 );
+	TASSERT( blocks[3][111] == 3 && blocks[3][112] == 0 );
+
+	for( i = 5; i < 512; i += 2 )
+	{
+		size_t size = ( i * 37 ) % 6000 + 1;
+
+		for( j = 0; j < size; j++ )
+		{
+			if( blocks[i][j] != ( i & 0xFF ))
+				break;
+		}
+
+		TASSERT( j == size );
+	}
+
+	Mem_Check();
+
+	// pool is usable after emptying
+	Mem_EmptyPool( pool );
+	TASSERT( !Mem_IsAllocatedExt( pool, blocks[5] ));
+	blocks[0] = Mem_Calloc( pool, 100 );
+	TASSERT( Mem_IsAllocatedExt( pool, blocks[0] ) && blocks[0][99] == 0 );
+
+	Mem_FreePool( &pool );
+	TASSERT( pool == 0 );
+
+	// frame memory
+	Mem_FrameReset( false );
+	blocks[0] = Mem_FrameAlloc( 3 );
+	blocks[1] = Mem_FrameAlloc( 100 );
+	blocks[2] = Mem_FrameAlloc( MEMFRAME_CHUNK * 2 ); // doesn't fit into first chunk
+	blocks[3] = Mem_FrameCalloc( 100 );
+	TASSERT((((size_t)blocks[1] | (size_t)blocks[2] | (size_t)blocks[3] ) & 15 ) == 0 );
+	TASSERT( blocks[1] == blocks[0] + 16 && blocks[3][99] == 0 );
+	memset( blocks[2], 1, MEMFRAME_CHUNK * 2 );
+	Mem_FrameReset( true );
+	TASSERT( blocks[1][0] == MEMFRAME_POISON && memframe.lastused >= MEMFRAME_CHUNK * 2 );
+
+	// same memory is used again
+	TASSERT( Mem_FrameAlloc( 8 ) == blocks[0] );
+	TASSERT( Mem_FrameAlloc( MEMFRAME_CHUNK * 2 ) == blocks[2] );
+	Mem_FrameReset( false );
+
+	// chunks of a heavy frame are freed when usage stays low
+	Mem_FrameAlloc( MEMFRAME_CHUNK * 4 );
+	Mem_FrameReset( false );
+	TASSERT( memframe.reserved > MEMFRAME_CHUNK * 4 );
+
+	for( i = 0; i < MEMFRAME_TRIM_FRAMES; i++ )
+	{
+		Mem_FrameAlloc( 100 );
+		Mem_FrameReset( false );
+	}
+
+	TASSERT( memframe.reserved <= MEMFRAME_CHUNK );
+	TASSERT( Mem_FrameAlloc( 100 ) != NULL );
+	Mem_FrameReset( false );
+
+	// allocation profiler
+	pool = Mem_AllocPool( "zone test" );
+	blocks[0] = Mem_Malloc( pool, 1000 ); // existing blocks are seeded
+	Mem_ProfileEnable( true );
+
+	for( j = 0; j < 2; j++ )
+	{
+		for( i = 1; i < 11; i++ )
+			blocks[i] = Mem_Malloc( pool, 100 * i );
+		Mem_FrameReset( false );
+	}
+
+	for( i = 1; i < 6; i++ )
+		Mem_Free( blocks[i] );
+
+	{
+		const memsite_t *site = NULL, *seeded = NULL;
+
+		for( i = 0; i < MEMPROF_SITES; i++ )
+		{
+			if( !memprof.sites[i].filename || Q_strcmp( memprof.sites[i].filename, __FILE__ ))
+				continue;
+
+			if( memprof.sites[i].allocs == 20 )
+				site = &memprof.sites[i];
+			else if( memprof.sites[i].live == 1000 )
+				seeded = &memprof.sites[i];
+		}
+
+		TASSERT( site && site->frees == 5 && site->liveblocks == 15 && site->maxframeallocs == 10 );
+		TASSERT( site && site->live == 5500 + 4000 && site->peak == 11000 && site->allocbytes == 11000 );
+		TASSERT( seeded && seeded->allocs == 0 && seeded->liveblocks == 1 );
+	}
+
+	// pool teardown frees everything
+	Mem_FreePool( &pool );
+	for( i = 0, j = 0; i < MEMPROF_SITES; i++ )
+	{
+		if( memprof.sites[i].filename && !Q_strcmp( memprof.sites[i].filename, __FILE__ ))
+			j += memprof.sites[i].live != 0;
+	}
+	TASSERT( j == 0 );
+	Mem_ProfileEnable( false );
+
+#if XASH_64BIT
+	{
+		poolhandle_t stale[2], *pools;
+		int numpools = 0, reused = -1;
+
+		// freed slots are reused in the order they were freed
+		stale[0] = Mem_AllocPool( "zone test" );
+		stale[1] = Mem_AllocPool( "zone test" );
+		pool = stale[0];
+		Mem_FreePool( &pool );
+		pool = stale[1];
+		Mem_FreePool( &pool );
+
+		pools = (poolhandle_t *)Q_malloc(( numpoolslots + 1 ) * sizeof( *pools ));
+
+		while( reused < 0 && numpools <= numpoolslots )
+		{
+			pool = pools[numpools++] = Mem_AllocPool( "zone test" );
+
+			for( i = 0; i < 2; i++ )
+			{
+				if(( pool & POOLHANDLE_MAXSLOTS ) == ( stale[i] & POOLHANDLE_MAXSLOTS ))
+					reused = i;
+			}
+		}
+
+		// reused slot gets different handle
+		TASSERT( reused == 0 && pool != stale[0] );
+		Mem_Free( Mem_Malloc( pool, 16 ));
+
+		for( i = 0; i < numpools; i++ )
+			Mem_FreePool( &pools[i] );
+		Q_free( pools );
+	}
+#endif
+}
+#endif /* XASH_ENGINE_TESTS */
@@ -18,7 +18,8 @@ GNU General Public License for more details.
 
 #include "eiface.h" // offsetof
 
-#define SV_PHYSICS_INTERFACE_VERSION	6
+#define SV_PHYSICS_INTERFACE_VERSION	7
+#define SV_PHYSICS_INTERFACE_VERSION_MIN	6	// before pfnTraceBatch was added
 
 #define STRUCT_FROM_LINK( l, t, m )	((t *)((byte *)l - offsetof(t, m)))
 #define EDICT_FROM_AREA( l )		STRUCT_FROM_LINK( l, edict_t, area )
@@ -50,6 +51,20 @@ GNU General Public License for more details.
 #define LUMP_SAVE_NO_DATA		7
 #define LUMP_SAVE_CORRUPTED		8
 
+#define MAX_TRACE_BATCH		64	// traces processed at once by pfnTraceBatch
+
+// single trace for pfnTraceBatch, same args as pfnTrace have
+typedef struct trace_request_s
+{
+	vec3_t		start;
+	vec3_t		end;
+	vec3_t		mins;
+	vec3_t		maxs;
+	int		type;
+	edict_t		*ignore;
+	qboolean		monsterclip;	// same as SV_Move gets for FL_MONSTERCLIP movers
+} trace_request_t;
+
 typedef struct areanode_s
 {
 	int		axis;		// -1 = leaf node
@@ -108,6 +123,10 @@ typedef struct server_physics_api_s
 	const byte	*(*pfnLoadImagePixels)( const char *filename, int *width, int *height );
 
 	const char*	(*pfnGetModelName)( int modelindex );
+
+	// same as pfnTrace for every request, but entities are gathered only once for all traces
+	// interface version 7 and above
+	void		(*pfnTraceBatch)( const trace_request_t *reqs, trace_t *out, int count );
 } server_physics_api_t;
 
 // physic callbacks
@@ -458,6 +458,12 @@ extern convar_t		sv_cheats;
 extern convar_t		public_server;
 extern convar_t		sv_nat;
 extern convar_t		sv_speedhack_kick;
+extern convar_t		sv_entvis_cache;
+extern convar_t		sv_parallel_snapshots;
+extern convar_t		sv_delta_cache;
+extern convar_t		sv_world_tree;
+extern convar_t		sv_entity_index;
+extern convar_t		sv_spatial_queries;
 extern convar_t		sv_pausable;		// allows pause in multiplayer
 extern convar_t		sv_check_errors;
 extern convar_t		sv_reconnect_limit;
@@ -503,7 +509,7 @@ void SV_FreeClients( void );
 //
 // sv_init.c
 //
-qboolean CRC32_MapFile( dword *crcvalue, const char *filename, qboolean multiplayer );
+qboolean CRC32_MapFile( dword *crcvalue, const char *filename, qboolean multiplayer, qboolean cached );
 qboolean SV_InitGame( void );
 void SV_ActivateServer( int runPhysics );
 qboolean SV_SpawnServer( const char *server, const char *startspot, qboolean background );
@@ -604,6 +610,8 @@ int SV_FindBestBaselineForStatic( int index, entity_state_t **baseline, entity_s
 void SV_WriteFrameToClient( sv_client_t *client, sizebuf_t *msg );
 void SV_BuildClientFrame( sv_client_t *client );
 void SV_SkipUpdates( void );
+void SV_DeltaCacheStats_f( void );
+sv_client_t *SV_CurrentClient( void );
 
 //
 // sv_game.c
@@ -622,6 +630,7 @@ void SV_PlaybackEventFull( int flags, const edict_t *pInvoker, word eventindex,
 	float *angles, float fparam1, float fparam2, int iparam1, int iparam2, int bparam1, int bparam2 );
 int SV_BuildSoundMsg( sizebuf_t *msg, edict_t *ent, int chan, const char *sample, int vol, float attn, int flags, int pitch, const vec3_t pos );
 qboolean SV_BoxInPVS( const vec3_t org, const vec3_t absmin, const vec3_t absmax );
+int SV_CheckVisibility( const edict_t *ent, byte *pset );
 void SV_QueueChangeLevel( const char *level, const char *landname );
 void SV_WriteEntityPatch( const char *filename );
 void SV_SpawnEntities( const char *mapname );
@@ -634,6 +643,7 @@ void SV_EmptyStringPool( void );
 #ifdef XASH_64BIT
 void SV_PrintStr64Stats_f( void );
 #endif
+void SV_EntityIndexStats_f( void );
 sv_client_t *SV_ClientFromEdict( const edict_t *pEdict, qboolean spawned_only );
 uint SV_MapIsValid( const char *filename, const char *spawn_entity, const char *landmark_name );
 void SV_StartSound( edict_t *ent, int chan, const char *sample, float vol, float attn, int flags, int pitch );
@@ -680,16 +690,23 @@ void SV_RunCmd( sv_client_t *cl, usercmd_t *ucmd, int random_seed );
 // sv_world.c
 //
 void SV_ClearWorld( void );
+void SV_RebuildWorldTree( void );
+void SV_TraceBench_f( void );
 void SV_UnlinkEdict( edict_t *ent );
 void SV_ClipMoveToEntity( edict_t *ent, const vec3_t start, vec3_t mins, vec3_t maxs, const vec3_t end, trace_t *trace );
 void SV_CustomClipMoveToEntity( edict_t *ent, const vec3_t start, vec3_t mins, vec3_t maxs, const vec3_t end, trace_t *trace );
 trace_t SV_TraceHull( edict_t *ent, int hullNum, const vec3_t start, vec3_t mins, vec3_t maxs, const vec3_t end );
 trace_t SV_Move( const vec3_t start, vec3_t mins, vec3_t maxs, const vec3_t end, int type, edict_t *e, qboolean monsterclip );
+void SV_MoveBatch( const trace_request_t *reqs, trace_t *out, int count );
 trace_t SV_MoveNoEnts( const vec3_t start, vec3_t mins, vec3_t maxs, const vec3_t end, int type, edict_t *e );
 const char *SV_TraceTexture( edict_t *ent, const vec3_t start, const vec3_t end );
 msurface_t *SV_TraceSurface( edict_t *ent, const vec3_t start, const vec3_t end );
 trace_t SV_MoveToss( edict_t *tossent, edict_t *ignore );
 void SV_LinkEdict( edict_t *ent, qboolean touch_triggers );
+void SV_EdictGridLink( edict_t *ent );
+void SV_EdictGridUnlink( edict_t *ent );
+int SV_EdictGridQuery( const vec3_t mins, const vec3_t maxs, int *list, int maxcount );
+uint SV_EdictGridGeneration( void );
 int SV_TruePointContents( const vec3_t p );
 int SV_PointContents( const vec3_t p );
 void SV_SetLightStyle( int style, const char* s, float f );
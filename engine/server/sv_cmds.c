@@ -1012,6 +1012,9 @@ void SV_InitOperatorCommands( void )
 	Cmd_AddCommand( "entpatch", SV_EntPatch_f, "write entity patch to allow external editing" );
 	Cmd_AddCommand( "edict_usage", SV_EdictUsage_f, "show info about edicts usage" );
 	Cmd_AddCommand( "entity_info", SV_EntityInfo_f, "show more info about edicts" );
+	Cmd_AddCommand( "delta_cache_stats", SV_DeltaCacheStats_f, "show entity delta cache hits and misses, 'reset' to clear counters" );
+	Cmd_AddCommand( "entity_index_stats", SV_EntityIndexStats_f, "show FindEntityByString index usage" );
+	Cmd_AddCommand( "trace_bench", SV_TraceBench_f, "measure trace throughput on current map, optional traces count and 'batch' to compare with batched traces" );
 	Cmd_AddCommand( "shutdownserver", SV_KillServer_f, "shutdown current server" );
 	Cmd_AddCommand( "changelevel", SV_ChangeLevel_f, "change level" );
 	Cmd_AddCommand( "changelevel2", SV_ChangeLevel2_f, "smooth change level" );
@@ -1050,6 +1053,9 @@ void SV_KillOperatorCommands( void )
 	Cmd_RemoveCommand( "entpatch" );
 	Cmd_RemoveCommand( "edict_usage" );
 	Cmd_RemoveCommand( "entity_info" );
+	Cmd_RemoveCommand( "delta_cache_stats" );
+	Cmd_RemoveCommand( "trace_bench" );
+	Cmd_RemoveCommand( "entity_index_stats" );
 	Cmd_RemoveCommand( "shutdownserver" );
 	Cmd_RemoveCommand( "changelevel" );
 	Cmd_RemoveCommand( "changelevel2" );
@@ -217,7 +217,12 @@ void SV_TransferConsistencyInfo( void )
 			Q_snprintf( filepath, sizeof( filepath ), DEFAULT_SOUNDPATH "%s", pResource->szFileName );
 		else Q_strncpy( filepath, pResource->szFileName, sizeof( filepath ));
 
-		MD5_HashFile( pResource->rgucMD5_hash, filepath, NULL );
+		// server's own files, so digest cache can be used here
+		if( !FS_GetCachedHash( filepath, FS_HASH_MD5, pResource->rgucMD5_hash, sizeof( pResource->rgucMD5_hash )))
+		{
+			if( MD5_HashFile( pResource->rgucMD5_hash, filepath, NULL ))
+				FS_SetCachedHash( filepath, FS_HASH_MD5, pResource->rgucMD5_hash, sizeof( pResource->rgucMD5_hash ));
+		}
 
 		if( pResource->type == t_model )
 		{
@@ -17,6 +17,14 @@ GNU General Public License for more details.
 #include "server.h"
 #include "const.h"
 #include "net_encode.h"
+#include "threads.h"
+
+#define MAX_PINGS_BUFFER	256	// svc_pings for MAX_CLIENTS
+#define MAX_VISCACHE_ENTRIES	64
+#define DELTACACHE_HASH_SIZE	4096	// must be power of two
+#define DELTACACHE_MAX_PROBES	8
+#define DELTACACHE_DATA_SIZE	0x40000	// encoded bits storage per worker
+#define DELTACACHE_MAX_DELTA	2048	// biggest entity delta that can be cached
 
 typedef struct
 {
@@ -25,9 +33,203 @@ typedef struct
 	byte		sended[MAX_EDICTS_BYTES];
 } sv_ents_t;
 
+// client snapshot that was gathered but not encoded yet
+typedef struct
+{
+	sv_client_t	*cl;
+	client_frame_t	*from;
+	client_frame_t	*to;
+	sizebuf_t		msg;
+	sizebuf_t		pings;
+	byte		pings_buf[MAX_PINGS_BUFFER];
+	qboolean		send_pings;
+} sv_snapshot_t;
+
+static struct
+{
+	sv_snapshot_t	snapshots[MAX_CLIENTS];
+	byte		*msg_bufs;	// MAX_CLIENTS * MAX_DATAGRAM
+	int		num_snapshots;
+	int		oldest_entity;	// oldest packet entity referenced by pending snapshots
+} sv_snapshots;
+
+// entities that passed engine visibility test for given PVS and PHS,
+// shared between all clients with identical view within one frame
+typedef struct
+{
+	uint32_t		checksum;
+	byte		*pvs;
+	byte		*phs;
+	qboolean		has_phs;
+	short		*ents;
+	int		num_ents;
+} sv_viscache_t;
+
+static struct
+{
+	sv_viscache_t	entries[MAX_VISCACHE_ENTRIES];
+	int		num_entries;
+	int		allocated;	// entries with allocated buffers
+	size_t		fatbytes;	// size of pvs and phs copies
+	int		maxents;	// size of ents arrays
+} sv_viscache;
+
+// encoded entity delta, shared between all clients that
+// have the same from and to states within one frame
+typedef struct
+{
+	const entity_state_t	*from;
+	const entity_state_t	*to;
+	uint32_t		hash;
+	int		frame;		// sv_deltacache.frame when it was encoded
+	int		written_at;	// svs.next_client_entities when it was encoded
+	int		delta_type;
+	int		baseline;
+	qboolean		force;
+	int		player;		// for game dll encoders, -1 if delta is the same for everyone
+	int		numbits;
+	int		offset;		// in data buffer
+} sv_deltaentry_t;
+
+// every worker has it's own cache, so no locking is needed
+typedef struct
+{
+	sv_deltaentry_t	*entries;		// DELTACACHE_HASH_SIZE
+	byte		*data;		// DELTACACHE_DATA_SIZE
+	int		datasize;
+	int		frame;		// data was reset at this frame
+	size_t		hits;
+	size_t		misses;
+	size_t		uncached;		// not stored because cache is full
+} sv_deltacache_t;
+
+static struct
+{
+	sv_deltacache_t	workers[MAX_WORKER_THREADS];
+	int		frame;
+} sv_deltacache;
+
+// client whose snapshot is encoded by this thread, sv.current_client
+// can't be used for that when snapshots are encoded in parallel
+static XASH_THREAD_LOCAL sv_client_t *sv_encoding_client;
+
 int	c_fullsend;	// just a debug counter
 int	c_notsend;
 
+/*
+=======================
+SV_ClearVisCache
+
+called once per frame, before any snapshot is built
+=======================
+*/
+static void SV_ClearVisCache( void )
+{
+	int	i;
+
+	sv_viscache.num_entries = 0;
+
+	if( sv_viscache.fatbytes == world.fatbytes && sv_viscache.maxents == GI->max_edicts )
+		return;
+
+	// map or edicts limit was changed, reallocate buffers
+	for( i = 0; i < sv_viscache.allocated; i++ )
+	{
+		sv_viscache_t *cache = &sv_viscache.entries[i];
+
+		Mem_Free( cache->pvs );
+		Mem_Free( cache->phs );
+		Mem_Free( cache->ents );
+	}
+
+	sv_viscache.allocated = 0;
+	sv_viscache.fatbytes = world.fatbytes;
+	sv_viscache.maxents = GI->max_edicts;
+}
+
+/*
+=======================
+SV_GetVisCache
+
+returns list of entities that may be visible for this PVS and PHS,
+entities outside of it would be rejected by pfnAddToFullPack anyway
+=======================
+*/
+static const sv_viscache_t *SV_GetVisCache( byte *pvs, byte *phs )
+{
+	sv_viscache_t	*cache;
+	uint32_t		checksum;
+	int		i, e;
+
+	if( !sv_entvis_cache.value || !pvs || !sv_viscache.fatbytes )
+		return NULL;
+
+	CRC32_Init( &checksum );
+	CRC32_ProcessBuffer( &checksum, pvs, sv_viscache.fatbytes );
+	if( phs ) CRC32_ProcessBuffer( &checksum, phs, sv_viscache.fatbytes );
+	checksum = CRC32_Final( checksum );
+
+	for( i = 0; i < sv_viscache.num_entries; i++ )
+	{
+		cache = &sv_viscache.entries[i];
+
+		if( cache->checksum != checksum || !phs != !cache->has_phs )
+			continue;
+
+		if( memcmp( cache->pvs, pvs, sv_viscache.fatbytes ))
+			continue;
+
+		if( phs && memcmp( cache->phs, phs, sv_viscache.fatbytes ))
+			continue;
+
+		return cache;
+	}
+
+	// cache is full, check everything
+	if( sv_viscache.num_entries == MAX_VISCACHE_ENTRIES )
+		return NULL;
+
+	cache = &sv_viscache.entries[sv_viscache.num_entries];
+
+	if( sv_viscache.num_entries == sv_viscache.allocated )
+	{
+		cache->pvs = Mem_Malloc( host.mempool, sv_viscache.fatbytes );
+		cache->phs = Mem_Malloc( host.mempool, sv_viscache.fatbytes );
+		cache->ents = Mem_Malloc( host.mempool, sv_viscache.maxents * sizeof( *cache->ents ));
+		sv_viscache.allocated++;
+	}
+
+	memcpy( cache->pvs, pvs, sv_viscache.fatbytes );
+	if( phs ) memcpy( cache->phs, phs, sv_viscache.fatbytes );
+	cache->has_phs = phs != NULL;
+	cache->checksum = checksum;
+	cache->num_ents = 0;
+
+	for( e = 1; e < svgame.numEntities; e++ )
+	{
+		edict_t	*ent = EDICT_NUM( e );
+		byte	*pset;
+
+		// players are always passed to the game, it decides about local player
+		// portals are always needed to merge visibility
+		if( e > svs.maxclients && !FBitSet( ent->v.effects, EF_MERGE_VISIBILITY ))
+		{
+			if( FBitSet( ent->v.effects, EF_REQUEST_PHS ))
+				pset = phs;
+			else pset = pvs;
+
+			if( !SV_CheckVisibility( ent, pset ))
+				continue;
+		}
+
+		cache->ents[cache->num_ents++] = e;
+	}
+
+	sv_viscache.num_entries++;
+
+	return cache;
+}
+
 /*
 =======================
 SV_EntityNumbers
@@ -62,9 +264,10 @@ static void SV_AddEntitiesToPacket( edict_t *pViewEnt, edict_t *pClient, client_
 	byte		*clientphs;
 	qboolean		fullvis = false;
 	sv_client_t	*cl = NULL;
+	const sv_viscache_t	*cache = NULL;
 	qboolean		player;
 	entity_state_t	*state;
-	int		e;
+	int		i, e, num_ents;
 
 	// during an error shutdown message we may need to transmit
 	// the shutdown message after the server has shutdown, so
@@ -90,12 +293,16 @@ static void SV_AddEntitiesToPacket( edict_t *pViewEnt, edict_t *pClient, client_
 
 	svgame.dllFuncs.pfnSetupVisibility( pViewEnt, pClient, &clientpvs, &clientphs );
 	if( !clientpvs ) fullvis = true;
+	else cache = SV_GetVisCache( clientpvs, clientphs );
 
 	// g-cont: of course we can send world but not want to do it :-)
-	for( e = 1; e < svgame.numEntities; e++ )
+	num_ents = cache ? cache->num_ents : svgame.numEntities - 1;
+
+	for( i = 0; i < num_ents; i++ )
 	{
 		byte	*pset;
 
+		e = cache ? cache->ents[i] : i + 1;
 		ent = EDICT_NUM( e );
 
 		// don't double add an entity through portals (in case this already added)
@@ -250,6 +457,223 @@ int SV_FindBestBaselineForStatic( int index, entity_state_t **baseline, entity_s
 	return index - bestfound;
 }
 
+/*
+=============
+SV_GetDeltaFrame
+
+returns the frame that we are going to delta update from
+=============
+*/
+static client_frame_t *SV_GetDeltaFrame( sv_client_t *cl )
+{
+	client_frame_t	*from;
+
+	if( cl->delta_sequence == -1 )
+		return NULL;
+
+	from = &cl->frames[cl->delta_sequence & SV_UPDATE_MASK];
+
+	// the snapshot's entities may still have rolled off the buffer, though
+	if( from->first_entity <= ( svs.next_client_entities - svs.num_client_entities ))
+	{
+		Con_DPrintf( S_WARN "%s: delta request from out of date entities.\n", cl->name );
+		return NULL;
+	}
+
+	return from;
+}
+
+/*
+=======================
+SV_HashEntityState
+=======================
+*/
+static uint32_t SV_HashEntityState( const entity_state_t *state, uint32_t hash )
+{
+	const byte	*p = (const byte *)state;
+	uint32_t		word;
+	size_t		i;
+
+	for( i = 0; i + sizeof( word ) <= sizeof( *state ); i += sizeof( word ))
+	{
+		memcpy( &word, p + i, sizeof( word ));
+		hash = ( hash ^ word ) * 0x01000193;
+	}
+
+	return hash ^ ( hash >> 15 );
+}
+
+/*
+=======================
+SV_DeltaStateValid
+
+cached entries are keeping pointers to the states,
+make sure state wasn't overwritten in circular buffer since then
+=======================
+*/
+static qboolean SV_DeltaStateValid( const entity_state_t *state, int written_at )
+{
+	int	index, written;
+
+	// baselines are never changed during the frame
+	if( state < svs.packet_entities || state >= svs.packet_entities + svs.num_client_entities )
+		return true;
+
+	written = svs.next_client_entities - written_at;
+
+	// buffer was reset or wrapped around completely
+	if( written < 0 || written >= svs.num_client_entities )
+		return false;
+
+	index = state - svs.packet_entities;
+	index = ( index - written_at % svs.num_client_entities + svs.num_client_entities ) % svs.num_client_entities;
+
+	return index >= written;
+}
+
+/*
+=======================
+SV_WriteDeltaEntity
+
+MSG_WriteDeltaEntity that reuses already encoded
+deltas for the same states within one frame
+=======================
+*/
+static void SV_WriteDeltaEntity( entity_state_t *from, entity_state_t *to, sizebuf_t *msg, qboolean force, int delta_type, int baseline )
+{
+	sv_deltacache_t	*cache;
+	sv_deltaentry_t	*entry, *slot = NULL;
+	byte		buf[DELTACACHE_MAX_DELTA];
+	sizebuf_t		temp;
+	uint32_t		hash;
+	int		i, numbits, numbytes;
+	int		player = -1;
+
+	// nobody to share deltas with
+	if( !sv_delta_cache.value || svs.maxclients <= 1 )
+	{
+		MSG_WriteDeltaEntity( from, to, msg, force, delta_type, sv.time, baseline );
+		return;
+	}
+
+	cache = &sv_deltacache.workers[Thread_WorkerIndex()];
+
+	if( !cache->entries )
+	{
+		cache->entries = Mem_Calloc( host.mempool, DELTACACHE_HASH_SIZE * sizeof( *cache->entries ));
+		cache->data = Mem_Malloc( host.mempool, DELTACACHE_DATA_SIZE );
+	}
+
+	if( cache->frame != sv_deltacache.frame )
+	{
+		cache->frame = sv_deltacache.frame;
+		cache->datasize = 0;
+	}
+
+	// game encoders may strip fields for the receiving player
+	if( Delta_HasEntityEncoder( to, delta_type ))
+		player = SV_CurrentClient() - svs.clients;
+
+	hash = SV_HashEntityState( from, 0x811c9dc5 ^ ( delta_type << 8 ) ^ ( baseline << 16 ) ^ ( player << 24 ) ^ force );
+	hash = SV_HashEntityState( to, hash );
+
+	for( i = 0; i < DELTACACHE_MAX_PROBES; i++ )
+	{
+		entry = &cache->entries[( hash + i ) & ( DELTACACHE_HASH_SIZE - 1 )];
+
+		if( entry->frame != sv_deltacache.frame )
+		{
+			slot = entry;
+			break;
+		}
+
+		if( entry->hash != hash || entry->delta_type != delta_type || entry->baseline != baseline || entry->force != force || entry->player != player )
+			continue;
+
+		if( !SV_DeltaStateValid( entry->from, entry->written_at ) || !SV_DeltaStateValid( entry->to, entry->written_at ))
+			continue;
+
+		if( memcmp( entry->from, from, sizeof( *from )) || memcmp( entry->to, to, sizeof( *to )))
+			continue;
+
+		MSG_WriteBits( msg, &cache->data[entry->offset], entry->numbits );
+		cache->hits++;
+		return;
+	}
+
+	cache->misses++;
+
+	MSG_Init( &temp, "DeltaCache", buf, sizeof( buf ));
+	MSG_WriteDeltaEntity( from, to, &temp, force, delta_type, sv.time, baseline );
+
+	// too big delta, just encode it again
+	if( MSG_CheckOverflow( &temp ))
+	{
+		MSG_WriteDeltaEntity( from, to, msg, force, delta_type, sv.time, baseline );
+		cache->uncached++;
+		return;
+	}
+
+	numbits = MSG_GetNumBitsWritten( &temp );
+	numbytes = MSG_GetNumBytesWritten( &temp );
+	MSG_WriteBits( msg, buf, numbits );
+
+	if( !slot || cache->datasize + numbytes > DELTACACHE_DATA_SIZE )
+	{
+		cache->uncached++;
+		return;
+	}
+
+	memcpy( &cache->data[cache->datasize], buf, numbytes );
+
+	slot->from = from;
+	slot->to = to;
+	slot->hash = hash;
+	slot->frame = sv_deltacache.frame;
+	slot->written_at = svs.next_client_entities;
+	slot->delta_type = delta_type;
+	slot->baseline = baseline;
+	slot->force = force;
+	slot->player = player;
+	slot->numbits = numbits;
+	slot->offset = cache->datasize;
+
+	// keep dword alignment for MSG_WriteBits
+	cache->datasize += ( numbytes + 3 ) & ~3;
+}
+
+/*
+=======================
+SV_DeltaCacheStats_f
+
+print delta cache efficiency
+=======================
+*/
+void SV_DeltaCacheStats_f( void )
+{
+	size_t	hits = 0, misses = 0, uncached = 0;
+	int	i;
+
+	for( i = 0; i < MAX_WORKER_THREADS; i++ )
+	{
+		sv_deltacache_t *cache = &sv_deltacache.workers[i];
+
+		hits += cache->hits;
+		misses += cache->misses;
+		uncached += cache->uncached;
+
+		if( Cmd_Argc() > 1 && !Q_stricmp( Cmd_Argv( 1 ), "reset" ))
+			cache->hits = cache->misses = cache->uncached = 0;
+	}
+
+	Con_Printf( "delta cache is %s\n", sv_delta_cache.value ? "enabled" : "disabled" );
+	Con_Printf( "%10zu hits\n", hits );
+	Con_Printf( "%10zu misses (%zu not cached)\n", misses, uncached );
+
+	if( hits + misses )
+		Con_Printf( "%9.2f%% hit ratio\n", hits * 100.0 / ( hits + misses ));
+}
+
 /*
 =============
 SV_EmitPacketEntities
@@ -257,41 +681,24 @@ SV_EmitPacketEntities
 Writes a delta update of an entity_state_t list to the message->
 =============
 */
-static void SV_EmitPacketEntities( sv_client_t *cl, client_frame_t *to, sizebuf_t *msg )
+static void SV_EmitPacketEntities( sv_client_t *cl, client_frame_t *from, client_frame_t *to, sizebuf_t *msg )
 {
 	entity_state_t	*oldent, *newent;
 	int		oldindex, newindex;
 	int		i, oldnum, newnum;
 	qboolean		player;
 	int		oldmax;
-	client_frame_t	*from;
 
-	// this is the frame that we are going to delta update from
-	if( cl->delta_sequence != -1 )
+	if( from != NULL )
 	{
-		from = &cl->frames[cl->delta_sequence & SV_UPDATE_MASK];
 		oldmax = from->num_entities;
 
-		// the snapshot's entities may still have rolled off the buffer, though
-		if( from->first_entity <= ( svs.next_client_entities - svs.num_client_entities ))
-		{
-			Con_DPrintf( S_WARN "%s: delta request from out of date entities.\n", cl->name );
-			MSG_BeginServerCmd( msg, svc_packetentities );
-			MSG_WriteUBitLong( msg, to->num_entities - 1, MAX_VISIBLE_PACKET_BITS );
-
-			from = NULL;
-			oldmax = 0;
-		}
-		else
-		{
-			MSG_BeginServerCmd( msg, svc_deltapacketentities );
-			MSG_WriteUBitLong( msg, to->num_entities - 1, MAX_VISIBLE_PACKET_BITS );
-			MSG_WriteByte( msg, cl->delta_sequence );
-		}
+		MSG_BeginServerCmd( msg, svc_deltapacketentities );
+		MSG_WriteUBitLong( msg, to->num_entities - 1, MAX_VISIBLE_PACKET_BITS );
+		MSG_WriteByte( msg, cl->delta_sequence );
 	}
 	else
 	{
-		from = NULL;
 		oldmax = 0;
 
 		MSG_BeginServerCmd( msg, svc_packetentities );
@@ -332,7 +739,7 @@ static void SV_EmitPacketEntities( sv_client_t *cl, client_frame_t *to, sizebuf_
 			// delta update from old position
 			// because the force parm is false, this will not result
 			// in any bytes being emited if the entity has not changed at all
-			MSG_WriteDeltaEntity( oldent, newent, msg, false, player, sv.time, 0 );
+			SV_WriteDeltaEntity( oldent, newent, msg, false, player, 0 );
 			oldindex++;
 			newindex++;
 			continue;
@@ -363,7 +770,7 @@ static void SV_EmitPacketEntities( sv_client_t *cl, client_frame_t *to, sizebuf_
 			}
 
 			// this is a new entity, send it from the baseline
-			MSG_WriteDeltaEntity( baseline, newent, msg, true, player, sv.time, offset );
+			SV_WriteDeltaEntity( baseline, newent, msg, true, player, offset );
 			newindex++;
 			continue;
 		}
@@ -630,19 +1037,20 @@ void SV_WriteClientdataToMessage( sv_client_t *cl, sizebuf_t *msg )
 
 /*
 ==================
-SV_WriteEntitiesToClient
+SV_SetupClientFrame
 
+collect visible entities into the client frame,
+calls game callbacks so must be run on main thread
 ==================
 */
-void SV_WriteEntitiesToClient( sv_client_t *cl, sizebuf_t *msg )
+static client_frame_t *SV_SetupClientFrame( sv_client_t *cl )
 {
 	client_frame_t	*frame;
 	entity_state_t	*state;
 	static sv_ents_t	frame_ents;
-	int		i, send_pings;
+	int		i;
 
 	frame = &cl->frames[cl->netchan.outgoing_sequence & SV_UPDATE_MASK];
-	send_pings = SV_ShouldUpdatePing( cl );
 
 	memset( frame_ents.sended, 0, sizeof( frame_ents.sended ));
 	ClearBits( sv.hostflags, SVF_MERGE_VISIBILITY );
@@ -689,7 +1097,24 @@ void SV_WriteEntitiesToClient( sv_client_t *cl, sizebuf_t *msg )
 		frame->num_entities++;
 	}
 
-	SV_EmitPacketEntities( cl, frame, msg );
+	return frame;
+}
+
+/*
+==================
+SV_WriteEntitiesToClient
+
+==================
+*/
+void SV_WriteEntitiesToClient( sv_client_t *cl, sizebuf_t *msg )
+{
+	client_frame_t	*frame;
+	qboolean		send_pings;
+
+	send_pings = SV_ShouldUpdatePing( cl );
+	frame = SV_SetupClientFrame( cl );
+
+	SV_EmitPacketEntities( cl, SV_GetDeltaFrame( cl ), frame, msg );
 	SV_EmitEvents( cl, frame, msg );
 	if( send_pings ) SV_EmitPings( msg );
 }
@@ -701,6 +1126,41 @@ FRAME UPDATES
 
 ===============================================================================
 */
+/*
+=======================
+SV_FinishClientDatagram
+
+append unreliable data and send the datagram
+=======================
+*/
+static void SV_FinishClientDatagram( sv_client_t *cl, sizebuf_t *msg )
+{
+	// copy the accumulated multicast datagram
+	// for this client out to the message
+	if( MSG_CheckOverflow( &cl->datagram ))
+	{
+		Con_Printf( S_WARN "%s overflowed for %s\n", MSG_GetName( &cl->datagram ), cl->name );
+	}
+	else
+	{
+		if( MSG_GetNumBytesWritten( &cl->datagram ) < MSG_GetNumBytesLeft( msg ))
+			MSG_WriteBits( msg, MSG_GetData( &cl->datagram ), MSG_GetNumBitsWritten( &cl->datagram ));
+		else Con_DPrintf( S_WARN "Ignoring unreliable datagram for %s, would overflow on msg\n", cl->name );
+	}
+
+	MSG_Clear( &cl->datagram );
+
+	if( MSG_CheckOverflow( msg ))
+	{
+		// must have room left for the packet header
+		Con_Printf( S_ERROR "%s overflowed for %s\n", MSG_GetName( msg ), cl->name );
+		MSG_Clear( msg );
+	}
+
+	// send the datagram
+	Netchan_TransmitBits( &cl->netchan, MSG_GetNumBitsWritten( msg ), MSG_GetData( msg ));
+}
+
 /*
 =======================
 SV_SendClientDatagram
@@ -720,31 +1180,129 @@ void SV_SendClientDatagram( sv_client_t *cl )
 
 	SV_WriteClientdataToMessage( cl, &msg );
 	SV_WriteEntitiesToClient( cl, &msg );
+	SV_FinishClientDatagram( cl, &msg );
+}
 
-	// copy the accumulated multicast datagram
-	// for this client out to the message
-	if( MSG_CheckOverflow( &cl->datagram ))
-	{
-		Con_Printf( S_WARN "%s overflowed for %s\n", MSG_GetName( &cl->datagram ), cl->name );
-	}
-	else
+/*
+=======================
+SV_EncodeSnapshot
+
+worker job, must not call into game dll
+except for delta encoders
+=======================
+*/
+static void SV_EncodeSnapshot( void *data, int index, int worker )
+{
+	sv_snapshot_t	*snap = (sv_snapshot_t *)data + index;
+
+	// game dll encoders ask for the current player
+	sv_encoding_client = snap->cl;
+
+	SV_EmitPacketEntities( snap->cl, snap->from, snap->to, &snap->msg );
+	SV_EmitEvents( snap->cl, snap->to, &snap->msg );
+
+	if( snap->send_pings )
+		MSG_WriteBits( &snap->msg, MSG_GetData( &snap->pings ), MSG_GetNumBitsWritten( &snap->pings ));
+
+	sv_encoding_client = NULL;
+}
+
+/*
+=======================
+SV_CurrentClient
+
+client that network message is built for on this thread
+=======================
+*/
+sv_client_t *SV_CurrentClient( void )
+{
+	if( sv_encoding_client )
+		return sv_encoding_client;
+
+	return sv.current_client;
+}
+
+/*
+=======================
+SV_FlushClientDatagrams
+
+encode all pending snapshots in parallel, then send
+them in the same order as they were queued
+=======================
+*/
+static void SV_FlushClientDatagrams( void )
+{
+	int	i, numworkers;
+
+	if( !sv_snapshots.num_snapshots )
+		return;
+
+	numworkers = Thread_NumWorkers();
+
+	Delta_BeginParallelEncode( numworkers );
+	Thread_ParallelFor( SV_EncodeSnapshot, sv_snapshots.snapshots, sv_snapshots.num_snapshots );
+	Delta_EndParallelEncode();
+
+	for( i = 0; i < sv_snapshots.num_snapshots; i++ )
 	{
-		if( MSG_GetNumBytesWritten( &cl->datagram ) < MSG_GetNumBytesLeft( &msg ))
-			MSG_WriteBits( &msg, MSG_GetData( &cl->datagram ), MSG_GetNumBitsWritten( &cl->datagram ));
-		else Con_DPrintf( S_WARN "Ignoring unreliable datagram for %s, would overflow on msg\n", cl->name );
+		sv_snapshot_t *snap = &sv_snapshots.snapshots[i];
+
+		SV_FinishClientDatagram( snap->cl, &snap->msg );
 	}
 
-	MSG_Clear( &cl->datagram );
+	sv_snapshots.num_snapshots = 0;
+}
+
+/*
+=======================
+SV_QueueClientDatagram
+
+same as SV_SendClientDatagram, but only runs
+game callbacks and defers the delta encoding
+=======================
+*/
+static void SV_QueueClientDatagram( sv_client_t *cl )
+{
+	sv_snapshot_t	*snap;
+
+	// entities of pending snapshots must not be overwritten in circular buffer
+	if( sv_snapshots.num_snapshots && svs.next_client_entities + MAX_VISIBLE_PACKET >= sv_snapshots.oldest_entity + svs.num_client_entities )
+		SV_FlushClientDatagrams();
+
+	if( !sv_snapshots.msg_bufs )
+		sv_snapshots.msg_bufs = Mem_Malloc( host.mempool, MAX_CLIENTS * MAX_DATAGRAM );
+
+	snap = &sv_snapshots.snapshots[sv_snapshots.num_snapshots];
+	snap->cl = cl;
+
+	memset( &sv_snapshots.msg_bufs[sv_snapshots.num_snapshots * MAX_DATAGRAM], 0, MAX_DATAGRAM );
+	MSG_Init( &snap->msg, "Datagram", &sv_snapshots.msg_bufs[sv_snapshots.num_snapshots * MAX_DATAGRAM], MAX_DATAGRAM );
+
+	// always send servertime at new frame
+	MSG_BeginServerCmd( &snap->msg, svc_time );
+	MSG_WriteFloat( &snap->msg, sv.time );
 
-	if( MSG_CheckOverflow( &msg ))
+	SV_WriteClientdataToMessage( cl, &snap->msg );
+
+	snap->send_pings = SV_ShouldUpdatePing( cl );
+	snap->to = SV_SetupClientFrame( cl );
+	snap->from = SV_GetDeltaFrame( cl );
+
+	// pings are depends on clients state at this moment
+	if( snap->send_pings )
 	{
-		// must have room left for the packet header
-		Con_Printf( S_ERROR "%s overflowed for %s\n", MSG_GetName( &msg ), cl->name );
-		MSG_Clear( &msg );
+		memset( snap->pings_buf, 0, sizeof( snap->pings_buf ));
+		MSG_Init( &snap->pings, "Pings", snap->pings_buf, sizeof( snap->pings_buf ));
+		SV_EmitPings( &snap->pings );
 	}
 
-	// send the datagram
-	Netchan_TransmitBits( &cl->netchan, MSG_GetNumBitsWritten( &msg ), MSG_GetData( &msg ));
+	if( !sv_snapshots.num_snapshots || snap->to->first_entity < sv_snapshots.oldest_entity )
+		sv_snapshots.oldest_entity = snap->to->first_entity;
+
+	if( snap->from && snap->from->first_entity < sv_snapshots.oldest_entity )
+		sv_snapshots.oldest_entity = snap->from->first_entity;
+
+	sv_snapshots.num_snapshots++;
 }
 
 /*
@@ -848,6 +1406,9 @@ void SV_SendClientMessages( void )
 		return;
 
 	SV_UpdateToReliableMessages ();
+	SV_ClearVisCache ();
+	sv_deltacache.frame++;
+	NET_BeginSendBatch ();
 
 	// send a message to each connected client
 	for( i = 0, sv.current_client = svs.clients; i < svs.maxclients; i++, sv.current_client++ )
@@ -882,6 +1443,9 @@ void SV_SendClientMessages( void )
 		// if the reliable message overflowed, drop the client
 		if( MSG_CheckOverflow( &cl->netchan.message ))
 		{
+			// game dll may change entities in ClientDisconnect
+			SV_FlushClientDatagrams();
+
 			MSG_Clear( &cl->netchan.message );
 			MSG_Clear( &cl->datagram );
 			SV_BroadcastPrintf( NULL, "%s overflowed\n", cl->name );
@@ -917,12 +1481,17 @@ void SV_SendClientMessages( void )
 			ClearBits( cl->flags, FCL_SEND_NET_MESSAGE );
 
 			// NOTE: we should send frame even if server is not simulated to prevent overflow
-			if( cl->state == cs_spawned )
-				SV_SendClientDatagram( cl );
-			else Netchan_TransmitBits( &cl->netchan, 0, NULL ); // just update reliable
+			if( cl->state != cs_spawned )
+				Netchan_TransmitBits( &cl->netchan, 0, NULL ); // just update reliable
+			else if( sv_parallel_snapshots.value )
+				SV_QueueClientDatagram( cl );
+			else SV_SendClientDatagram( cl );
 		}
 	}
 
+	SV_FlushClientDatagrams();
+	NET_EndSendBatch();
+
 	// reset current client
 	sv.current_client = NULL;
 }
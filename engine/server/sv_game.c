@@ -1064,6 +1064,262 @@ static void GAME_EXPORT SV_FreePrivateData( edict_t *pEdict )
 	pEdict->pvPrivateData = NULL;
 }
 
+/*
+===============================================================================
+
+	ENTITY STRING INDEX
+
+===============================================================================
+*/
+#define ENTINDEX_HASHSIZE	1024	// must be power of two
+
+// edicts with the same hash are chained in ascending order,
+// so lookups return the same edict as linear search
+typedef struct
+{
+	const char	*name;
+	int		offset;			// in entvars_t
+	int		heads[ENTINDEX_HASHSIZE];	// first edict in chain, 0 is empty
+	int		*next;			// next edict in chain
+	string_t		*values;			// indexed value of every edict
+	uint		*hashes;
+	qboolean		dirty;
+	uint		framecount;		// validated at this frame
+} sv_entindex_field_t;
+
+static struct
+{
+	sv_entindex_field_t	fields[5];
+	int		maxedicts;
+	size_t		lookups;
+	size_t		resyncs;
+} sv_entindex =
+{
+	{
+	{ "classname", offsetof( entvars_t, classname ) },
+	{ "targetname", offsetof( entvars_t, targetname ) },
+	{ "target", offsetof( entvars_t, target ) },
+	{ "globalname", offsetof( entvars_t, globalname ) },
+	{ "netname", offsetof( entvars_t, netname ) },
+	}
+};
+
+/*
+==============
+SV_ResetEntityIndex
+
+forget everything, string values can't be trusted anymore
+==============
+*/
+static void SV_ResetEntityIndex( void )
+{
+	int	i;
+
+	for( i = 0; i < ARRAYSIZE( sv_entindex.fields ); i++ )
+	{
+		sv_entindex_field_t *field = &sv_entindex.fields[i];
+
+		if( field->next )
+		{
+			Mem_Free( field->next );
+			Mem_Free( field->values );
+			Mem_Free( field->hashes );
+		}
+
+		field->next = NULL;
+		field->values = NULL;
+		field->hashes = NULL;
+		memset( field->heads, 0, sizeof( field->heads ));
+	}
+
+	sv_entindex.maxedicts = 0;
+}
+
+/*
+==============
+SV_MarkEntityIndexDirty
+
+called when game dll allocates strings or edicts,
+index must be validated again before next lookup
+==============
+*/
+static void SV_MarkEntityIndexDirty( void )
+{
+	int	i;
+
+	for( i = 0; i < ARRAYSIZE( sv_entindex.fields ); i++ )
+		sv_entindex.fields[i].dirty = true;
+}
+
+static void SV_EntityIndexUnlink( sv_entindex_field_t *field, int e )
+{
+	int	*link = &field->heads[field->hashes[e]];
+
+	while( *link && *link != e )
+		link = &field->next[*link];
+
+	if( *link ) *link = field->next[e];
+	field->next[e] = 0;
+}
+
+static void SV_EntityIndexLink( sv_entindex_field_t *field, int e )
+{
+	int	*link = &field->heads[field->hashes[e]];
+
+	while( *link && *link < e )
+		link = &field->next[*link];
+
+	field->next[e] = *link;
+	*link = e;
+}
+
+/*
+==============
+SV_SyncEntityIndex
+
+rehash edicts which field value was changed since last time
+==============
+*/
+static void SV_SyncEntityIndex( sv_entindex_field_t *field )
+{
+	int	e;
+
+	if( sv_entindex.maxedicts != GI->max_edicts )
+	{
+		SV_ResetEntityIndex();
+		sv_entindex.maxedicts = GI->max_edicts;
+	}
+
+	if( !field->next )
+	{
+		field->next = Mem_Calloc( host.mempool, sv_entindex.maxedicts * sizeof( *field->next ));
+		field->values = Mem_Calloc( host.mempool, sv_entindex.maxedicts * sizeof( *field->values ));
+		field->hashes = Mem_Calloc( host.mempool, sv_entindex.maxedicts * sizeof( *field->hashes ));
+	}
+
+	// backwards, so initial build is always inserting into chain head
+	for( e = svgame.numEntities - 1; e > 0; e-- )
+	{
+		string_t	value = *(string_t *)((byte *)&EDICT_NUM( e )->v + field->offset );
+		const char	*t;
+
+		if( value == field->values[e] )
+			continue;
+
+		if( field->values[e] )
+			SV_EntityIndexUnlink( field, e );
+
+		field->values[e] = value;
+		t = STRING( value );
+
+		// empty strings are never matched
+		if( !value || t == NULL || t == svgame.globals->pStringBase )
+			continue;
+
+		field->hashes[e] = COM_HashKey( t, ENTINDEX_HASHSIZE );
+		SV_EntityIndexLink( field, e );
+	}
+
+	field->dirty = false;
+	field->framecount = host.framecount;
+	sv_entindex.resyncs++;
+}
+
+/*
+==============
+SV_FindEntityIndexed
+
+returns NULL if field isn't indexed
+==============
+*/
+static edict_t *SV_FindEntityIndexed( int start, int offset, const char *pszValue )
+{
+	sv_entindex_field_t	*field = NULL;
+	int		i, e;
+
+	// game dll manages strings itself
+	if( !sv_entity_index.value || svgame.physFuncs.pfnAllocString != NULL )
+		return NULL;
+
+	for( i = 0; i < ARRAYSIZE( sv_entindex.fields ); i++ )
+	{
+		if( sv_entindex.fields[i].offset == offset )
+			field = &sv_entindex.fields[i];
+	}
+
+	if( !field )
+		return NULL;
+
+	sv_entindex.lookups++;
+
+	if( field->dirty || field->framecount != host.framecount || !field->next || sv_entindex.maxedicts != GI->max_edicts )
+		SV_SyncEntityIndex( field );
+
+	for( e = field->heads[COM_HashKey( pszValue, ENTINDEX_HASHSIZE )]; e; e = field->next[e] )
+	{
+		edict_t	*ed;
+
+		if( e <= start || e >= svgame.numEntities )
+			continue;
+
+		ed = EDICT_NUM( e );
+
+		// changed behind our back, look again with fresh index
+		if( *(string_t *)((byte *)&ed->v + field->offset ) != field->values[e] )
+		{
+			SV_SyncEntityIndex( field );
+			return SV_FindEntityIndexed( start, offset, pszValue );
+		}
+
+		if( !SV_IsValidEdict( ed ))
+			continue;
+
+		if( e <= svs.maxclients && !SV_ClientFromEdict( ed, ( svs.maxclients != 1 )))
+			continue;
+
+		if( !Q_strcmp( STRING( field->values[e] ), pszValue ))
+			return ed;
+	}
+
+	return svgame.edicts;
+}
+
+/*
+==============
+SV_EntityIndexStats_f
+==============
+*/
+void SV_EntityIndexStats_f( void )
+{
+	int	i, j, e;
+
+	Con_Printf( "entity index is %s, %zu lookups, %zu resyncs\n", sv_entity_index.value ? "enabled" : "disabled",
+		sv_entindex.lookups, sv_entindex.resyncs );
+
+	for( i = 0; i < ARRAYSIZE( sv_entindex.fields ); i++ )
+	{
+		sv_entindex_field_t	*field = &sv_entindex.fields[i];
+		int		count = 0, used = 0, longest = 0;
+
+		if( !field->next )
+			continue;
+
+		for( j = 0; j < ENTINDEX_HASHSIZE; j++ )
+		{
+			int	chain = 0;
+
+			for( e = field->heads[j]; e; e = field->next[e] )
+				chain++;
+
+			if( chain ) used++;
+			count += chain;
+			longest = Q_max( longest, chain );
+		}
+
+		Con_Printf( "%s: %d edicts in %d buckets, longest chain %d\n", field->name, count, used, longest );
+	}
+}
+
 /*
 ==============
 SV_InitEdict
@@ -1075,6 +1331,8 @@ void SV_InitEdict( edict_t *pEdict )
 {
 	Assert( pEdict != NULL );
 
+	SV_MarkEntityIndexDirty();
+
 	SV_FreePrivateData( pEdict );
 	memset( &pEdict->v, 0, sizeof( entvars_t ));
 	pEdict->v.pContainingEntity = pEdict;
@@ -1083,6 +1341,16 @@ void SV_InitEdict( edict_t *pEdict )
 	pEdict->v.controller[2] = 0x7F;
 	pEdict->v.controller[3] = 0x7F;
 	pEdict->free = false;
+
+	// leafs are valid only after SV_LinkEdict, EntitiesInPVS uses
+	// them with spatial queries and a reused slot keeps the old ones
+	if( sv_spatial_queries.value )
+	{
+		pEdict->num_leafs = 0;
+		pEdict->headnode = -1;
+	}
+
+	SV_EdictGridLink( pEdict );
 }
 
 /*
@@ -1120,6 +1388,8 @@ void SV_FreeEdict( edict_t *pEdict )
 	VectorClear( pEdict->v.angles );
 	VectorClear( pEdict->v.origin );
 	pEdict->free = true;
+
+	SV_EdictGridUnlink( pEdict );
 }
 
 /*
@@ -1586,6 +1856,10 @@ static edict_t *GAME_EXPORT SV_FindEntityByString( edict_t *pStartEdict, const c
 		return svgame.edicts;
 	}
 
+	// most used fields have hash index
+	if(( ed = SV_FindEntityIndexed( e, desc->fieldOffset, pszValue )) != NULL )
+		return ed;
+
 	for( e++; e < svgame.numEntities; e++ )
 	{
 		ed = EDICT_NUM( e );
@@ -1651,6 +1925,98 @@ static int GAME_EXPORT pfnGetEntityIllum( edict_t* pEnt )
 	return SV_LightForEntity( pEnt );
 }
 
+/*
+=================
+SV_EntityInSphere
+
+radius is squared
+=================
+*/
+static qboolean SV_EntityInSphere( int e, const float *org, float flRadius )
+{
+	float	distSquared = 0.0f;
+	edict_t	*ent = EDICT_NUM( e );
+	float	eorg;
+	int	j;
+
+	if( !SV_IsValidEdict( ent ))
+		return false;
+
+	// ignore clients that not in a game
+	if( e <= svs.maxclients && !SV_ClientFromEdict( ent, true ))
+		return false;
+
+	for( j = 0; j < 3 && distSquared <= flRadius; j++ )
+	{
+		if( org[j] < ent->v.absmin[j] )
+			eorg = org[j] - ent->v.absmin[j];
+		else if( org[j] > ent->v.absmax[j] )
+			eorg = org[j] - ent->v.absmax[j];
+		else eorg = 0.0f;
+
+		distSquared += eorg * eorg;
+	}
+
+	return distSquared < flRadius;
+}
+
+static int SV_CompareEdictNums( const void *a, const void *b )
+{
+	return *(const int *)a - *(const int *)b;
+}
+
+/*
+=================
+SV_FindEntityInSphereGrid
+
+game dlls iterate the same sphere passing previous result as start,
+so keep sorted candidates from the edict grid until anything is moved
+=================
+*/
+static edict_t *SV_FindEntityInSphereGrid( int start, const float *org, float flRadius )
+{
+	static struct
+	{
+		int	list[MAX_EDICTS];
+		int	count;
+		vec3_t	org;
+		float	radius;
+		uint	generation;
+		qboolean	valid;
+	} cache;
+	vec3_t	mins, maxs;
+	uint	generation;
+	int	i, e;
+
+	if( !( generation = SV_EdictGridGeneration( )))
+		return NULL;
+
+	if( !cache.valid || cache.generation != generation || cache.radius != flRadius || !VectorCompare( cache.org, org ))
+	{
+		float	radius = sqrt( flRadius );
+
+		VectorSet( mins, org[0] - radius, org[1] - radius, org[2] - radius );
+		VectorSet( maxs, org[0] + radius, org[1] + radius, org[2] + radius );
+
+		cache.count = SV_EdictGridQuery( mins, maxs, cache.list, MAX_EDICTS );
+		cache.generation = generation;
+		qsort( cache.list, cache.count, sizeof( cache.list[0] ), SV_CompareEdictNums );
+		VectorCopy( org, cache.org );
+		cache.radius = flRadius;
+		cache.valid = true;
+	}
+
+	for( i = 0; i < cache.count; i++ )
+	{
+		e = cache.list[i];
+
+		if( e > start && SV_EntityInSphere( e, org, flRadius ))
+			return EDICT_NUM( e );
+	}
+
+	return svgame.edicts;
+}
+
 /*
 =================
 pfnFindEntityInSphere
@@ -1660,42 +2026,21 @@ find the entity in sphere
 */
 static edict_t *GAME_EXPORT pfnFindEntityInSphere( edict_t *pStartEdict, const float *org, float flRadius )
 {
-	float	distSquared;
-	int	j, e = 0;
-	float	eorg;
 	edict_t	*ent;
+	int	e = 0;
 
 	flRadius *= flRadius;
 
 	if( SV_IsValidEdict( pStartEdict ))
 		e = NUM_FOR_EDICT( pStartEdict );
 
+	if( sv_spatial_queries.value && ( ent = SV_FindEntityInSphereGrid( e, org, flRadius )) != NULL )
+		return ent;
+
 	for( e++; e < svgame.numEntities; e++ )
 	{
-		ent = EDICT_NUM( e );
-
-		if( !SV_IsValidEdict( ent ))
-			continue;
-
-		// ignore clients that not in a game
-		if( e <= svs.maxclients && !SV_ClientFromEdict( ent, true ))
-			continue;
-
-		distSquared = 0.0f;
-
-		for( j = 0; j < 3 && distSquared <= flRadius; j++ )
-		{
-			if( org[j] < ent->v.absmin[j] )
-				eorg = org[j] - ent->v.absmin[j];
-			else if( org[j] > ent->v.absmax[j] )
-				eorg = org[j] - ent->v.absmax[j];
-			else eorg = 0.0f;
-
-			distSquared += eorg * eorg;
-		}
-
-		if( distSquared < flRadius )
-			return ent;
+		if( SV_EntityInSphere( e, org, flRadius ))
+			return EDICT_NUM( e );
 	}
 
 	return svgame.edicts;
@@ -1826,6 +2171,36 @@ static edict_t* GAME_EXPORT pfnFindClientInPVS( edict_t *pEdict )
 	return svgame.edicts;
 }
 
+/*
+=================
+SV_EntityInPVS
+
+same as SV_BoxInPVS but uses leafs found on link when possible
+=================
+*/
+static qboolean SV_EntityInPVS( edict_t *ent, const byte *pvs )
+{
+	int	i;
+
+	if( !pvs )
+		return true;
+
+	// never linked or has no model
+	if( !ent->num_leafs && ent->headnode < 0 )
+		return Mod_BoxVisible( ent->v.absmin, ent->v.absmax, pvs );
+
+	for( i = 0; i < ent->num_leafs; i++ )
+	{
+		if( CHECKVISBIT( pvs, ent->leafnums[i] ))
+			return true;
+	}
+
+	if( ent->headnode >= 0 )
+		return Mod_HeadnodeVisible( &sv.worldmodel->nodes[ent->headnode], pvs, NULL );
+
+	return false;
+}
+
 /*
 =================
 pfnEntitiesInPVS
@@ -1837,6 +2212,7 @@ static edict_t *pfnEntitiesInPVS( edict_t *pview )
 	edict_t	*pchain, *ptest;
 	vec3_t	viewpoint;
 	edict_t	*pent;
+	byte	*pvs;
 	int	i;
 
 	if( !SV_IsValidEdict( pview ))
@@ -1845,6 +2221,32 @@ static edict_t *pfnEntitiesInPVS( edict_t *pview )
 	VectorAdd( pview->v.origin, pview->v.view_ofs, viewpoint );
 	pchain = EDICT_NUM( 0 );
 
+	if( sv_spatial_queries.value )
+	{
+		// decompress pvs only once and use leafs found by SV_LinkEdict
+		pvs = Mod_GetPVSForPoint( viewpoint );
+
+		for( i = 1; i < svgame.numEntities; i++ )
+		{
+			pent = EDICT_NUM( i );
+
+			if( !SV_IsValidEdict( pent ))
+				continue;
+
+			if( pent->v.movetype == MOVETYPE_FOLLOW && SV_IsValidEdict( pent->v.aiment ))
+				ptest = pent->v.aiment;
+			else ptest = pent;
+
+			if( SV_EntityInPVS( ptest, pvs ))
+			{
+				pent->v.chain = pchain;
+				pchain = pent;
+			}
+		}
+
+		return pchain;
+	}
+
 	for( i = 1; i < svgame.numEntities; i++ )
 	{
 		pent = EDICT_NUM( i );
@@ -2983,7 +3385,107 @@ static struct str64_s
 	size_t numdups;
 	size_t numoverflows;
 	size_t totalalloc;
+
+	// deduplication index, offsets from pstringarray, 0 is empty slot
+	int *hashtable;
+	uint hashsize;
+	uint hashcount;
+	size_t numlookups;
+	size_t numprobes;
+	size_t maxprobes;
 } str64;
+
+#define STR64_HASH_MINSIZE	4096
+
+/*
+==================
+SV_Str64ClearIndex
+
+strings before poldstringbase are never
+searched again, so forget them
+==================
+*/
+static void SV_Str64ClearIndex( void )
+{
+	if( str64.hashtable )
+		memset( str64.hashtable, 0, str64.hashsize * sizeof( *str64.hashtable ));
+	str64.hashcount = 0;
+}
+
+/*
+==================
+SV_Str64InsertIndex
+
+first copy of the string wins, as it was with linear search
+==================
+*/
+static void SV_Str64InsertIndex( int offset )
+{
+	const char *s = str64.pstringarray + offset;
+	uint slot = COM_HashKey( s, str64.hashsize );
+
+	while( str64.hashtable[slot] )
+	{
+		if( !Q_strcmp( str64.pstringarray + str64.hashtable[slot], s ))
+			return;
+		slot = ( slot + 1 ) & ( str64.hashsize - 1 );
+	}
+
+	str64.hashtable[slot] = offset;
+	str64.hashcount++;
+}
+
+static void SV_Str64GrowIndex( void )
+{
+	int *oldtable = str64.hashtable;
+	uint i, oldsize = str64.hashsize;
+
+	str64.hashsize = oldsize ? oldsize * 2 : STR64_HASH_MINSIZE;
+	str64.hashtable = Mem_Calloc( host.mempool, str64.hashsize * sizeof( *str64.hashtable ));
+	str64.hashcount = 0;
+
+	for( i = 0; i < oldsize; i++ )
+	{
+		if( oldtable[i] )
+			SV_Str64InsertIndex( oldtable[i] );
+	}
+
+	if( oldtable )
+		Mem_Free( oldtable );
+}
+
+/*
+==================
+SV_Str64FindString
+
+search string in the current pool window
+==================
+*/
+static char *SV_Str64FindString( const char *szValue )
+{
+	uint slot, probes = 1;
+
+	if( !str64.hashtable )
+		return NULL;
+
+	str64.numlookups++;
+
+	for( slot = COM_HashKey( szValue, str64.hashsize ); str64.hashtable[slot]; slot = ( slot + 1 ) & ( str64.hashsize - 1 ), probes++ )
+	{
+		char *s = str64.pstringarray + str64.hashtable[slot];
+
+		if( !Q_strcmp( s, szValue ))
+			break;
+	}
+
+	str64.numprobes += probes;
+	str64.maxprobes = Q_max( str64.maxprobes, probes );
+
+	if( !str64.hashtable[slot] )
+		return NULL;
+
+	return str64.pstringarray + str64.hashtable[slot];
+}
 #endif
 
 /*
@@ -3002,10 +3504,12 @@ void SV_EmptyStringPool( void )
 	{
 		str64.pstringbase = str64.poldstringbase = str64.pstringarraystatic;
 		str64.plast = str64.pstringbase + 1;
+		SV_Str64ClearIndex();
 	}
 #else
 	Mem_EmptyPool( svgame.stringspool );
 #endif
+	SV_ResetEntityIndex();
 }
 
 /*
@@ -3126,6 +3630,7 @@ static void SV_AllocStringPool( void )
 	str64.pstringbase = str64.poldstringbase = ptr;
 	str64.plast = (byte*)ptr + 1;
 	svgame.globals->pStringBase = ptr;
+	SV_Str64ClearIndex();
 #else
 	svgame.stringspool = Mem_AllocPool( "Server Strings" );
 	svgame.globals->pStringBase = "";
@@ -3143,6 +3648,11 @@ static void SV_FreeStringPool( void )
 	else
 #endif
 		Mem_Free( str64.staticstringarray );
+
+	if( str64.hashtable )
+		Mem_Free( str64.hashtable );
+	str64.hashtable = NULL;
+	str64.hashsize = str64.hashcount = 0;
 #else
 	Mem_FreePool( &svgame.stringspool );
 #endif
@@ -3207,7 +3717,7 @@ static uint SV_ProcessString( char *dst, const char *src )
 SV_AllocString
 
 allocate new engine string
-on 64bit platforms find in array string if deduplication enabled (default)
+on 64bit platforms find string through hash index if deduplication enabled (default)
 if not found, add to array
 use -str64dup to disable deduplication, -str64alloc to set array size
 =============
@@ -3216,33 +3726,29 @@ string_t GAME_EXPORT SV_AllocString( const char *szValue )
 {
 	char *newString = NULL;
 	uint len;
-	int cmp;
+
+	// most likely it will be assigned to some entity field
+	SV_MarkEntityIndexDirty();
 
 	if( svgame.physFuncs.pfnAllocString != NULL )
 	{
 		string_t i;
 
-		newString = Mem_Malloc( host.mempool, SV_ProcessString( NULL, szValue ));
+		newString = Mem_FrameAlloc( SV_ProcessString( NULL, szValue ));
 
 		SV_ProcessString( newString, szValue );
 		i = svgame.physFuncs.pfnAllocString( newString );
 
-		Mem_Free( newString );
-
 		return i;
 	}
 
 #ifdef XASH_64BIT
-	cmp = 1;
+	newString = NULL;
 
 	if( !str64.allowdup )
-	{
-		for( newString = str64.poldstringbase + 1;
-			newString < str64.plast && ( cmp = Q_strcmp( newString, szValue ) );
-			newString += Q_strlen( newString ) + 1 );
-	}
+		newString = SV_Str64FindString( szValue );
 
-	if( cmp )
+	if( !newString )
 	{
 		uint len = SV_ProcessString( NULL, szValue );
 
@@ -3251,6 +3757,8 @@ string_t GAME_EXPORT SV_AllocString( const char *szValue )
 			str64.plast = str64.pstringbase + 1;
 			str64.poldstringbase = str64.pstringbase;
 			str64.numoverflows++;
+			SV_Str64ClearIndex();
+			SV_ResetEntityIndex();
 		}
 
 		//MsgDev( D_NOTE, "SV_AllocString: %ld %s\n", str64.plast - svgame.globals->pStringBase, szValue );
@@ -3259,6 +3767,15 @@ string_t GAME_EXPORT SV_AllocString( const char *szValue )
 
 		newString = str64.plast;
 		str64.plast += len;
+
+		if( !str64.allowdup )
+		{
+			// keep load factor below 0.5
+			if(( str64.hashcount + 1 ) * 2 > str64.hashsize )
+				SV_Str64GrowIndex();
+
+			SV_Str64InsertIndex( newString - str64.pstringarray );
+		}
 	}
 	else
 	{
@@ -3290,6 +3807,9 @@ void SV_PrintStr64Stats_f( void )
 	Msg( "maximum array usage: %lu\n", str64.maxalloc );
 	Msg( "overflow counter: %lu\n", str64.numoverflows );
 	Msg( "dup string counter: %lu\n", str64.numdups );
+	Msg( "index: %u strings in %u slots\n", str64.hashcount, str64.hashsize );
+	if( str64.numlookups )
+		Msg( "index probes: %.2f average, %lu max for %lu lookups\n", (double)str64.numprobes / str64.numlookups, str64.maxprobes, str64.numlookups );
 }
 #endif
 
@@ -3302,6 +3822,8 @@ make constant string
 */
 string_t SV_MakeString( const char *szValue )
 {
+	SV_MarkEntityIndexDirty();
+
 	if( svgame.physFuncs.pfnMakeString != NULL )
 		return svgame.physFuncs.pfnMakeString( szValue );
 #ifdef XASH_64BIT
@@ -4212,7 +4734,7 @@ pfnGetCurrentPlayer
 */
 static int GAME_EXPORT pfnGetCurrentPlayer( void )
 {
-	int	idx = sv.current_client - svs.clients;
+	int	idx = SV_CurrentClient() - svs.clients;
 
 	if( idx < 0 || idx >= svs.maxclients )
 		return -1;
@@ -4320,11 +4842,11 @@ static byte *GAME_EXPORT pfnSetFatPAS( const float *org )
 
 /*
 =============
-pfnCheckVisibility
+SV_CheckVisibility
 
 =============
 */
-static int GAME_EXPORT pfnCheckVisibility( const edict_t *ent, byte *pset )
+int SV_CheckVisibility( const edict_t *ent, byte *pset )
 {
 	int	i, leafnum;
 
@@ -4370,6 +4892,17 @@ static int GAME_EXPORT pfnCheckVisibility( const edict_t *ent, byte *pset )
 	}
 }
 
+/*
+=============
+pfnCheckVisibility
+
+=============
+*/
+static int GAME_EXPORT pfnCheckVisibility( const edict_t *ent, byte *pset )
+{
+	return SV_CheckVisibility( ent, pset );
+}
+
 /*
 =============
 pfnCanSkipPlayer
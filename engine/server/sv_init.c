@@ -577,11 +577,24 @@ void SV_ActivateServer( int runPhysics )
 	svgame.globals->time = sv.time;
 	svgame.dllFuncs.pfnServerActivate( svgame.edicts, svgame.numEntities, svs.maxclients );
 
+	// all map entities are spawned now
+	SV_RebuildWorldTree();
+
 	SV_SetStringArrayMode( true );
 
 	// parse user-specified resources
 	SV_CreateGenericResources();
 
+	// server never loads sounds, but local client is going to load them right away
+	if( !Host_IsDedicated( ))
+	{
+		for( i = 1; i < MAX_SOUNDS && sv.sound_precache[i][0]; i++ )
+		{
+			if( sv.sound_precache[i][0] != '!' && sv.sound_precache[i][0] != '*' )
+				FS_Prefetch( va( DEFAULT_SOUNDPATH "%s", sv.sound_precache[i] ));
+		}
+	}
+
 	if( runPhysics )
 	{
 		numFrames = (svs.maxclients <= 1) ? 2 : 8;
@@ -803,7 +816,7 @@ void SV_SetupClients( void )
 	ClearBits( sv_maxclients.flags, FCVAR_CHANGED );
 }
 
-qboolean CRC32_MapFile( dword *crcvalue, const char *filename, qboolean multiplayer )
+qboolean CRC32_MapFile( dword *crcvalue, const char *filename, qboolean multiplayer, qboolean cached )
 {
 	char	headbuf[1024], buffer[1024];
 	int	i, num_bytes, lumplen;
@@ -823,6 +836,12 @@ qboolean CRC32_MapFile( dword *crcvalue, const char *filename, qboolean multipla
 	f = FS_Open( filename, "rb", false );
 	if( !f ) return false;
 
+	if( cached && FS_GetCachedHash( filename, FS_HASH_MAP_CRC32, crcvalue, sizeof( *crcvalue )))
+	{
+		FS_Close( f );
+		return true;
+	}
+
 	// read version number
 	FS_Read( f, &version, sizeof( int ));
 	FS_Seek( f, 0, SEEK_SET );
@@ -877,6 +896,9 @@ qboolean CRC32_MapFile( dword *crcvalue, const char *filename, qboolean multipla
 
 	FS_Close( f );
 
+	if( cached )
+		FS_SetCachedHash( filename, FS_HASH_MAP_CRC32, crcvalue, sizeof( *crcvalue ));
+
 	return 1;
 }
 
@@ -973,6 +995,10 @@ qboolean SV_SpawnServer( const char *mapname, const char *startspot, qboolean ba
 	ClearBits( sv_cheats.flags, FCVAR_READ_ONLY );
 
 	svs.initialized = true;
+
+	// previous level files that were never loaded
+	FS_PrefetchFlush();
+
 	Log_Open();
 	Log_Printf( "Loading map \"%s\"\n", mapname );
 	Log_PrintServerVars();
@@ -1055,7 +1081,7 @@ qboolean SV_SpawnServer( const char *mapname, const char *startspot, qboolean ba
 	Q_snprintf( sv.model_precache[WORLD_INDEX], sizeof( sv.model_precache[0] ), "maps/%s.bsp", sv.name );
 	SetBits( sv.model_precache_flags[WORLD_INDEX], RES_FATALIFMISSING );
 	sv.worldmodel = sv.models[WORLD_INDEX] = Mod_LoadWorld( sv.model_precache[WORLD_INDEX], true );
-	CRC32_MapFile( &sv.worldmapCRC, sv.model_precache[WORLD_INDEX], svs.maxclients > 1 );
+	CRC32_MapFile( &sv.worldmapCRC, sv.model_precache[WORLD_INDEX], svs.maxclients > 1, true );
 
 	if( FBitSet( host.features, ENGINE_QUAKE_COMPATIBLE ) && FS_FileExists( "progs.dat", false ))
 	{
@@ -61,6 +61,12 @@ CVAR_DEFINE_AUTO( sv_trace_messages, "0", FCVAR_LATCH, "enable server usermessag
 CVAR_DEFINE_AUTO( sv_master_response_timeout, "4", FCVAR_ARCHIVE, "master server heartbeat response timeout in seconds" );
 CVAR_DEFINE_AUTO( sv_autosave, "1", FCVAR_ARCHIVE|FCVAR_SERVER|FCVAR_PRIVILEGED, "enable autosaving" );
 CVAR_DEFINE_AUTO( sv_speedhack_kick, "10", FCVAR_ARCHIVE, "number of speedhack warns before automatic kick (0 to disable)" );
+CVAR_DEFINE_AUTO( sv_entvis_cache, "0", FCVAR_ARCHIVE, "share entity visibility test results between clients with the same PVS (game dll must reject entities outside of PVS)" );
+CVAR_DEFINE_AUTO( sv_parallel_snapshots, "0", FCVAR_ARCHIVE, "encode client snapshots on worker threads, game dll delta encoders are serialized" );
+CVAR_DEFINE_AUTO( sv_delta_cache, "0", FCVAR_ARCHIVE, "encode identical entity deltas only once per frame (game dll delta encoders must depend only on the states and the receiving player)" );
+CVAR_DEFINE_AUTO( sv_entity_index, "0", FCVAR_ARCHIVE, "hash index for FindEntityByString on classname, targetname, target, globalname and netname (game dll must not copy these fields between entities and search them in the same frame)" );
+CVAR_DEFINE_AUTO( sv_spatial_queries, "0", FCVAR_ARCHIVE, "use entity grid for FindEntityInSphere and entity leafs for EntitiesInPVS" );
+CVAR_DEFINE_AUTO( sv_world_tree, "0", FCVAR_ARCHIVE, "entity areanode tree: 0 - classic 32 nodes, 1 - adaptive to world size and entities (applied on map load)" );
 
 // game-related cvars
 CVAR_DEFINE_AUTO( mapcyclefile, "mapcycle.txt", 0, "name of multiplayer map cycle configuration file" );
@@ -967,6 +973,12 @@ void SV_Init( void )
 	Cvar_RegisterVariable( &sv_enttools_maxfire );
 
 	Cvar_RegisterVariable( &sv_speedhack_kick );
+	Cvar_RegisterVariable( &sv_entvis_cache );
+	Cvar_RegisterVariable( &sv_parallel_snapshots );
+	Cvar_RegisterVariable( &sv_delta_cache );
+	Cvar_RegisterVariable( &sv_world_tree );
+	Cvar_RegisterVariable( &sv_entity_index );
+	Cvar_RegisterVariable( &sv_spatial_queries );
 
 	Cvar_RegisterVariable( &sv_allow_joystick );
 	Cvar_RegisterVariable( &sv_allow_mouse );
@@ -2116,6 +2116,7 @@ static server_physics_api_t gPhysicsAPI =
 	COM_SaveFile,
 	pfnLoadImagePixels,
 	pfnGetModelName,
+	SV_MoveBatch,
 };
 
 /*
@@ -2128,13 +2129,21 @@ Initialize server external physics
 qboolean SV_InitPhysicsAPI( void )
 {
 	static PHYSICAPI	pPhysIface;
+	int		version;
 
 	pPhysIface = (PHYSICAPI)COM_GetProcAddress( svgame.hInstance, "Server_GetPhysicsInterface" );
 	if( pPhysIface )
 	{
-		if( pPhysIface( SV_PHYSICS_INTERFACE_VERSION, &gPhysicsAPI, &svgame.physFuncs ))
+		// older game dlls are strict about the version, newer api only has functions appended
+		for( version = SV_PHYSICS_INTERFACE_VERSION; version >= SV_PHYSICS_INTERFACE_VERSION_MIN; version-- )
 		{
-			Con_Reportf( "SV_LoadProgs: ^2initailized extended PhysicAPI ^7ver. %i\n", SV_PHYSICS_INTERFACE_VERSION );
+			if( pPhysIface( version, &gPhysicsAPI, &svgame.physFuncs ))
+				break;
+		}
+
+		if( version >= SV_PHYSICS_INTERFACE_VERSION_MIN )
+		{
+			Con_Reportf( "SV_LoadProgs: ^2initailized extended PhysicAPI ^7ver. %i\n", version );
 
 			if( svgame.physFuncs.SV_CheckFeatures != NULL )
 			{
@@ -1671,6 +1671,7 @@ static int LoadGameState( char const *level, qboolean changelevel )
 			{
 				// force the entity to be relinked
 //				SV_LinkEdict( pent, false );
+				SV_EdictGridLink( pent );
 			}
 		}
 	}
@@ -1887,6 +1888,8 @@ static int CreateEntityTransitionList( SAVERESTOREDATA *pSaveData, int levelMask
 				}
 				else
 				{
+					SV_EdictGridLink( pent );
+
 					if( !FBitSet( pTable->flags, FENTTABLE_PLAYER ) && EntityInSolid( pent ))
 					{
 						// this can happen during normal processing - PVS is just a guess,
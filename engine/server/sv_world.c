@@ -30,6 +30,8 @@ typedef struct moveclip_s
 	int		type;		// move type
 	qboolean		ignoretrans;
 	qboolean		monsterclip;
+	vec3_t		trace_endpos;	// world trace result
+	float		trace_fraction;
 } moveclip_t;
 
 /*
@@ -366,9 +368,22 @@ ENTITY AREA CHECKING
 ===============================================================================
 */
 static int	iTouchLinkSemaphore = 0;	// prevent recursion when SV_TouchLinks is active
-areanode_t	sv_areanodes[AREA_NODES];
+areanode_t	sv_areanodes[AREA_MAX_NODES];
 static int	sv_numareanodes;
 
+static areanode_t *SV_AllocAreaNode( void )
+{
+	areanode_t	*anode;
+
+	anode = &sv_areanodes[sv_numareanodes++];
+
+	ClearLink( &anode->trigger_edicts );
+	ClearLink( &anode->solid_edicts );
+	ClearLink( &anode->portal_edicts );
+
+	return anode;
+}
+
 /*
 ===============
 SV_CreateAreaNode
@@ -383,11 +398,7 @@ static areanode_t *SV_CreateAreaNode( int depth, vec3_t mins, vec3_t maxs )
 	vec3_t		mins1, maxs1;
 	vec3_t		mins2, maxs2;
 
-	anode = &sv_areanodes[sv_numareanodes++];
-
-	ClearLink( &anode->trigger_edicts );
-	ClearLink( &anode->solid_edicts );
-	ClearLink( &anode->portal_edicts );
+	anode = SV_AllocAreaNode();
 
 	if( depth == AREA_DEPTH )
 	{
@@ -414,6 +425,277 @@ static areanode_t *SV_CreateAreaNode( int depth, vec3_t mins, vec3_t maxs )
 	return anode;
 }
 
+/*
+===============
+SV_CreateAdaptiveNode
+
+builds a tree that goes down to AREA_MIN_SIZE cells,
+when edicts are known, the split planes are follows them
+and empty space isn't subdivided
+===============
+*/
+static areanode_t *SV_CreateAdaptiveNode( int depth, vec3_t mins, vec3_t maxs, edict_t **ents, int numents )
+{
+	areanode_t	*anode;
+	vec3_t		size;
+	vec3_t		mins1, maxs1;
+	vec3_t		mins2, maxs2;
+	int		i, numfront, numback;
+	float		center;
+
+	anode = SV_AllocAreaNode();
+
+	VectorSubtract( maxs, mins, size );
+	if( size[0] > size[1] )
+		anode->axis = 0;
+	else anode->axis = 1;
+
+	// tall maps are splitted vertically too
+	if( size[2] > size[anode->axis] )
+		anode->axis = 2;
+
+	// never be coarser than classic tree, edicts may be spawned later
+	if( depth == AREA_MAX_DEPTH || size[anode->axis] < AREA_MIN_SIZE * 2.0f || ( ents && numents < AREA_LEAF_EDICTS && depth >= AREA_DEPTH ))
+	{
+		anode->axis = -1;
+		anode->children[0] = anode->children[1] = NULL;
+		return anode;
+	}
+
+	if( numents > 0 )
+	{
+		// split at average edicts position, but keep children reasonably sized
+		for( i = 0, center = 0.0f; i < numents; i++ )
+			center += ( ents[i]->v.absmin[anode->axis] + ents[i]->v.absmax[anode->axis] ) * 0.5f;
+
+		center /= numents;
+		anode->dist = bound( mins[anode->axis] + size[anode->axis] * 0.25f, center, maxs[anode->axis] - size[anode->axis] * 0.25f );
+	}
+	else anode->dist = 0.5f * ( maxs[anode->axis] + mins[anode->axis] );
+
+	// sort edicts to the front side, back side and crossing the plane
+	for( i = numfront = 0; i < numents; i++ )
+	{
+		if( ents[i]->v.absmin[anode->axis] > anode->dist )
+		{
+			edict_t *temp = ents[numfront];
+			ents[numfront++] = ents[i];
+			ents[i] = temp;
+		}
+	}
+
+	for( i = numfront, numback = 0; i < numents; i++ )
+	{
+		if( ents[i]->v.absmax[anode->axis] < anode->dist )
+		{
+			edict_t *temp = ents[numfront + numback];
+			ents[numfront + numback++] = ents[i];
+			ents[i] = temp;
+		}
+	}
+
+	VectorCopy( mins, mins1 );
+	VectorCopy( mins, mins2 );
+	VectorCopy( maxs, maxs1 );
+	VectorCopy( maxs, maxs2 );
+
+	maxs1[anode->axis] = mins2[anode->axis] = anode->dist;
+	anode->children[0] = SV_CreateAdaptiveNode( depth+1, mins2, maxs2, ents, ents ? numfront : 0 );
+	anode->children[1] = SV_CreateAdaptiveNode( depth+1, mins1, maxs1, ents ? ents + numfront : NULL, numback );
+
+	return anode;
+}
+
+/*
+===============================================================================
+
+EDICT GRID
+
+every valid edict including non-solid ones, by position of absmin,
+used for spatial queries from game dll
+
+===============================================================================
+*/
+#define EDICTGRID_CELL_SIZE	256.0f
+#define EDICTGRID_MAX_SIDE	128
+
+static struct
+{
+	int	*heads;	// numcells + 1, the last one is for oversized edicts
+	int	*next;	// per edict chains, 0 is the end
+	int	*prev;
+	int	*cell;	// -1 if edict isn't in grid
+	int	maxedicts;
+	int	width, height, numcells;
+	float	cellsize;
+	vec3_t	mins;
+	uint	generation;	// changed every time something is moved
+} sv_edictgrid;
+
+static int SV_EdictGridCoord( float value, int axis, int side )
+{
+	int	coord = (int)floor(( value - sv_edictgrid.mins[axis] ) / sv_edictgrid.cellsize );
+
+	return bound( 0, coord, side - 1 );
+}
+
+/*
+===============
+SV_EdictGridUnlink
+===============
+*/
+void SV_EdictGridUnlink( edict_t *ent )
+{
+	int	e = NUM_FOR_EDICT( ent );
+
+	if( e < 0 || e >= sv_edictgrid.maxedicts || sv_edictgrid.cell[e] < 0 )
+		return;
+
+	if( sv_edictgrid.prev[e] )
+		sv_edictgrid.next[sv_edictgrid.prev[e]] = sv_edictgrid.next[e];
+	else sv_edictgrid.heads[sv_edictgrid.cell[e]] = sv_edictgrid.next[e];
+
+	if( sv_edictgrid.next[e] )
+		sv_edictgrid.prev[sv_edictgrid.next[e]] = sv_edictgrid.prev[e];
+
+	sv_edictgrid.cell[e] = -1;
+	sv_edictgrid.generation++;
+}
+
+/*
+===============
+SV_EdictGridLink
+
+must be called every time when absmin or absmax are changed
+===============
+*/
+void SV_EdictGridLink( edict_t *ent )
+{
+	int	e = NUM_FOR_EDICT( ent );
+	int	cell;
+
+	if( e <= 0 || e >= sv_edictgrid.maxedicts )
+		return;
+
+	SV_EdictGridUnlink( ent );
+	sv_edictgrid.generation++;
+
+	if( ent->free )
+		return;
+
+	if( ent->v.absmax[0] - ent->v.absmin[0] > sv_edictgrid.cellsize || ent->v.absmax[1] - ent->v.absmin[1] > sv_edictgrid.cellsize )
+	{
+		cell = sv_edictgrid.numcells;
+	}
+	else
+	{
+		cell = SV_EdictGridCoord( ent->v.absmin[1], 1, sv_edictgrid.height ) * sv_edictgrid.width;
+		cell += SV_EdictGridCoord( ent->v.absmin[0], 0, sv_edictgrid.width );
+	}
+
+	sv_edictgrid.cell[e] = cell;
+	sv_edictgrid.prev[e] = 0;
+	sv_edictgrid.next[e] = sv_edictgrid.heads[cell];
+	if( sv_edictgrid.heads[cell] )
+		sv_edictgrid.prev[sv_edictgrid.heads[cell]] = e;
+	sv_edictgrid.heads[cell] = e;
+}
+
+/*
+===============
+SV_ClearEdictGrid
+===============
+*/
+static void SV_ClearEdictGrid( void )
+{
+	vec3_t	size;
+	int	e;
+
+	if( sv_edictgrid.maxedicts != GI->max_edicts )
+	{
+		if( sv_edictgrid.maxedicts )
+		{
+			Mem_Free( sv_edictgrid.next );
+			Mem_Free( sv_edictgrid.prev );
+			Mem_Free( sv_edictgrid.cell );
+		}
+
+		sv_edictgrid.maxedicts = GI->max_edicts;
+		sv_edictgrid.next = Mem_Malloc( host.mempool, sv_edictgrid.maxedicts * sizeof( int ));
+		sv_edictgrid.prev = Mem_Malloc( host.mempool, sv_edictgrid.maxedicts * sizeof( int ));
+		sv_edictgrid.cell = Mem_Malloc( host.mempool, sv_edictgrid.maxedicts * sizeof( int ));
+	}
+
+	if( sv_edictgrid.heads )
+		Mem_Free( sv_edictgrid.heads );
+
+	VectorSubtract( sv.worldmodel->maxs, sv.worldmodel->mins, size );
+	sv_edictgrid.cellsize = Q_max( EDICTGRID_CELL_SIZE, Q_max( size[0], size[1] ) / EDICTGRID_MAX_SIDE );
+	sv_edictgrid.width = bound( 1, (int)ceil( size[0] / sv_edictgrid.cellsize ), EDICTGRID_MAX_SIDE );
+	sv_edictgrid.height = bound( 1, (int)ceil( size[1] / sv_edictgrid.cellsize ), EDICTGRID_MAX_SIDE );
+	sv_edictgrid.numcells = sv_edictgrid.width * sv_edictgrid.height;
+	sv_edictgrid.heads = Mem_Calloc( host.mempool, ( sv_edictgrid.numcells + 1 ) * sizeof( int ));
+	VectorCopy( sv.worldmodel->mins, sv_edictgrid.mins );
+	memset( sv_edictgrid.cell, -1, sv_edictgrid.maxedicts * sizeof( int ));
+	sv_edictgrid.generation++;
+
+	// client edicts are already exists
+	for( e = 1; e < svgame.numEntities; e++ )
+		SV_EdictGridLink( EDICT_NUM( e ));
+}
+
+/*
+===============
+SV_EdictGridQuery
+
+returns edicts that may intersect bounds in unspecified order
+===============
+*/
+int SV_EdictGridQuery( const vec3_t mins, const vec3_t maxs, int *list, int maxcount )
+{
+	int	x, y, x0, y0, x1, y1;
+	int	e, count = 0;
+
+	if( !sv_edictgrid.heads )
+		return 0;
+
+	// edicts are linked by absmin, so they can come from previous cell
+	x0 = SV_EdictGridCoord( mins[0] - sv_edictgrid.cellsize, 0, sv_edictgrid.width );
+	y0 = SV_EdictGridCoord( mins[1] - sv_edictgrid.cellsize, 1, sv_edictgrid.height );
+	x1 = SV_EdictGridCoord( maxs[0], 0, sv_edictgrid.width );
+	y1 = SV_EdictGridCoord( maxs[1], 1, sv_edictgrid.height );
+
+	for( y = y0; y <= y1; y++ )
+	{
+		for( x = x0; x <= x1; x++ )
+		{
+			for( e = sv_edictgrid.heads[y * sv_edictgrid.width + x]; e && count < maxcount; e = sv_edictgrid.next[e] )
+				list[count++] = e;
+		}
+	}
+
+	for( e = sv_edictgrid.heads[sv_edictgrid.numcells]; e && count < maxcount; e = sv_edictgrid.next[e] )
+		list[count++] = e;
+
+	return count;
+}
+
+/*
+===============
+SV_EdictGridGeneration
+
+changed every time any edict is moved, 0 if grid isn't available
+(or wrapped around, then caller just falls back to linear search)
+===============
+*/
+uint SV_EdictGridGeneration( void )
+{
+	if( !sv_edictgrid.heads )
+		return 0;
+
+	return sv_edictgrid.generation;
+}
+
 /*
 ===============
 SV_ClearWorld
@@ -437,7 +719,11 @@ void SV_ClearWorld( void )
 	iTouchLinkSemaphore = 0;
 	sv_numareanodes = 0;
 
-	SV_CreateAreaNode( 0, sv.worldmodel->mins, sv.worldmodel->maxs );
+	if( sv_world_tree.value )
+		SV_CreateAdaptiveNode( 0, sv.worldmodel->mins, sv.worldmodel->maxs, NULL, 0 );
+	else SV_CreateAreaNode( 0, sv.worldmodel->mins, sv.worldmodel->maxs );
+
+	SV_ClearEdictGrid();
 }
 
 /*
@@ -584,6 +870,43 @@ static void SV_FindTouchedLeafs( edict_t *ent, mnode_t *node, int *headnode )
 	if( sides & 2 ) SV_FindTouchedLeafs( ent, node->children[1], headnode );
 }
 
+/*
+===============
+SV_LinkToAreaNode
+
+link into the first node that the ent's box crosses
+===============
+*/
+static void SV_LinkToAreaNode( edict_t *ent )
+{
+	areanode_t	*node = sv_areanodes;
+
+	while( 1 )
+	{
+		if( node->axis == -1 ) break;
+		if( ent->v.absmin[node->axis] > node->dist )
+			node = node->children[0];
+		else if( ent->v.absmax[node->axis] < node->dist )
+			node = node->children[1];
+		else break; // crosses the node
+	}
+
+	// link it in
+	if( ent->v.solid == SOLID_TRIGGER )
+		InsertLinkBefore( &ent->area, &node->trigger_edicts );
+	else if( ent->v.solid == SOLID_PORTAL )
+		InsertLinkBefore( &ent->area, &node->portal_edicts );
+	else InsertLinkBefore( &ent->area, &node->solid_edicts );
+}
+
+static int SV_CompareEdicts( const void *a, const void *b )
+{
+	const edict_t	*ent1 = *(const edict_t **)a;
+	const edict_t	*ent2 = *(const edict_t **)b;
+
+	return ( ent1 > ent2 ) - ( ent1 < ent2 );
+}
+
 /*
 ===============
 SV_LinkEdict
@@ -591,7 +914,6 @@ SV_LinkEdict
 */
 void GAME_EXPORT SV_LinkEdict( edict_t *ent, qboolean touch_triggers )
 {
-	areanode_t	*node;
 	int		headnode;
 
 	if( ent->area.prev ) SV_UnlinkEdict( ent );	// unlink from old position
@@ -600,6 +922,7 @@ void GAME_EXPORT SV_LinkEdict( edict_t *ent, qboolean touch_triggers )
 
 	// set the abs box
 	svgame.dllFuncs.pfnSetAbsBox( ent );
+	SV_EdictGridLink( ent );
 
 	if( ent->v.movetype == MOVETYPE_FOLLOW && SV_IsValidEdict( ent->v.aiment ))
 	{
@@ -629,25 +952,7 @@ void GAME_EXPORT SV_LinkEdict( edict_t *ent, qboolean touch_triggers )
 	if( ent->v.solid == SOLID_NOT && ent->v.skin >= CONTENTS_EMPTY )
 		return;
 
-	// find the first node that the ent's box crosses
-	node = sv_areanodes;
-
-	while( 1 )
-	{
-		if( node->axis == -1 ) break;
-		if( ent->v.absmin[node->axis] > node->dist )
-			node = node->children[0];
-		else if( ent->v.absmax[node->axis] < node->dist )
-			node = node->children[1];
-		else break; // crosses the node
-	}
-
-	// link it in
-	if( ent->v.solid == SOLID_TRIGGER )
-		InsertLinkBefore( &ent->area, &node->trigger_edicts );
-	else if( ent->v.solid == SOLID_PORTAL )
-		InsertLinkBefore( &ent->area, &node->portal_edicts );
-	else InsertLinkBefore( &ent->area, &node->solid_edicts );
+	SV_LinkToAreaNode( ent );
 
 	if( touch_triggers && !iTouchLinkSemaphore )
 	{
@@ -657,6 +962,49 @@ void GAME_EXPORT SV_LinkEdict( edict_t *ent, qboolean touch_triggers )
 	}
 }
 
+/*
+===============
+SV_RebuildWorldTree
+
+adaptive tree only: fit split planes to already spawned edicts
+===============
+*/
+void SV_RebuildWorldTree( void )
+{
+	edict_t	**ents;
+	int	i, numents = 0;
+
+	if( !sv_world_tree.value || !sv.worldmodel )
+		return;
+
+	ents = Mem_Malloc( host.mempool, svgame.numEntities * sizeof( *ents ));
+
+	for( i = 1; i < svgame.numEntities; i++ )
+	{
+		edict_t	*ent = EDICT_NUM( i );
+
+		if( !SV_IsValidEdict( ent ) || !ent->area.prev )
+			continue;
+
+		SV_UnlinkEdict( ent );
+		ents[numents++] = ent;
+	}
+
+	memset( sv_areanodes, 0, sizeof( sv_areanodes ));
+	sv_numareanodes = 0;
+
+	SV_CreateAdaptiveNode( 0, sv.worldmodel->mins, sv.worldmodel->maxs, ents, numents );
+
+	// partitioning shuffled the array, keep lists in edict number order
+	qsort( ents, numents, sizeof( *ents ), SV_CompareEdicts );
+
+	for( i = 0; i < numents; i++ )
+		SV_LinkToAreaNode( ents[i] );
+
+	Con_Reportf( "%s: %d nodes for %d edicts\n", __func__, sv_numareanodes, numents );
+	Mem_Free( ents );
+}
+
 /*
 ===============================================================================
 
@@ -1258,6 +1606,53 @@ static void SV_ClipToWorldBrush( areanode_t *node, moveclip_t *clip )
 		SV_ClipToWorldBrush( node->children[1], clip );
 }
 
+/*
+==================
+SV_InitMoveClip
+
+clip move against world, returns false if
+entities don't need to be checked
+==================
+*/
+static qboolean SV_InitMoveClip( moveclip_t *clip, const vec3_t start, vec3_t mins, vec3_t maxs, const vec3_t end, int type, edict_t *e, qboolean monsterclip )
+{
+	memset( clip, 0, sizeof( moveclip_t ));
+	SV_ClipMoveToEntity( EDICT_NUM( 0 ), start, mins, maxs, end, &clip->trace );
+
+	if( clip->trace.fraction == 0.0f )
+		return false;
+
+	VectorCopy( clip->trace.endpos, clip->trace_endpos );
+	clip->trace_fraction = clip->trace.fraction;
+	clip->trace.fraction = 1.0f;
+	clip->start = start;
+	clip->end = clip->trace_endpos;
+	clip->type = (type & 0xFF);
+	clip->ignoretrans = type >> 8;
+	clip->monsterclip = false;
+	clip->passedict = (e) ? e : EDICT_NUM( 0 );
+	clip->mins = mins;
+	clip->maxs = maxs;
+
+	if( monsterclip && !FBitSet( host.features, ENGINE_QUAKE_COMPATIBLE ))
+		clip->monsterclip = true;
+
+	if( clip->type == MOVE_MISSILE )
+	{
+		VectorSet( clip->mins2, -15.0f, -15.0f, -15.0f );
+		VectorSet( clip->maxs2,  15.0f,  15.0f,  15.0f );
+	}
+	else
+	{
+		VectorCopy( mins, clip->mins2 );
+		VectorCopy( maxs, clip->maxs2 );
+	}
+
+	World_MoveBounds( start, clip->mins2, clip->maxs2, clip->trace_endpos, clip->boxmins, clip->boxmaxs );
+
+	return true;
+}
+
 /*
 ==================
 SV_Move
@@ -1266,51 +1661,207 @@ SV_Move
 trace_t SV_Move( const vec3_t start, vec3_t mins, vec3_t maxs, const vec3_t end, int type, edict_t *e, qboolean monsterclip )
 {
 	moveclip_t	clip;
-	vec3_t		trace_endpos;
-	float		trace_fraction;
 
-	memset( &clip, 0, sizeof( moveclip_t ));
-	SV_ClipMoveToEntity( EDICT_NUM( 0 ), start, mins, maxs, end, &clip.trace );
+	if( SV_InitMoveClip( &clip, start, mins, maxs, end, type, e, monsterclip ))
+	{
+		SV_ClipToLinks( sv_areanodes, &clip );
+		SV_ClipToPortals( sv_areanodes, &clip );
 
-	if( clip.trace.fraction != 0.0f )
+		clip.trace.fraction *= clip.trace_fraction;
+		svgame.globals->trace_ent = clip.trace.ent;
+	}
+
+	SV_CopyTraceToGlobal( &clip.trace );
+
+	return clip.trace;
+}
+
+// areanode touched by the whole batch
+typedef struct
+{
+	vec3_t		mins;		// splits on the way from the root,
+	vec3_t		maxs;		// valid only for axes set in sides
+	int		sides;		// bits 0-2 for mins, 3-5 for maxs
+	int		first;		// in edicts list
+	int		count;
+	int		next;		// first node after the subtree
+} batchnode_t;
+
+typedef struct
+{
+	edict_t		*edicts[MAX_EDICTS];
+	int		numedicts;
+	batchnode_t	nodes[AREA_MAX_NODES];
+	int		numnodes;
+} batchlinks_t;
+
+/*
+==================
+SV_GatherLinks
+
+collect nodes touched by bounds with their edicts,
+in the same order as SV_ClipToLinks visits them
+==================
+*/
+static void SV_GatherLinks( areanode_t *node, const vec3_t mins, const vec3_t maxs, const batchnode_t *parent, qboolean portals, batchlinks_t *list )
+{
+	link_t		*head = portals ? &node->portal_edicts : &node->solid_edicts;
+	batchnode_t	*bn = &list->nodes[list->numnodes++];
+	link_t		*l;
+	int		axis;
+
+	if( parent ) *bn = *parent;
+	else bn->sides = 0;
+
+	bn->first = list->numedicts;
+
+	for( l = head->next; l != head && list->numedicts < MAX_EDICTS; l = l->next )
+		list->edicts[list->numedicts++] = EDICT_FROM_AREA( l );
+
+	bn->count = list->numedicts - bn->first;
+
+	// recurse down both sides
+	if( node->axis != -1 )
 	{
-		VectorCopy( clip.trace.endpos, trace_endpos );
-		trace_fraction = clip.trace.fraction;
-		clip.trace.fraction = 1.0f;
-		clip.start = start;
-		clip.end = trace_endpos;
-		clip.type = (type & 0xFF);
-		clip.ignoretrans = type >> 8;
-		clip.monsterclip = false;
-		clip.passedict = (e) ? e : EDICT_NUM( 0 );
-		clip.mins = mins;
-		clip.maxs = maxs;
+		batchnode_t	child;
 
-		if( monsterclip && !FBitSet( host.features, ENGINE_QUAKE_COMPATIBLE ))
-			clip.monsterclip = true;
+		axis = node->axis;
 
-		if( clip.type == MOVE_MISSILE )
+		if( maxs[axis] > node->dist )
 		{
-			VectorSet( clip.mins2, -15.0f, -15.0f, -15.0f );
-			VectorSet( clip.maxs2,  15.0f,  15.0f,  15.0f );
+			child = *bn;
+			if( !FBitSet( child.sides, BIT( axis )) || child.mins[axis] < node->dist )
+				child.mins[axis] = node->dist;
+			SetBits( child.sides, BIT( axis ));
+			SV_GatherLinks( node->children[0], mins, maxs, &child, portals, list );
 		}
-		else
+
+		if( mins[axis] < node->dist )
 		{
-			VectorCopy( mins, clip.mins2 );
-			VectorCopy( maxs, clip.maxs2 );
+			child = *bn;
+			if( !FBitSet( child.sides, BIT( axis + 3 )) || child.maxs[axis] > node->dist )
+				child.maxs[axis] = node->dist;
+			SetBits( child.sides, BIT( axis + 3 ));
+			SV_GatherLinks( node->children[1], mins, maxs, &child, portals, list );
 		}
+	}
 
-		World_MoveBounds( start, clip.mins2, clip.maxs2, trace_endpos, clip.boxmins, clip.boxmaxs );
-		SV_ClipToLinks( sv_areanodes, &clip );
-		SV_ClipToPortals( sv_areanodes, &clip );
+	bn->next = list->numnodes;
+}
 
-		clip.trace.fraction *= trace_fraction;
-		svgame.globals->trace_ent = clip.trace.ent;
+/*
+==================
+SV_ClipToGathered
+
+same as SV_ClipToLinks, nodes that this trace
+wouldn't visit are skipped with their subtrees
+==================
+*/
+static void SV_ClipToGathered( const batchlinks_t *list, moveclip_t *clip )
+{
+	const batchnode_t	*bn;
+	int		i, j, k;
+
+	for( i = 0; i < list->numnodes; )
+	{
+		bn = &list->nodes[i];
+
+		for( k = 0; k < 3; k++ )
+		{
+			if( FBitSet( bn->sides, BIT( k )) && clip->boxmaxs[k] <= bn->mins[k] )
+				break;
+			if( FBitSet( bn->sides, BIT( k + 3 )) && clip->boxmins[k] >= bn->maxs[k] )
+				break;
+		}
+
+		if( k != 3 )
+		{
+			i = bn->next;
+			continue;
+		}
+
+		for( j = 0; j < bn->count; j++ )
+		{
+			if( !SV_ClipToEntity( list->edicts[bn->first + j], clip ))
+				break; // trace.allsolid
+		}
+
+		// SV_ClipToLinks doesn't go deeper after allsolid
+		i = ( j < bn->count ) ? bn->next : i + 1;
+	}
+}
+
+/*
+==================
+SV_MoveBatch
+
+same as SV_Move for every request, but areanode tree is walked
+once for all traces, e.g. for shotgun pellets from one origin
+==================
+*/
+void SV_MoveBatch( const trace_request_t *reqs, trace_t *out, int count )
+{
+	static batchlinks_t	solids, portals;
+	static qboolean	inside;
+	moveclip_t	clips[MAX_TRACE_BATCH];
+	qboolean		active[MAX_TRACE_BATCH];
+	vec3_t		mins, maxs;
+	int		i, j, num, numactive;
+
+	// custom clipping may call it recursively
+	if( inside || count == 1 )
+	{
+		for( i = 0; i < count; i++ )
+			out[i] = SV_Move( reqs[i].start, (float *)reqs[i].mins, (float *)reqs[i].maxs, reqs[i].end, reqs[i].type, reqs[i].ignore, reqs[i].monsterclip );
+		return;
 	}
 
-	SV_CopyTraceToGlobal( &clip.trace );
+	inside = true;
 
-	return clip.trace;
+	for( i = 0; i < count; i += num )
+	{
+		num = Q_min( count - i, MAX_TRACE_BATCH );
+		ClearBounds( mins, maxs );
+		numactive = 0;
+
+		for( j = 0; j < num; j++ )
+		{
+			const trace_request_t *req = &reqs[i + j];
+
+			active[j] = SV_InitMoveClip( &clips[j], req->start, (float *)req->mins, (float *)req->maxs, req->end, req->type, req->ignore, req->monsterclip );
+			if( !active[j] ) continue;
+
+			AddPointToBounds( clips[j].boxmins, mins, maxs );
+			AddPointToBounds( clips[j].boxmaxs, mins, maxs );
+			numactive++;
+		}
+
+		solids.numedicts = solids.numnodes = 0;
+		portals.numedicts = portals.numnodes = 0;
+
+		if( numactive )
+		{
+			SV_GatherLinks( sv_areanodes, mins, maxs, NULL, false, &solids );
+			SV_GatherLinks( sv_areanodes, mins, maxs, NULL, true, &portals );
+		}
+
+		for( j = 0; j < num; j++ )
+		{
+			if( active[j] )
+			{
+				SV_ClipToGathered( &solids, &clips[j] );
+				SV_ClipToGathered( &portals, &clips[j] );
+
+				clips[j].trace.fraction *= clips[j].trace_fraction;
+				svgame.globals->trace_ent = clips[j].trace.ent;
+			}
+
+			SV_CopyTraceToGlobal( &clips[j].trace );
+			out[i + j] = clips[j].trace;
+		}
+	}
+
+	inside = false;
 }
 
 /*
@@ -1618,3 +2169,162 @@ int SV_LightForEntity( edict_t *pEdict )
 
 	return VectorAvg( sv_pointColor );
 }
+
+/*
+==================
+SV_AreaNodeStats
+
+count linked edicts per node
+==================
+*/
+static void SV_AreaNodeStats( areanode_t *node, int depth, int *maxdepth, int *maxlinks, int *numlinks )
+{
+	link_t	*l;
+	int	links = 0;
+
+	for( l = node->solid_edicts.next; l != &node->solid_edicts; l = l->next )
+		links++;
+	for( l = node->trigger_edicts.next; l != &node->trigger_edicts; l = l->next )
+		links++;
+	for( l = node->portal_edicts.next; l != &node->portal_edicts; l = l->next )
+		links++;
+
+	*maxdepth = Q_max( *maxdepth, depth );
+	*maxlinks = Q_max( *maxlinks, links );
+	*numlinks += links;
+
+	if( node->axis == -1 ) return;
+
+	SV_AreaNodeStats( node->children[0], depth + 1, maxdepth, maxlinks, numlinks );
+	SV_AreaNodeStats( node->children[1], depth + 1, maxdepth, maxlinks, numlinks );
+}
+
+/*
+==================
+SV_TraceBenchBatch
+
+shotgun-like traces, MAX_TRACE_BATCH pellets from one origin
+==================
+*/
+static void SV_TraceBenchBatch( int count, uint seed )
+{
+	trace_request_t	reqs[MAX_TRACE_BATCH];
+	trace_t		out[MAX_TRACE_BATCH], trace;
+	double		single = 0.0, batch = 0.0, time;
+	vec3_t		start, dir;
+	int		i, j, k, mismatches = 0;
+
+	for( i = 0; i < count; i += MAX_TRACE_BATCH )
+	{
+		for( k = 0; k < 3; k++ )
+		{
+			seed = seed * 1664525 + 1013904223;
+			start[k] = sv.worldmodel->mins[k] + ( seed >> 8 ) * ( 1.0f / 0xFFFFFF ) * world.size[k];
+			seed = seed * 1664525 + 1013904223;
+			dir[k] = (int)(( seed >> 8 ) % 1024 ) - 512;
+		}
+
+		for( j = 0; j < MAX_TRACE_BATCH; j++ )
+		{
+			trace_request_t *req = &reqs[j];
+
+			// pellets are spread around the main direction
+			for( k = 0; k < 3; k++ )
+			{
+				seed = seed * 1664525 + 1013904223;
+				req->start[k] = start[k];
+				req->end[k] = start[k] + dir[k] + (int)(( seed >> 8 ) % 128 ) - 64;
+			}
+
+			VectorClear( req->mins );
+			VectorClear( req->maxs );
+			req->type = MOVE_NORMAL;
+			req->ignore = NULL;
+			req->monsterclip = false;
+		}
+
+		time = Sys_DoubleTime();
+		SV_MoveBatch( reqs, out, MAX_TRACE_BATCH );
+		batch += Sys_DoubleTime() - time;
+
+		for( j = 0; j < MAX_TRACE_BATCH; j++ )
+		{
+			time = Sys_DoubleTime();
+			trace = SV_Move( reqs[j].start, reqs[j].mins, reqs[j].maxs, reqs[j].end, reqs[j].type, reqs[j].ignore, reqs[j].monsterclip );
+			single += Sys_DoubleTime() - time;
+
+			// batched traces must give exactly the same result
+			if( trace.fraction != out[j].fraction || trace.ent != out[j].ent || trace.allsolid != out[j].allsolid )
+				mismatches++;
+		}
+	}
+
+	Con_Printf( "SV_Move: %.2f ms, SV_MoveBatch: %.2f ms, %d mismatches\n", single * 1000.0, batch * 1000.0, mismatches );
+}
+
+/*
+==================
+SV_TraceBench_f
+
+measure trace throughput for current map and sv_world_tree
+==================
+*/
+void SV_TraceBench_f( void )
+{
+	vec3_t	start, end, mins, maxs;
+	int	maxdepth = 0, maxlinks = 0, numlinks = 0;
+	int	i, j, count = 10000;
+	uint	seed = 0x9E3779B9;
+	double	time;
+
+	if( sv.state != ss_active )
+	{
+		Con_Printf( "^3no server running.\n" );
+		return;
+	}
+
+	if( Cmd_Argc() > 1 )
+		count = Q_max( 1, Q_atoi( Cmd_Argv( 1 )));
+
+	SV_AreaNodeStats( sv_areanodes, 0, &maxdepth, &maxlinks, &numlinks );
+	Con_Printf( "%s tree: %d nodes, depth %d, %d edicts linked, %d in the most crowded node\n",
+		sv_world_tree.value ? "adaptive" : "classic", sv_numareanodes, maxdepth, numlinks, maxlinks );
+
+	if( Cmd_Argc() > 2 && !Q_stricmp( Cmd_Argv( 2 ), "batch" ))
+	{
+		SV_TraceBenchBatch( count, seed );
+		return;
+	}
+
+	time = Sys_DoubleTime();
+
+	for( i = 0; i < count; i++ )
+	{
+		// same pseudo-random traces every run, so results are comparable
+		for( j = 0; j < 3; j++ )
+		{
+			seed = seed * 1664525 + 1013904223;
+			start[j] = sv.worldmodel->mins[j] + ( seed >> 8 ) * ( 1.0f / 0xFFFFFF ) * world.size[j];
+			seed = seed * 1664525 + 1013904223;
+			end[j] = start[j] + ((int)( seed >> 8 ) % 1024 - 512 );
+		}
+
+		// mix point traces with player hull traces
+		if( i & 1 )
+		{
+			VectorSet( mins, -16.0f, -16.0f, -36.0f );
+			VectorSet( maxs, 16.0f, 16.0f, 36.0f );
+		}
+		else
+		{
+			VectorClear( mins );
+			VectorClear( maxs );
+		}
+
+		SV_Move( start, mins, maxs, end, MOVE_NORMAL, NULL, false );
+	}
+
+	time = Sys_DoubleTime() - time;
+
+	Con_Printf( "%d traces in %.2f ms, %.0f traces per second\n", count, time * 1000.0, count / Q_max( time, 0.000001 ));
+}
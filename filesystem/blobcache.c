@@ -0,0 +1,503 @@
+/*
+blobcache.c - on-disk cache of inflated archive entries
+Copyright (C) 2024 Xash3D FWGS contributors
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include "build.h"
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include STDINT_H
+#include "port.h"
+#include "filesystem_internal.h"
+#include "crtlib.h"
+#include "crclib.h"
+#include "xash3d_mathlib.h"
+#include "common/com_strings.h"
+
+#if XASH_POSIX
+#include <unistd.h>
+#include <utime.h>
+#define XASH_FS_BLOBCACHE 1
+#endif
+
+static fs_offset_t fs_blobcache_limit; // zero disables the cache
+
+#if XASH_FS_BLOBCACHE
+#define BLOBCACHE_DIR	"cache/inflated/"
+#define BLOBCACHE_EXT	"blob"
+#define BLOBCACHE_IDENT	(('B'<<24)+('F'<<16)+('N'<<8)+'I') // "INFB"
+#define BLOBCACHE_VERSION	1
+#define BLOBCACHE_MIN_SIZE	( 64 * 1024 )	// smaller entries are inflated faster than looked up
+#define BLOBCACHE_STAMP_STEP	60	// don't touch cache files on every use
+
+// followed by inflated data
+typedef struct blobheader_s
+{
+	int	ident;
+	int	version;
+	int64_t	size;
+	int64_t	offset;	// of the entry in archive
+	int64_t	filetime;	// of the archive
+	uint32_t	crc32;
+	int	reserved;
+	char	archive[MAX_SYSPATH];
+} blobheader_t;
+
+typedef struct blobentry_s
+{
+	char	name[32];
+	fs_offset_t	size;	// on disk, with header
+	time_t	stamp;	// last use time, kept as file modification time
+} blobentry_t;
+
+static struct
+{
+	qboolean	loaded;
+	char	dir[MAX_SYSPATH];	// in the write directory
+	blobentry_t	*entries;
+	int	numentries;
+	int	maxentries;
+	fs_offset_t	totalsize;
+} fs_blobcache;
+
+/*
+================
+FS_BlobCacheInit
+
+cache lives in the write directory, list it on first use
+================
+*/
+static qboolean FS_BlobCacheInit( void )
+{
+	stringlist_t list;
+	int i;
+
+	if( fs_blobcache.loaded )
+		return fs_blobcache.dir[0] != '\0';
+
+	fs_blobcache.loaded = true;
+
+	if( !fs_writepath )
+		return false;
+
+	Q_snprintf( fs_blobcache.dir, sizeof( fs_blobcache.dir ), "%s" BLOBCACHE_DIR, fs_writepath->filename );
+
+	stringlistinit( &list );
+	listdirectory( &list, fs_blobcache.dir );
+
+	for( i = 0; i < list.numstrings; i++ )
+	{
+		char path[MAX_SYSPATH];
+		blobentry_t *entry;
+		struct stat st;
+
+		if( Q_stricmp( COM_FileExtension( list.strings[i] ), BLOBCACHE_EXT ))
+			continue;
+
+		Q_snprintf( path, sizeof( path ), "%s%s", fs_blobcache.dir, list.strings[i] );
+		if( stat( path, &st ) < 0 )
+			continue;
+
+		if( fs_blobcache.numentries == fs_blobcache.maxentries )
+		{
+			fs_blobcache.maxentries = Q_max( 64, fs_blobcache.maxentries * 2 );
+			fs_blobcache.entries = Mem_Realloc( fs_mempool, fs_blobcache.entries, fs_blobcache.maxentries * sizeof( *fs_blobcache.entries ));
+		}
+
+		entry = &fs_blobcache.entries[fs_blobcache.numentries++];
+		Q_strncpy( entry->name, list.strings[i], sizeof( entry->name ));
+		entry->size = st.st_size;
+		entry->stamp = st.st_mtime;
+		fs_blobcache.totalsize += entry->size;
+	}
+
+	stringlistfreecontents( &list );
+
+	return true;
+}
+
+/*
+================
+FS_BlobCacheRemove
+================
+*/
+static void FS_BlobCacheRemove( int index )
+{
+	char path[MAX_SYSPATH];
+
+	Q_snprintf( path, sizeof( path ), "%s%s", fs_blobcache.dir, fs_blobcache.entries[index].name );
+	unlink( path );
+
+	fs_blobcache.totalsize -= fs_blobcache.entries[index].size;
+	fs_blobcache.entries[index] = fs_blobcache.entries[--fs_blobcache.numentries];
+}
+
+/*
+================
+FS_BlobCacheEvict
+
+remove least recently used entries until cache fits into the limit
+================
+*/
+static void FS_BlobCacheEvict( fs_offset_t limit )
+{
+	while( fs_blobcache.numentries && fs_blobcache.totalsize > limit )
+	{
+		int i, oldest = 0;
+
+		for( i = 1; i < fs_blobcache.numentries; i++ )
+		{
+			if( fs_blobcache.entries[i].stamp < fs_blobcache.entries[oldest].stamp )
+				oldest = i;
+		}
+
+		FS_BlobCacheRemove( oldest );
+	}
+}
+
+static int FS_BlobCacheFind( const char *name )
+{
+	int i;
+
+	for( i = 0; i < fs_blobcache.numentries; i++ )
+	{
+		if( !Q_strcmp( fs_blobcache.entries[i].name, name ))
+			return i;
+	}
+
+	return -1;
+}
+
+/*
+================
+FS_BlobCacheKey
+
+fill the header that identifies cached entry, returns false if entry isn't worth caching
+================
+*/
+static qboolean FS_BlobCacheKey( searchpath_t *search, int pack_ind, blobheader_t *hdr, char *name, size_t len )
+{
+	fs_offset_t offset, size;
+	uint32_t crc, namecrc;
+	time_t filetime;
+
+	if( fs_blobcache_limit <= 0 || search->type != SEARCHPATH_ZIP )
+		return false;
+
+	if( !FS_GetDeflatedInfo_ZIP( search, pack_ind, &offset, &size, &crc, &filetime ))
+		return false;
+
+	if( size < BLOBCACHE_MIN_SIZE || size + (fs_offset_t)sizeof( *hdr ) > fs_blobcache_limit )
+		return false;
+
+	if( !FS_BlobCacheInit( ))
+		return false;
+
+	memset( hdr, 0, sizeof( *hdr ));
+	hdr->ident = BLOBCACHE_IDENT;
+	hdr->version = BLOBCACHE_VERSION;
+	hdr->size = size;
+	hdr->offset = offset;
+	hdr->filetime = filetime;
+	hdr->crc32 = crc;
+	Q_strncpy( hdr->archive, search->filename, sizeof( hdr->archive ));
+
+	CRC32_Init( &namecrc );
+	CRC32_ProcessBuffer( &namecrc, hdr->archive, Q_strlen( hdr->archive ));
+	CRC32_ProcessBuffer( &namecrc, &hdr->offset, sizeof( hdr->offset ));
+	Q_snprintf( name, len, "%08x%08x." BLOBCACHE_EXT, CRC32_Final( namecrc ), crc );
+
+	return true;
+}
+
+/*
+================
+FS_BlobCacheCheckData
+
+read the payload that follows the header and compare its checksum
+================
+*/
+static qboolean FS_BlobCacheCheckData( int handle, const blobheader_t *hdr )
+{
+	byte buf[16384];
+	fs_offset_t left = hdr->size;
+	uint32_t crc;
+
+	CRC32_Init( &crc );
+
+	while( left > 0 )
+	{
+		int len = left > sizeof( buf ) ? sizeof( buf ) : left;
+
+		if( read( handle, buf, len ) != len )
+			return false;
+
+		CRC32_ProcessBuffer( &crc, buf, len );
+		left -= len;
+	}
+
+	if( CRC32_Final( crc ) != hdr->crc32 )
+		return false;
+
+	return lseek( handle, sizeof( *hdr ), SEEK_SET ) == sizeof( *hdr );
+}
+
+/*
+================
+FS_BlobCacheOpenEntry
+
+open cached copy and check that it matches the entry,
+payload is verified too unless caller checks it itself
+================
+*/
+static int FS_BlobCacheOpenEntry( const blobheader_t *hdr, const char *name, qboolean verify )
+{
+	char path[MAX_SYSPATH];
+	blobheader_t ondisk;
+	blobentry_t *entry;
+	int index, handle;
+	time_t now;
+
+	if(( index = FS_BlobCacheFind( name )) < 0 )
+		return -1;
+
+	entry = &fs_blobcache.entries[index];
+	Q_snprintf( path, sizeof( path ), "%s%s", fs_blobcache.dir, name );
+
+	if(( handle = open( path, O_RDONLY|O_BINARY )) < 0 )
+	{
+		fs_blobcache.totalsize -= entry->size;
+		*entry = fs_blobcache.entries[--fs_blobcache.numentries];
+		return -1;
+	}
+
+	if( read( handle, &ondisk, sizeof( ondisk )) != sizeof( ondisk ) || memcmp( &ondisk, hdr, sizeof( ondisk ))
+		|| entry->size != hdr->size + (fs_offset_t)sizeof( *hdr )
+		|| ( verify && !FS_BlobCacheCheckData( handle, hdr )))
+	{
+		// archive was changed or cache file is damaged
+		close( handle );
+		FS_BlobCacheRemove( index );
+		return -1;
+	}
+
+	now = time( NULL );
+	if( now - entry->stamp > BLOBCACHE_STAMP_STEP )
+	{
+		entry->stamp = now;
+		utime( path, NULL );
+	}
+
+	return handle;
+}
+
+/*
+================
+FS_BlobCacheLoad
+
+returns 0 terminated buffer with inflated entry if it was cached before
+================
+*/
+byte *FS_BlobCacheLoad( searchpath_t *search, int pack_ind, fs_offset_t *sizeptr )
+{
+	blobheader_t hdr;
+	char name[32];
+	qboolean ok = false;
+	uint32_t crc;
+	byte *data;
+	int handle;
+
+	if( !FS_BlobCacheKey( search, pack_ind, &hdr, name, sizeof( name )))
+		return NULL;
+
+	if(( handle = FS_BlobCacheOpenEntry( &hdr, name, false )) < 0 )
+		return NULL;
+
+	data = Mem_Malloc( fs_mempool, hdr.size + 1 );
+
+	CRC32_Init( &crc );
+
+	if( read( handle, data, hdr.size ) == hdr.size )
+	{
+		CRC32_ProcessBuffer( &crc, data, hdr.size );
+		ok = CRC32_Final( crc ) == hdr.crc32;
+	}
+
+	if( !ok )
+	{
+		int index;
+
+		// damaged cache file, inflate it again
+		close( handle );
+		Mem_Free( data );
+
+		if(( index = FS_BlobCacheFind( name )) >= 0 )
+			FS_BlobCacheRemove( index );
+
+		return NULL;
+	}
+
+	close( handle );
+	data[hdr.size] = '\0';
+
+	if( sizeptr )
+		*sizeptr = hdr.size;
+
+	return data;
+}
+
+/*
+================
+FS_BlobCacheStore
+================
+*/
+void FS_BlobCacheStore( searchpath_t *search, int pack_ind, const byte *data, fs_offset_t size )
+{
+	char path[MAX_SYSPATH], temp[MAX_SYSPATH];
+	blobheader_t hdr;
+	blobentry_t *entry;
+	char name[32];
+	int handle, index;
+	qboolean ok;
+
+	if( !FS_BlobCacheKey( search, pack_ind, &hdr, name, sizeof( name )) || hdr.size != size )
+		return;
+
+	// make room first so the limit is never exceeded
+	if(( index = FS_BlobCacheFind( name )) >= 0 )
+		FS_BlobCacheRemove( index );
+	FS_BlobCacheEvict( fs_blobcache_limit - ( size + (fs_offset_t)sizeof( hdr )));
+
+	Q_snprintf( path, sizeof( path ), "%s%s", fs_blobcache.dir, name );
+	Q_snprintf( temp, sizeof( temp ), "%s.tmp", path );
+	FS_CreatePath( temp );
+
+	if(( handle = open( temp, O_WRONLY|O_BINARY|O_CREAT|O_TRUNC, 0666 )) < 0 )
+		return;
+
+	ok = write( handle, &hdr, sizeof( hdr )) == sizeof( hdr ) && write( handle, data, size ) == size;
+	close( handle );
+
+	// readers never see partially written files
+	if( !ok || rename( temp, path ) < 0 )
+	{
+		Con_Reportf( S_WARN "%s: can't write %s\n", __func__, path );
+		unlink( temp );
+		return;
+	}
+
+	if( fs_blobcache.numentries == fs_blobcache.maxentries )
+	{
+		fs_blobcache.maxentries = Q_max( 64, fs_blobcache.maxentries * 2 );
+		fs_blobcache.entries = Mem_Realloc( fs_mempool, fs_blobcache.entries, fs_blobcache.maxentries * sizeof( *fs_blobcache.entries ));
+	}
+
+	entry = &fs_blobcache.entries[fs_blobcache.numentries++];
+	Q_strncpy( entry->name, name, sizeof( entry->name ));
+	entry->size = size + sizeof( hdr );
+	entry->stamp = time( NULL );
+	fs_blobcache.totalsize += entry->size;
+}
+
+/*
+================
+FS_BlobCacheOpen
+
+file descriptor of inflated copy for mapping, entry is inflated
+and stored if it's not in cache yet, -1 if it can't be cached
+================
+*/
+int FS_BlobCacheOpen( searchpath_t *search, int pack_ind, fs_offset_t *offset, fs_offset_t *size )
+{
+	blobheader_t hdr;
+	char name[32];
+	int handle;
+
+	if( !FS_BlobCacheKey( search, pack_ind, &hdr, name, sizeof( name )))
+		return -1;
+
+	if(( handle = FS_BlobCacheOpenEntry( &hdr, name, true )) < 0 )
+	{
+		byte *data;
+
+		// goes through FS_BlobCacheStore
+		if( !search->pfnLoadFile || !( data = search->pfnLoadFile( search, NULL, pack_ind, NULL )))
+			return -1;
+
+		Mem_Free( data );
+
+		if(( handle = FS_BlobCacheOpenEntry( &hdr, name, true )) < 0 )
+			return -1;
+	}
+
+	*offset = sizeof( hdr );
+	*size = hdr.size;
+
+	return handle;
+}
+
+/*
+================
+FS_BlobCacheFree
+
+forget the index, write directory may change
+================
+*/
+void FS_BlobCacheFree( void )
+{
+	if( fs_blobcache.entries )
+		Mem_Free( fs_blobcache.entries );
+
+	memset( &fs_blobcache, 0, sizeof( fs_blobcache ));
+}
+#else // !XASH_FS_BLOBCACHE
+byte *FS_BlobCacheLoad( searchpath_t *search, int pack_ind, fs_offset_t *sizeptr )
+{
+	return NULL;
+}
+
+void FS_BlobCacheStore( searchpath_t *search, int pack_ind, const byte *data, fs_offset_t size )
+{
+}
+
+int FS_BlobCacheOpen( searchpath_t *search, int pack_ind, fs_offset_t *offset, fs_offset_t *size )
+{
+	return -1;
+}
+
+void FS_BlobCacheFree( void )
+{
+}
+#endif // !XASH_FS_BLOBCACHE
+
+/*
+================
+FS_BlobCacheSetLimit
+
+size limit of inflated entries cache, 0 disables it
+================
+*/
+void FS_BlobCacheSetLimit( fs_offset_t maxsize )
+{
+	fs_blobcache_limit = Q_max( maxsize, 0 );
+
+#if XASH_FS_BLOBCACHE
+	if( fs_blobcache_limit > 0 && FS_BlobCacheInit( ))
+		FS_BlobCacheEvict( fs_blobcache_limit );
+#endif
+}
@@ -31,6 +31,9 @@ GNU General Public License for more details.
 #ifndef FS_CASEFOLD_FL // for compatibility with older distros
 #define FS_CASEFOLD_FL 0x40000000
 #endif // FS_CASEFOLD_FL
+#include <sys/inotify.h>
+#define XASH_DIR_INOTIFY 1
+#define DIRWATCH_MASK ( IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR )
 #endif // XASH_LINUX
 
 #include "port.h"
@@ -46,11 +49,28 @@ enum
 	DIRENTRY_CASEINSENSITIVE = -2, // directory is already caseinsensitive, just copy whatever is left
 };
 
+typedef struct dirwatch_s
+{
+	int wd;
+	char *path; // relative to searchpath root
+} dirwatch_t;
+
+typedef struct dirwatches_s
+{
+	int fd;
+	size_t rootlen;
+	int numwatches;
+	int maxwatches;
+	dirwatch_t *watches;
+} dirwatches_t;
+
 typedef struct dir_s
 {
 	string name;
 	int numentries;
 	struct dir_s *entries; // sorted
+	qboolean watched; // entries are kept up to date by change notifications
+	dirwatches_t *notify; // set only for searchpath root
 } dir_t;
 
 static qboolean Platform_GetDirectoryCaseSensitivity( const char *dir )
@@ -94,6 +114,7 @@ static void FS_FreeDirEntries( dir_t *dir )
 	}
 
 	dir->numentries = DIRENTRY_NOT_SCANNED;
+	dir->watched = false;
 }
 
 static void FS_InitDirEntries( dir_t *dir, const stringlist_t *list )
@@ -110,12 +131,224 @@ static void FS_InitDirEntries( dir_t *dir, const stringlist_t *list )
 		Q_strncpy( entry->name, list->strings[i], sizeof( entry->name ));
 		entry->numentries = DIRENTRY_NOT_SCANNED;
 		entry->entries = NULL;
+		entry->watched = false;
+		entry->notify = NULL;
 	}
 
 	qsort( dir->entries, dir->numentries, sizeof( dir->entries[0] ), FS_SortDirEntries );
 }
 
-static void FS_PopulateDirEntries( dir_t *dir, const char *path )
+static int FS_FindDirEntry( dir_t *dir, const char *name );
+
+#if XASH_DIR_INOTIFY
+/*
+================
+FS_WatchDirectory
+
+subscribe to directory changes, must be done before listing it
+so nothing can happen unnoticed in between
+================
+*/
+static qboolean FS_WatchDirectory( dirwatches_t *notify, const char *path )
+{
+	dirwatch_t *watch;
+	size_t len;
+	int i, wd;
+
+	if( !notify || Q_strlen( path ) < notify->rootlen )
+		return false;
+
+	wd = inotify_add_watch( notify->fd, path, DIRWATCH_MASK );
+	if( wd < 0 )
+		return false;
+
+	// watching same directory again returns same descriptor
+	for( i = 0; i < notify->numwatches; i++ )
+	{
+		if( notify->watches[i].wd == wd )
+			break;
+	}
+
+	if( i == notify->numwatches )
+	{
+		if( notify->numwatches == notify->maxwatches )
+		{
+			notify->maxwatches = Q_max( 16, notify->maxwatches * 2 );
+			notify->watches = Mem_Realloc( fs_mempool, notify->watches, notify->maxwatches * sizeof( *notify->watches ));
+		}
+
+		notify->numwatches++;
+	}
+	else Mem_Free( notify->watches[i].path );
+
+	watch = &notify->watches[i];
+	len = Q_strlen( path + notify->rootlen );
+	watch->wd = wd;
+	watch->path = Mem_Malloc( fs_mempool, len + 1 );
+	memcpy( watch->path, path + notify->rootlen, len + 1 );
+
+	return true;
+}
+
+/*
+================
+FS_LookupWatchedDir
+
+find cached directory by path relative to root, if it's still in cache
+================
+*/
+static dir_t *FS_LookupWatchedDir( dir_t *dir, const char *path )
+{
+	const char *prev, *next;
+
+	for( prev = path; *prev; prev = *next ? next + 1 : next )
+	{
+		char entryname[MAX_SYSPATH];
+		int ret;
+
+		next = Q_strchrnul( prev, '/' );
+		if( next == prev )
+			continue;
+
+		if( dir->numentries <= DIRENTRY_EMPTY_DIRECTORY )
+			return NULL;
+
+		Q_strncpy( entryname, prev, Q_min( next - prev + 1, sizeof( entryname )));
+		if(( ret = FS_FindDirEntry( dir, entryname )) < 0 )
+			return NULL;
+
+		dir = &dir->entries[ret];
+	}
+
+	return dir;
+}
+
+static void FS_MarkDirEntriesStale( dir_t *dir )
+{
+	int i;
+
+	dir->watched = false;
+
+	for( i = 0; i < dir->numentries; i++ )
+	{
+		if( dir->entries[i].entries )
+			FS_MarkDirEntriesStale( &dir->entries[i] );
+	}
+}
+
+/*
+================
+FS_ReadDirNotifications
+
+changed directories lose their watched status and get rescanned on next miss
+================
+*/
+static void FS_ReadDirNotifications( dir_t *root )
+{
+	dirwatches_t *notify = root->notify;
+	char buf[4096];
+	ssize_t len;
+
+	if( !notify )
+		return;
+
+	while(( len = read( notify->fd, buf, sizeof( buf ))) > 0 )
+	{
+		const char *p;
+
+		for( p = buf; p + sizeof( struct inotify_event ) <= buf + len; )
+		{
+			struct inotify_event event;
+			dir_t *dir;
+			int i;
+
+			memcpy( &event, p, sizeof( event ));
+			p += sizeof( event ) + event.len;
+
+			// kernel dropped some events, trust nothing
+			if( FBitSet( event.mask, IN_Q_OVERFLOW ))
+			{
+				FS_MarkDirEntriesStale( root );
+				continue;
+			}
+
+			for( i = 0; i < notify->numwatches; i++ )
+			{
+				if( notify->watches[i].wd == event.wd )
+					break;
+			}
+
+			if( i == notify->numwatches )
+				continue;
+
+			if(( dir = FS_LookupWatchedDir( root, notify->watches[i].path )))
+				dir->watched = false;
+
+			// directory was removed
+			if( FBitSet( event.mask, IN_IGNORED ))
+			{
+				Mem_Free( notify->watches[i].path );
+				notify->watches[i] = notify->watches[--notify->numwatches];
+			}
+		}
+	}
+}
+
+static dirwatches_t *FS_CreateDirWatches( const char *root )
+{
+	dirwatches_t *notify;
+	int fd = inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+
+	if( fd < 0 )
+	{
+		Con_Reportf( S_WARN "%s: can't watch %s: %s\n", __func__, root, strerror( errno ));
+		return NULL;
+	}
+
+	notify = Mem_Calloc( fs_mempool, sizeof( *notify ));
+	notify->fd = fd;
+	notify->rootlen = Q_strlen( root );
+
+	return notify;
+}
+
+static void FS_FreeDirWatches( dirwatches_t *notify )
+{
+	int i;
+
+	if( !notify )
+		return;
+
+	for( i = 0; i < notify->numwatches; i++ )
+		Mem_Free( notify->watches[i].path );
+
+	if( notify->watches )
+		Mem_Free( notify->watches );
+
+	close( notify->fd );
+	Mem_Free( notify );
+}
+#else // !XASH_DIR_INOTIFY
+static qboolean FS_WatchDirectory( dirwatches_t *notify, const char *path )
+{
+	return false;
+}
+
+static void FS_ReadDirNotifications( dir_t *root )
+{
+}
+
+static dirwatches_t *FS_CreateDirWatches( const char *root )
+{
+	return NULL;
+}
+
+static void FS_FreeDirWatches( dirwatches_t *notify )
+{
+}
+#endif // !XASH_DIR_INOTIFY
+
+static void FS_PopulateDirEntries( dir_t *dir, const char *path, dirwatches_t *notify )
 {
 	stringlist_t list;
 
@@ -133,6 +366,8 @@ static void FS_PopulateDirEntries( dir_t *dir, const char *path )
 		return;
 	}
 
+	dir->watched = FS_WatchDirectory( notify, path );
+
 	stringlistinit( &list );
 	listdirectory( &list, path );
 	if( !list.numstrings )
@@ -210,6 +445,7 @@ static void FS_MergeDirEntries( dir_t *dir, const stringlist_t *list )
 
 		newentry->numentries = oldentry->numentries;
 		newentry->entries = oldentry->entries;
+		newentry->watched = oldentry->watched;
 	}
 
 	// now we can free old tree and replace it with temporary
@@ -219,8 +455,9 @@ static void FS_MergeDirEntries( dir_t *dir, const stringlist_t *list )
 	dir->entries = temp.entries;
 }
 
-static int FS_MaybeUpdateDirEntries( dir_t *dir, const char *path, const char *entryname )
+static int FS_MaybeUpdateDirEntries( dir_t *dir, const char *path, const char *entryname, dirwatches_t *notify )
 {
+	qboolean watched = FS_WatchDirectory( notify, path );
 	stringlist_t list;
 	int ret;
 
@@ -262,6 +499,7 @@ static int FS_MaybeUpdateDirEntries( dir_t *dir, const char *path, const char *e
 		else ret = -1;
 	}
 
+	dir->watched = watched;
 	stringlistfreecontents( &list );
 	return ret;
 }
@@ -283,6 +521,7 @@ static inline qboolean FS_AppendToPath( char *dst, size_t *pi, const size_t len,
 
 qboolean FS_FixFileCase( dir_t *dir, const char *path, char *dst, const size_t len, qboolean createpath )
 {
+	dirwatches_t *notify = dir->notify;
 	const char *prev;
 	const char *next;
 	size_t i = 0;
@@ -290,6 +529,8 @@ qboolean FS_FixFileCase( dir_t *dir, const char *path, char *dst, const size_t l
 	if( !FS_AppendToPath( dst, &i, len, dir->name, path, "init" ))
 		return false;
 
+	FS_ReadDirNotifications( dir );
+
 	// nothing to fix
 	if( !COM_CheckStringEmpty( path ))
 		return true;
@@ -299,6 +540,7 @@ qboolean FS_FixFileCase( dir_t *dir, const char *path, char *dst, const size_t l
 		  prev = next + 1, next = Q_strchrnul( prev, '/' ))
 	{
 		qboolean uptodate = false; // do not run second scan if we're just updated our directory list
+		dir_t *parent;
 		size_t temp;
 		char entryname[MAX_SYSPATH];
 		int ret;
@@ -306,7 +548,7 @@ qboolean FS_FixFileCase( dir_t *dir, const char *path, char *dst, const size_t l
 		if( dir->numentries == DIRENTRY_NOT_SCANNED )
 		{
 			// read directory first time
-			FS_PopulateDirEntries( dir, dst );
+			FS_PopulateDirEntries( dir, dst, notify );
 			uptodate = true;
 		}
 
@@ -328,27 +570,31 @@ qboolean FS_FixFileCase( dir_t *dir, const char *path, char *dst, const size_t l
 		{
 			// if we're creating files or folders, we don't care if path doesn't exist
 			// so copy everything that's left and exit without an error
-			if( uptodate || ( ret = FS_MaybeUpdateDirEntries( dir, dst, entryname )) < 0 )
+			// watched directory can't have it either
+			if( uptodate || dir->watched || ( ret = FS_MaybeUpdateDirEntries( dir, dst, entryname, notify )) < 0 )
 				return createpath ? FS_AppendToPath( dst, &i, len, prev, path, "create path" ) : false;
 
 			uptodate = true;
 		}
 
+		parent = dir;
 		dir = &dir->entries[ret];
 		temp = i;
 		if( !FS_AppendToPath( dst, &temp, len, dir->name, path, "case fix" ))
 			return false;
 
-		if( !uptodate && !FS_SysFileOrFolderExists( dst )) // file not found, rescan...
+		// entries of watched directory are known to exist
+		if( !uptodate && !parent->watched && !FS_SysFileOrFolderExists( dst )) // file not found, rescan...
 		{
 			dst[i] = 0; // strip failed part
 
 			// if we're creating files or folders, we don't care if path doesn't exist
 			// so copy everything that's left and exit without an error
-			if(( ret = FS_MaybeUpdateDirEntries( dir, dst, entryname )) < 0 )
+			if(( ret = FS_MaybeUpdateDirEntries( parent, dst, entryname, notify )) < 0 )
 				return createpath ? FS_AppendToPath( dst, &i, len, prev, path, "create path rescan" ) : false;
 
-			dir = &dir->entries[ret];
+			dir = &parent->entries[ret];
+			temp = i;
 			if( !FS_AppendToPath( dst, &temp, len, dir->name, path, "case fix rescan" ))
 				return false;
 		}
@@ -367,6 +613,7 @@ qboolean FS_FixFileCase( dir_t *dir, const char *path, char *dst, const size_t l
 
 static void FS_Close_DIR( searchpath_t *search )
 {
+	FS_FreeDirWatches( search->dir->notify );
 	FS_FreeDirEntries( search->dir );
 	Mem_Free( search->dir );
 }
@@ -483,9 +730,10 @@ void FS_InitDirectorySearchpath( searchpath_t *search, const char *path, int fla
 	search->pfnSearch = FS_Search_DIR;
 
 	// create cache root
-	search->dir = Mem_Malloc( fs_mempool, sizeof( dir_t ));
+	search->dir = Mem_Calloc( fs_mempool, sizeof( dir_t ));
 	Q_strncpy( search->dir->name, search->filename, sizeof( search->dir->name ));
-	FS_PopulateDirEntries( search->dir, path );
+	search->dir->notify = FS_CreateDirWatches( search->filename );
+	FS_PopulateDirEntries( search->dir, search->filename, search->dir->notify );
 }
 
 searchpath_t *FS_AddDir_Fullpath( const char *path, int flags )
@@ -31,6 +31,12 @@ GNU General Public License for more details.
 #include <dirent.h>
 #include <errno.h>
 #endif
+#if XASH_POSIX && !defined( XASH_REDUCE_FD )
+#include <sys/mman.h>
+#include <unistd.h>
+#include <pthread.h>
+#define XASH_FS_MMAP 1
+#endif
 #include <stdio.h>
 #include <stdarg.h>
 #include "port.h"
@@ -56,20 +62,67 @@ static searchpath_t *fs_searchpaths = NULL;	// chain
 static char			fs_basedir[MAX_SYSPATH];	// base game directory
 static char			fs_gamedir[MAX_SYSPATH];	// game current directory
 
+// files of all archives with immutable contents, case insensitive
+typedef struct fs_pathentry_s
+{
+	const char	*name;	// owned by archive
+	uint		hash;
+	int		next;
+	searchpath_t	*search;	// first archive in search order that has the file
+	int		pack_ind;
+	searchpath_t	*gamedir_search;	// same with FS_GAMEDIRONLY_SEARCH_FLAGS
+	int		gamedir_ind;
+} fs_pathentry_t;
+
+static struct
+{
+	fs_pathentry_t	*entries;
+	int		numentries;
+	int		maxentries;
+	int		*heads;	// -1 terminated chains
+	int		hashsize;
+	qboolean		dirty;	// searchpath was removed, rebuild on next lookup
+} fs_pathindex;
+
+typedef struct fs_mapping_s
+{
+	const byte	*data;	// pointer returned to the caller
+	void		*base;	// page aligned start of the mapping
+	size_t		maplen;
+	const searchpath_t	*search;	// archive region key, NULL if view can't be shared
+	int		pack_ind;
+	int		refcount;
+} fs_mapping_t;
+
+static struct
+{
+	fs_mapping_t	*views;
+	int		numviews;
+	int		maxviews;
+#if XASH_FS_MMAP
+	pthread_mutex_t	lock;	// views are shared, so the table is too
+#endif
+} fs_mappings =
+{
+#if XASH_FS_MMAP
+	.lock = PTHREAD_MUTEX_INITIALIZER
+#endif
+};
+
 // add archives in specific order PAK -> PK3 -> WAD
 // so raw WADs takes precedence over WADs included into PAKs and PK3s
 const fs_archive_t g_archives[] =
 {
-{ "pak",    SEARCHPATH_PAK,    FS_AddPak_Fullpath, true },
-{ "pk3",    SEARCHPATH_ZIP,    FS_AddZip_Fullpath, true },
-{ "pk3dir", SEARCHPATH_PK3DIR, FS_AddDir_Fullpath, true },
-{ "wad",    SEARCHPATH_WAD,    FS_AddWad_Fullpath, false },
+{ "pak",    SEARCHPATH_PAK,    FS_AddPak_Fullpath, true,  true },
+{ "pk3",    SEARCHPATH_ZIP,    FS_AddZip_Fullpath, true,  true },
+{ "pk3dir", SEARCHPATH_PK3DIR, FS_AddDir_Fullpath, true,  false },
+{ "wad",    SEARCHPATH_WAD,    FS_AddWad_Fullpath, false, false }, // may be opened through other searchpaths
 { NULL }, // end marker
 };
 
 // special fs_archive_t for plain directories
 static const fs_archive_t g_directory_archive =
-{ NULL, SEARCHPATH_PLAIN, FS_AddDir_Fullpath, false };
+{ NULL, SEARCHPATH_PLAIN, FS_AddDir_Fullpath, false, false };
 
 // static const fs_archive_t g_android_archive =
 // { NULL, SEARCHPATH_ANDROID, FS_AddAndroid_Fullpath, false, false };
@@ -296,24 +349,260 @@ void FS_CreatePath( char *path )
 	}
 }
 
-searchpath_t *FS_AddArchive_Fullpath( const fs_archive_t *archive, const char *file, int flags )
+/*
+================
+FS_PathHash
+================
+*/
+static uint FS_PathHash( const char *name )
 {
-	searchpath_t *search;
+	uint	hash = 2166136261u;
+
+	while( *name )
+		hash = ( hash ^ (byte)Q_tolower( *name++ )) * 16777619u;
+
+	return hash;
+}
+
+/*
+================
+FS_PathIndexLookup
+================
+*/
+static fs_pathentry_t *FS_PathIndexLookup( const char *name, uint hash )
+{
+	int	i;
+
+	if( !fs_pathindex.hashsize )
+		return NULL;
+
+	for( i = fs_pathindex.heads[hash & ( fs_pathindex.hashsize - 1 )]; i >= 0; i = fs_pathindex.entries[i].next )
+	{
+		fs_pathentry_t *e = &fs_pathindex.entries[i];
+
+		if( e->hash == hash && !Q_stricmp( e->name, name ))
+			return e;
+	}
+
+	return NULL;
+}
+
+/*
+================
+FS_PathIndexGrow
+================
+*/
+static void FS_PathIndexGrow( void )
+{
+	int	i, slot;
+
+	fs_pathindex.maxentries = Q_max( 4096, fs_pathindex.maxentries * 2 );
+	fs_pathindex.entries = Mem_Realloc( fs_mempool, fs_pathindex.entries, fs_pathindex.maxentries * sizeof( *fs_pathindex.entries ));
+
+	// keep load factor below 1
+	if( fs_pathindex.heads )
+		Mem_Free( fs_pathindex.heads );
+
+	fs_pathindex.hashsize = fs_pathindex.maxentries;
+	fs_pathindex.heads = Mem_Malloc( fs_mempool, fs_pathindex.hashsize * sizeof( *fs_pathindex.heads ));
+	memset( fs_pathindex.heads, -1, fs_pathindex.hashsize * sizeof( *fs_pathindex.heads ));
+
+	for( i = 0; i < fs_pathindex.numentries; i++ )
+	{
+		slot = fs_pathindex.entries[i].hash & ( fs_pathindex.hashsize - 1 );
+		fs_pathindex.entries[i].next = fs_pathindex.heads[slot];
+		fs_pathindex.heads[slot] = i;
+	}
+}
+
+/*
+================
+FS_PathIndexAdd
+
+add archive files to the index, override is set when
+archive has higher priority than everything already indexed
+================
+*/
+static void FS_PathIndexAdd( searchpath_t *search, qboolean override )
+{
+	qboolean	gamedir = FBitSet( search->flags, FS_GAMEDIRONLY_SEARCH_FLAGS ) ? true : false;
+	const char	*name;
+	int		i, slot;
+
+	if( !search->pfnGetFileName )
+		return;
+
+	for( i = 0; ( name = search->pfnGetFileName( search, i )) != NULL; i++ )
+	{
+		uint		hash = FS_PathHash( name );
+		fs_pathentry_t	*e = FS_PathIndexLookup( name, hash );
+		int		pack_ind = i;
+
+		if( e && ( e->search == search || e->gamedir_search == search ))
+		{
+			// duplicated name in the same archive, take the one that archive finds itself
+			pack_ind = search->pfnFindFile( search, name, NULL, 0 );
+		}
+
+		if( !e )
+		{
+			if( fs_pathindex.numentries == fs_pathindex.maxentries )
+				FS_PathIndexGrow();
+
+			e = &fs_pathindex.entries[fs_pathindex.numentries];
+			e->name = name;
+			e->hash = hash;
+			e->search = e->gamedir_search = NULL;
+			e->pack_ind = e->gamedir_ind = -1;
+
+			slot = hash & ( fs_pathindex.hashsize - 1 );
+			e->next = fs_pathindex.heads[slot];
+			fs_pathindex.heads[slot] = fs_pathindex.numentries++;
+		}
+
+		if( override || !e->search || e->search == search )
+		{
+			e->search = search;
+			e->pack_ind = pack_ind;
+			e->name = name;
+		}
+
+		if( gamedir && ( override || !e->gamedir_search || e->gamedir_search == search ))
+		{
+			e->gamedir_search = search;
+			e->gamedir_ind = pack_ind;
+		}
+	}
+}
+
+/*
+================
+FS_PathIndexRebuild
+================
+*/
+static void FS_PathIndexRebuild( void )
+{
+	searchpath_t	*search;
+
+	fs_pathindex.numentries = 0;
+	if( fs_pathindex.heads )
+		memset( fs_pathindex.heads, -1, fs_pathindex.hashsize * sizeof( *fs_pathindex.heads ));
 
 	for( search = fs_searchpaths; search; search = search->next )
+		FS_PathIndexAdd( search, false );
+
+	fs_pathindex.dirty = false;
+}
+
+/*
+================
+FS_PathIndexFree
+================
+*/
+static void FS_PathIndexFree( void )
+{
+	if( fs_pathindex.entries )
+		Mem_Free( fs_pathindex.entries );
+	if( fs_pathindex.heads )
+		Mem_Free( fs_pathindex.heads );
+	memset( &fs_pathindex, 0, sizeof( fs_pathindex ));
+}
+
+/*
+================
+FS_ForgetMappings
+
+views stay valid after archive is closed,
+but new requests must not share them anymore
+================
+*/
+static void FS_ForgetMappings( const searchpath_t *search )
+{
+#if XASH_FS_MMAP
+	int i;
+
+	pthread_mutex_lock( &fs_mappings.lock );
+
+	for( i = 0; i < fs_mappings.numviews; i++ )
 	{
-		if( search->type == archive->type && !Q_stricmp( search->filename, file ))
-			return search; // already loaded
+		if( fs_mappings.views[i].search == search )
+			fs_mappings.views[i].search = NULL;
 	}
 
-	search = archive->pfnAddArchive_Fullpath( file, flags );
+	pthread_mutex_unlock( &fs_mappings.lock );
+#endif // XASH_FS_MMAP
+}
 
-	if( !search )
-		return NULL;
+/*
+================
+FS_FreeMappings
+================
+*/
+static void FS_FreeMappings( void )
+{
+#if XASH_FS_MMAP
+	int i;
+
+	pthread_mutex_lock( &fs_mappings.lock );
+
+	for( i = 0; i < fs_mappings.numviews; i++ )
+		munmap( fs_mappings.views[i].base, fs_mappings.views[i].maplen );
+
+	if( fs_mappings.views )
+		Mem_Free( fs_mappings.views );
+
+	fs_mappings.views = NULL;
+	fs_mappings.numviews = fs_mappings.maxviews = 0;
 
+	pthread_mutex_unlock( &fs_mappings.lock );
+#endif // XASH_FS_MMAP
+}
+
+/*
+================
+FS_PushSearchPath
+
+insert searchpath at the head of search order
+================
+*/
+static void FS_PushSearchPath( searchpath_t *search )
+{
 	search->next = fs_searchpaths;
 	fs_searchpaths = search;
 
+	if( !fs_pathindex.dirty )
+		FS_PathIndexAdd( search, true );
+}
+
+/*
+================
+FS_FindArchive
+================
+*/
+static searchpath_t *FS_FindArchive( const fs_archive_t *archive, const char *file )
+{
+	searchpath_t *search;
+
+	for( search = fs_searchpaths; search; search = search->next )
+	{
+		if( search->type == archive->type && !Q_stricmp( search->filename, file ))
+			return search;
+	}
+
+	return NULL;
+}
+
+/*
+================
+FS_InsertArchive
+
+add mounted archive to search order with wads it has
+================
+*/
+static void FS_InsertArchive( const fs_archive_t *archive, searchpath_t *search, const char *file, int flags )
+{
+	FS_PushSearchPath( search );
+
 	// time to add in search list all the wads from this archive
 	if( archive->load_wads && !FBitSet( flags, FS_SKIP_ARCHIVED_WADS ))
 	{
@@ -331,14 +620,26 @@ searchpath_t *FS_AddArchive_Fullpath( const fs_archive_t *archive, const char *f
 
 			Q_snprintf( fullpath, sizeof( fullpath ), "%s/%s", file, list.strings[i] );
 			if(( wad = FS_AddWad_Fullpath( fullpath, flags )))
-			{
-				wad->next = fs_searchpaths;
-				fs_searchpaths = wad;
-			}
+				FS_PushSearchPath( wad );
 		}
 
 		stringlistfreecontents( &list );
 	}
+}
+
+searchpath_t *FS_AddArchive_Fullpath( const fs_archive_t *archive, const char *file, int flags )
+{
+	searchpath_t *search;
+
+	if(( search = FS_FindArchive( archive, file )))
+		return search; // already loaded
+
+	search = archive->pfnAddArchive_Fullpath( file, flags );
+
+	if( !search )
+		return NULL;
+
+	FS_InsertArchive( archive, search, file, flags );
 
 	return search;
 }
@@ -373,36 +674,81 @@ then loads and adds pak1.pak pak2.pak ...
 void FS_AddGameDirectory( const char *dir, uint flags )
 {
 	const fs_archive_t *archive;
+	fs_mountjob_t *jobs;
 	stringlist_t list;
 	searchpath_t *search;
-	char fullpath[MAX_SYSPATH];
-	int i;
+	int i, numjobs = 0, numparallel = 0, numthreads;
+	double start = FS_PrefetchTime();
 
 	stringlistinit( &list );
 	listdirectory( &list, dir );
 	stringlistsort( &list );
 
+	jobs = Mem_Calloc( fs_mempool, sizeof( *jobs ) * Q_max( list.numstrings, 1 ));
+
+	// same order as they would be added one by one
 	for( archive = g_archives; archive->ext; archive++ )
 	{
-		if( archive->type == SEARCHPATH_WAD ) // HACKHACK: wads need direct paths but only in this function
-			FS_AllowDirectPaths( true );
-
 		for( i = 0; i < list.numstrings; i++ )
 		{
 			const char *ext = COM_FileExtension( list.strings[i] );
+			fs_mountjob_t *job = &jobs[numjobs];
 
 			if( Q_stricmp( ext, archive->ext ))
 				continue;
 
-			Q_snprintf( fullpath, sizeof( fullpath ), "%s%s", dir, list.strings[i] );
-			FS_AddArchive_Fullpath( archive, fullpath, flags );
-		}
+			Q_snprintf( job->fullpath, sizeof( job->fullpath ), "%s%s", dir, list.strings[i] );
 
-		FS_AllowDirectPaths( false );
+			if( FS_FindArchive( archive, job->fullpath ))
+				continue; // already loaded
+
+			job->archive = archive;
+			job->flags = flags;
+			numjobs++;
+		}
 	}
 
 	stringlistfreecontents( &list );
 
+	// read and index archive directories first, the rest is mounted in place
+	numthreads = FS_MountArchives( jobs, numjobs, &numparallel );
+
+	for( i = 0; i < numjobs; i++ )
+	{
+		fs_mountjob_t *job = &jobs[i];
+
+		if( !job->archive->parallel )
+		{
+			double jobstart = FS_PrefetchTime();
+
+			if( job->archive->type == SEARCHPATH_WAD ) // HACKHACK: wads need direct paths but only in this function
+				FS_AllowDirectPaths( true );
+
+			job->search = FS_AddArchive_Fullpath( job->archive, job->fullpath, flags );
+			job->time = FS_PrefetchTime() - jobstart;
+
+			FS_AllowDirectPaths( false );
+		}
+		else
+		{
+			FS_FlushMountLog( job );
+
+			if( job->search )
+				FS_InsertArchive( job->archive, job->search, job->fullpath, flags );
+		}
+
+		if( job->search )
+			Con_Reportf( "%s: %s mounted in %.2f ms\n", __func__, job->fullpath, job->time * 1000.0 );
+	}
+
+	if( numjobs )
+	{
+		Con_Reportf( "%s: %d archives in %s mounted in %.2f ms, %d indexed by %d threads\n",
+			__func__, numjobs, dir, ( FS_PrefetchTime() - start ) * 1000.0, numparallel, numthreads );
+	}
+
+	Mem_Free( jobs );
+
 	// add the directory to the search path
 	// (unpacked files have the priority over packed files)
 	search = FS_AddArchive_Fullpath( &g_directory_archive, dir, flags );
@@ -419,6 +765,14 @@ void FS_ClearSearchPath( void )
 {
 	searchpath_t *cur, **prev;
 
+	// background reads may use handles of archives being closed
+	FS_PrefetchFlush();
+
+	// cache is stored in the write directory, which is going away
+	FS_HashCacheSave();
+	FS_HashCacheFree();
+	FS_BlobCacheFree();
+
 	prev = &fs_searchpaths;
 
 	while( true )
@@ -436,8 +790,10 @@ void FS_ClearSearchPath( void )
 		}
 
 		*prev = cur->next;
+		FS_ForgetMappings( cur );
 		cur->pfnClose( cur );
 		Mem_Free( cur );
+		fs_pathindex.dirty = true;
 	}
 }
 
@@ -1406,6 +1762,9 @@ qboolean FS_InitStdio( qboolean unused_set_to_true, const char *rootdir, const c
 
 	FS_InitMemory();
 
+	// before mount workers, CRC32 tables are built on first use otherwise
+	CRC32_SetBackend( -1 );
+
 	Q_strncpy( fs_rootdir, rootdir, sizeof( fs_rootdir ));
 	Q_strncpy( fs_gamedir, gamedir, sizeof( fs_gamedir ));
 	Q_strncpy( fs_basedir, basedir, sizeof( fs_basedir ));
@@ -1514,7 +1873,11 @@ void FS_ShutdownStdio( void )
 			Mem_Free( FI.games[i] );
 	}
 
+	FS_PrefetchShutdown();
+	FS_WriterShutdown();
 	FS_ClearSearchPath(); // release all wad files too
+	FS_PathIndexFree();
+	FS_FreeMappings();
 	Mem_FreePool( &fs_mempool );
 }
 
@@ -1547,6 +1910,8 @@ void FS_Path_f( void )
 
 		Con_Printf( "\n" );
 	}
+
+	Con_Printf( "%i archived files indexed\n", fs_pathindex.numentries );
 }
 
 /*
@@ -1621,6 +1986,10 @@ file_t *FS_SysOpen( const char *filepath, const char *mode )
 		}
 	}
 
+	// see the data that is still queued
+	if( FS_WriterPending( ))
+		FS_WriterSync();
+
 	file = (file_t *)Mem_Calloc( fs_mempool, sizeof( *file ));
 	file->filetime = FS_SysFileTime( filepath );
 	file->ungetc = EOF;
@@ -1653,6 +2022,10 @@ file_t *FS_SysOpen( const char *filepath, const char *mode )
 	if( opt & O_APPEND )  file->position = file->real_length;
 	else lseek( file->handle, 0, SEEK_SET );
 
+	// write only files don't need anything from disk, let them go in background
+	if( mod == O_WRONLY )
+		file->async = FS_WriterStart();
+
 	return file;
 }
 /*
@@ -1816,7 +2189,20 @@ and the file index in the package if relevant
 */
 searchpath_t *FS_FindFile( const char *name, int *index, char *fixedname, size_t len, qboolean gamedironly )
 {
-	searchpath_t	*search;
+	searchpath_t	*search, *indexed = NULL;
+	fs_pathentry_t	*entry;
+	int		indexed_ind = -1;
+
+	if( fs_pathindex.dirty )
+		FS_PathIndexRebuild();
+
+	// archives are answered by the index, only directories
+	// and wads are asked until indexed archive is reached
+	if(( entry = FS_PathIndexLookup( name, FS_PathHash( name ))) != NULL )
+	{
+		indexed = gamedironly ? entry->gamedir_search : entry->search;
+		indexed_ind = gamedironly ? entry->gamedir_ind : entry->pack_ind;
+	}
 
 	// search through the path, one element at a time
 	for( search = fs_searchpaths; search; search = search->next )
@@ -1826,6 +2212,19 @@ searchpath_t *FS_FindFile( const char *name, int *index, char *fixedname, size_t
 		if( gamedironly & !FBitSet( search->flags, FS_GAMEDIRONLY_SEARCH_FLAGS ))
 			continue;
 
+		if( search == indexed )
+		{
+			if( fixedname )
+				Q_strncpy( fixedname, search->pfnGetFileName( search, indexed_ind ), len );
+			if( index )
+				*index = indexed_ind;
+			return search;
+		}
+
+		// not in the index, so it's not in this archive either
+		if( search->pfnGetFileName )
+			continue;
+
 		pack_ind = search->pfnFindFile( search, name, fixedname, len );
 		if( pack_ind >= 0 )
 		{
@@ -1960,6 +2359,7 @@ file_t *FS_Open( const char *filepath, const char *mode, qboolean gamedironly )
 			return NULL;
 
 		FS_CreatePath( real_path ); // Create directories up to the file
+		FS_HashCacheForget( real_path );
 
 		return FS_SysOpen( real_path, mode );
 	}
@@ -1977,16 +2377,27 @@ Close a file
 */
 int FS_Close( file_t *file )
 {
+	int	errors;
+
 	if( !file ) return 0;
 
 	FS_BackupFileName( file, NULL, 0 );
 
+	if( file->zstream )
+		FS_ZipStreamClose( file );
+
+	// writer closes the handle, wait for it so caller knows if the file was saved
+	if( file->async && FS_WriterClose( file->handle, &file->writeerrors ))
+		file->handle = -1;
+
 	if( file->handle >= 0 )
 		if( close( file->handle ))
 			return EOF;
 
+	errors = file->writeerrors;
 	Mem_Free( file );
-	return 0;
+
+	return errors ? EOF : 0;
 }
 
 /*
@@ -2003,6 +2414,14 @@ int FS_Flush( file_t *file )
 	// purge cached data
 	FS_Purge( file );
 
+	if( file->async )
+	{
+		FS_WriterSync();
+
+		if( file->writeerrors )
+			return EOF;
+	}
+
 	// sync
 #if XASH_POSIX
 	if( fsync( file->handle ) < 0 )
@@ -2035,6 +2454,15 @@ fs_offset_t FS_Write( file_t *file, const void *data, size_t datasize )
 	// purge cached data
 	FS_Purge( file );
 
+	if( file->async && FS_WriterQueue( file->handle, &file->writeerrors, data, datasize ))
+	{
+		// writer keeps the data, track position by ourselves
+		file->position += datasize;
+		if( file->real_length < file->position )
+			file->real_length = file->position;
+		return datasize;
+	}
+
 	// write the buffer and update the position
 	result = write( file->handle, data, (fs_offset_t)datasize );
 	file->position = lseek( file->handle, 0, SEEK_CUR );
@@ -2047,6 +2475,22 @@ fs_offset_t FS_Write( file_t *file, const void *data, size_t datasize )
 	return result;
 }
 
+/*
+====================
+FS_ReadRaw
+
+read data at current file position bypassing the buffer
+====================
+*/
+static fs_offset_t FS_ReadRaw( file_t *file, void *buffer, size_t count )
+{
+	if( file->zstream )
+		return FS_ZipStreamRead( file, buffer, count );
+
+	lseek( file->handle, file->offset + file->position, SEEK_SET );
+	return read( file->handle, buffer, count );
+}
+
 /*
 ====================
 FS_Read
@@ -2098,8 +2542,7 @@ fs_offset_t FS_Read( file_t *file, void *buffer, size_t buffersize )
 	{
 		if( count > buffersize )
 			count = buffersize;
-		lseek( file->handle, file->offset + file->position, SEEK_SET );
-		nb = read( file->handle, (byte *)buffer + done, count );
+		nb = FS_ReadRaw( file, (byte *)buffer + done, count );
 
 		if( nb > 0 )
 		{
@@ -2113,8 +2556,7 @@ fs_offset_t FS_Read( file_t *file, void *buffer, size_t buffersize )
 	{
 		if( count > sizeof( file->buff ))
 			count = sizeof( file->buff );
-		lseek( file->handle, file->offset + file->position, SEEK_SET );
-		nb = read( file->handle, file->buff, count );
+		nb = FS_ReadRaw( file, file->buff, count );
 
 		if( nb > 0 )
 		{
@@ -2190,7 +2632,7 @@ int FS_VPrintf( file_t *file, const char *format, va_list ap )
 		buff_size *= 2;
 	}
 
-	len = write( file->handle, tempbuff, len );
+	len = FS_Write( file, tempbuff, len );
 	Mem_Free( tempbuff );
 
 	return len;
@@ -2303,7 +2745,12 @@ int FS_Seek( file_t *file, fs_offset_t offset, int whence )
 	// Purge cached data
 	FS_Purge( file );
 
-	if( lseek( file->handle, file->offset + offset, SEEK_SET ) == -1 )
+	// queued data goes at old position
+	if( file->async )
+		FS_WriterSync();
+
+	// inflate stream seeks by itself on next read
+	if( !file->zstream && lseek( file->handle, file->offset + offset, SEEK_SET ) == -1 )
 		return -1;
 	file->position = offset;
 
@@ -2364,6 +2811,8 @@ byte *FS_LoadFile( const char *path, fs_offset_t *filesizeptr, qboolean gamediro
 	file_t *file;
 	char netpath[MAX_SYSPATH];
 	int pack_ind;
+	double start = FS_PrefetchTime();
+	byte *buf;
 
 	// some mappers used leading '/' or '\' in path to models or sounds
 	if( path[0] == '/' || path[0] == '\\' )
@@ -2380,16 +2829,28 @@ byte *FS_LoadFile( const char *path, fs_offset_t *filesizeptr, qboolean gamediro
 	if( !search )
 		return NULL;
 
+	if(( buf = FS_PrefetchClaim( search, pack_ind, netpath, filesizeptr )))
+		return buf;
+
 	// custom load file function for compressed files
 	if( search->pfnLoadFile )
-		return search->pfnLoadFile( search, netpath, pack_ind, filesizeptr );
+	{
+		fs_offset_t filesize = 0;
+
+		buf = search->pfnLoadFile( search, netpath, pack_ind, &filesize );
+
+		if( filesizeptr )
+			*filesizeptr = filesize;
+
+		FS_PrefetchAccountMiss( start, filesize );
+		return buf;
+	}
 
 	file = search->pfnOpenFile( search, netpath, "rb", pack_ind );
 
 	if( file )
 	{
 		fs_offset_t	filesize = file->real_length;
-		byte *buf;
 
 		buf = (byte *)Mem_Malloc( fs_mempool, filesize + 1 );
 		buf[filesize] = '\0';
@@ -2399,12 +2860,224 @@ byte *FS_LoadFile( const char *path, fs_offset_t *filesizeptr, qboolean gamediro
 		if( filesizeptr )
 			*filesizeptr = filesize;
 
+		FS_PrefetchAccountMiss( start, filesize );
 		return buf;
 	}
 
 	return NULL;
 }
 
+/*
+============
+FS_PrefetchFile
+
+queue file to be read in background, so later
+FS_LoadFile or FS_MapFile won't have to wait for disk
+============
+*/
+void FS_PrefetchFile( const char *path, qboolean gamedironly )
+{
+	searchpath_t *search;
+	char netpath[MAX_SYSPATH];
+	int pack_ind;
+
+	if( path[0] == '/' || path[0] == '\\' )
+		path++;
+
+	if( path[0] == '/' || path[0] == '\\' )
+		path++;
+
+	if( !fs_searchpaths || FS_CheckNastyPath( path ))
+		return;
+
+	search = FS_FindFile( path, &pack_ind, netpath, sizeof( netpath ), gamedironly );
+
+	if( search )
+		FS_PrefetchQueue( search, pack_ind, netpath );
+}
+
+#if XASH_FS_MMAP
+/*
+============
+FS_MapRegion
+
+map [offset, offset + size) of the file descriptor, lock must be held
+============
+*/
+static const byte *FS_MapRegion( int handle, fs_offset_t offset, fs_offset_t size, const searchpath_t *search, int pack_ind )
+{
+	static long pagesize;
+	fs_mapping_t *view;
+	fs_offset_t delta;
+	void *base;
+
+	if( handle < 0 || size <= 0 )
+		return NULL;
+
+	if( !pagesize )
+		pagesize = sysconf( _SC_PAGESIZE );
+
+	delta = offset % pagesize;
+	base = mmap( NULL, size + delta, PROT_READ, MAP_PRIVATE, handle, offset - delta );
+
+	if( base == MAP_FAILED )
+		return NULL;
+
+	if( fs_mappings.numviews == fs_mappings.maxviews )
+	{
+		fs_mappings.maxviews = fs_mappings.maxviews ? fs_mappings.maxviews * 2 : 64;
+		fs_mappings.views = Mem_Realloc( fs_mempool, fs_mappings.views, fs_mappings.maxviews * sizeof( *fs_mappings.views ));
+	}
+
+	view = &fs_mappings.views[fs_mappings.numviews++];
+	view->data = (const byte *)base + delta;
+	view->base = base;
+	view->maplen = size + delta;
+	view->search = search;
+	view->pack_ind = pack_ind;
+	view->refcount = 1;
+
+	return view->data;
+}
+#endif // XASH_FS_MMAP
+
+/*
+============
+FS_MapFile
+
+Read-only view of the file contents, must be released with FS_UnmapFile.
+Stored archive entries and plain files are mapped directly from disk and
+views of the same archive entry are shared. Everything else is loaded into
+memory, so unlike FS_LoadFile the data is never guaranteed to be 0 terminated.
+============
+*/
+const byte *FS_MapFile( const char *path, fs_offset_t *filesizeptr, qboolean gamedironly )
+{
+#if XASH_FS_MMAP
+	searchpath_t *search;
+	char netpath[MAX_SYSPATH];
+	const byte *data = NULL;
+	fs_offset_t offset, size;
+	int pack_ind, handle, i;
+	const char *p = path;
+
+	if( filesizeptr )
+		*filesizeptr = 0;
+
+	// some mappers used leading '/' or '\\' in path to models or sounds
+	if( p[0] == '/' || p[0] == '\\' )
+		p++;
+
+	if( p[0] == '/' || p[0] == '\\' )
+		p++;
+
+	if( !fs_searchpaths || FS_CheckNastyPath( p ))
+		return NULL;
+
+	search = FS_FindFile( p, &pack_ind, netpath, sizeof( netpath ), gamedironly );
+
+	if( !search )
+		return NULL;
+
+	// already in memory
+	if(( data = FS_PrefetchClaim( search, pack_ind, netpath, filesizeptr )))
+		return data;
+
+	if( pack_ind >= 0 && search->pfnGetFileRegion )
+	{
+		pthread_mutex_lock( &fs_mappings.lock );
+
+		for( i = 0; i < fs_mappings.numviews; i++ )
+		{
+			fs_mapping_t *view = &fs_mappings.views[i];
+
+			if( view->search == search && view->pack_ind == pack_ind )
+			{
+				view->refcount++;
+				if( filesizeptr )
+					*filesizeptr = view->maplen - ( view->data - (const byte *)view->base );
+				pthread_mutex_unlock( &fs_mappings.lock );
+				return view->data;
+			}
+		}
+
+		if( search->pfnGetFileRegion( search, pack_ind, &handle, &offset, &size ))
+			data = FS_MapRegion( handle, offset, size, search, pack_ind );
+		else if(( handle = FS_BlobCacheOpen( search, pack_ind, &offset, &size )) >= 0 )
+		{
+			// inflated copy on disk
+			data = FS_MapRegion( handle, offset, size, search, pack_ind );
+			close( handle );
+		}
+
+		pthread_mutex_unlock( &fs_mappings.lock );
+	}
+	else if( search->type == SEARCHPATH_PLAIN || search->type == SEARCHPATH_PK3DIR )
+	{
+		file_t *file = search->pfnOpenFile( search, netpath, "rb", pack_ind );
+
+		if( file )
+		{
+			size = file->real_length;
+			pthread_mutex_lock( &fs_mappings.lock );
+			data = FS_MapRegion( file->handle, file->offset, size, NULL, -1 );
+			pthread_mutex_unlock( &fs_mappings.lock );
+			FS_Close( file );
+		}
+	}
+
+	if( data )
+	{
+		if( filesizeptr )
+			*filesizeptr = size;
+		return data;
+	}
+#endif // XASH_FS_MMAP
+
+	// compressed, empty or mmap isn't available
+	return FS_LoadFile( path, filesizeptr, gamedironly );
+}
+
+/*
+============
+FS_UnmapFile
+============
+*/
+void FS_UnmapFile( const byte *data )
+{
+#if XASH_FS_MMAP
+	int i;
+#endif
+
+	if( !data )
+		return;
+
+#if XASH_FS_MMAP
+	pthread_mutex_lock( &fs_mappings.lock );
+
+	for( i = 0; i < fs_mappings.numviews; i++ )
+	{
+		fs_mapping_t *view = &fs_mappings.views[i];
+
+		if( view->data != data )
+			continue;
+
+		if( --view->refcount <= 0 )
+		{
+			munmap( view->base, view->maplen );
+			fs_mappings.views[i] = fs_mappings.views[--fs_mappings.numviews];
+		}
+
+		pthread_mutex_unlock( &fs_mappings.lock );
+		return;
+	}
+
+	pthread_mutex_unlock( &fs_mappings.lock );
+#endif // XASH_FS_MMAP
+
+	Mem_Free( (void *)data );
+}
+
 qboolean CRC32_File( dword *crcvalue, const char *filename )
 {
 	char	buffer[1024];
@@ -2689,6 +3362,8 @@ qboolean FS_Rename( const char *oldname, const char *newname )
 	if( !FS_FixFileCase( fs_writepath->dir, newname2, newpath, sizeof( newpath ), true ))
 		return false;
 
+	FS_WriterSync();
+
 	ret = rename( oldpath, newpath );
 	if( ret < 0 )
 	{
@@ -2721,6 +3396,8 @@ qboolean GAME_EXPORT FS_Delete( const char *path )
 	if( !FS_FixFileCase( fs_writepath->dir, path2, real_path, sizeof( real_path ), true ))
 		return true;
 
+	FS_WriterSync();
+
 	ret = remove( real_path );
 	if( ret < 0 && errno != ENOENT )
 	{
@@ -2828,6 +3505,7 @@ void FS_InitMemory( void )
 {
 	fs_mempool = Mem_AllocPool( "FileSystem Pool" );
 	fs_searchpaths = NULL;
+	memset( &fs_pathindex, 0, sizeof( fs_pathindex ));
 }
 
 fs_interface_t g_engfuncs =
@@ -2951,6 +3629,19 @@ fs_api_t g_api =
 	(void *)FS_MountArchive_Fullpath,
 
 	FS_GetFullDiskPath,
+
+	FS_MapFile,
+	FS_UnmapFile,
+
+	FS_PrefetchFile,
+	FS_PrefetchInfo,
+	FS_PrefetchFlush,
+
+	FS_GetCachedHash,
+	FS_SetCachedHash,
+	FS_BlobCacheSetLimit,
+	FS_WriterEnable,
+	FS_WriterSync,
 };
 
 int EXPORT GetFSAPI( int version, fs_api_t *api, fs_globals_t **globals, fs_interface_t *engfuncs )
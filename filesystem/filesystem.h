@@ -31,8 +31,8 @@ extern "C"
 {
 #endif // __cplusplus
 
-#define FS_API_VERSION 2 // not stable yet!
-#define FS_API_CREATEINTERFACE_TAG   "XashFileSystem002" // follow FS_API_VERSION!!!
+#define FS_API_VERSION 3 // not stable yet!
+#define FS_API_CREATEINTERFACE_TAG   "XashFileSystem003" // follow FS_API_VERSION!!!
 #define FILESYSTEM_INTERFACE_VERSION "VFileSystem009" // never change this!
 
 // search path flags
@@ -49,6 +49,15 @@ enum
 	FS_GAMEDIRONLY_SEARCH_FLAGS = FS_GAMEDIR_PATH | FS_CUSTOM_PATH | FS_GAMERODIR_PATH
 };
 
+// digest kinds for GetCachedHash/SetCachedHash, cache is stored in user writable
+// directory, so it must only be trusted for server side hashing, never for client checks
+enum
+{
+	FS_HASH_CRC32 = 0, // CRC32_File, not finalized
+	FS_HASH_MD5,       // MD5_HashFile without seed
+	FS_HASH_MAP_CRC32, // CRC32_MapFile in multiplayer mode
+};
+
 typedef struct
 {
 	int	numfilenames;
@@ -192,6 +201,27 @@ typedef struct fs_api_t
 	void *(*MountArchive_Fullpath)( const char *path, int flags );
 
 	qboolean (*GetFullDiskPath)( char *buffer, size_t size, const char *name, qboolean gamedironly );
+
+	// read-only zero-copy loading, view isn't 0 terminated
+	const byte *(*MapFile)( const char *path, fs_offset_t *filesizeptr, qboolean gamedironly );
+	void (*UnmapFile)( const byte *data );
+
+	// background loading, prefetched files are returned by LoadFile and MapFile,
+	// files that weren't loaded hold the cache until PrefetchFlush
+	void (*PrefetchFile)( const char *path, qboolean gamedironly );
+	void (*PrefetchInfo)( qboolean reset );
+	void (*PrefetchFlush)( void );
+
+	// persistent digest cache, entries are dropped when file size or time changes
+	qboolean (*GetCachedHash)( const char *path, int tag, void *digest, size_t size );
+	void (*SetCachedHash)( const char *path, int tag, const void *digest, size_t size );
+
+	// on-disk cache of inflated pk3 entries, 0 disables it
+	void (*SetBlobCacheSize)( fs_offset_t maxsize );
+
+	// write only files are written by background thread, Sync waits for it
+	void (*SetAsyncWrite)( qboolean enable );
+	qboolean (*Sync)( void );
 } fs_api_t;
 
 typedef struct fs_interface_t
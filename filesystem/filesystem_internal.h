@@ -19,6 +19,7 @@ GNU General Public License for more details.
 #ifndef FILESYSTEM_INTERNAL_H
 #define FILESYSTEM_INTERNAL_H
 
+#include "build.h"
 #include "xash3d_types.h"
 #include "filesystem.h"
 
@@ -31,6 +32,7 @@ typedef struct dir_s dir_t;
 typedef struct zip_s zip_t;
 typedef struct pack_s pack_t;
 typedef struct wfile_s wfile_t;
+typedef struct zipstream_s zipstream_t;
 
 #define FILE_BUFF_SIZE		(2048)
 
@@ -45,6 +47,9 @@ struct file_s
 						// contents buffer
 	fs_offset_t		buff_ind, buff_len;		// buffer current index and length
 	byte		buff[FILE_BUFF_SIZE];	// intermediate buffer
+	zipstream_t	*zstream;			// inflate state for deflated zip entries
+	qboolean		async;			// written and closed by writer thread
+	int		writeerrors;		// failed background writes
 #ifdef XASH_REDUCE_FD
 	const char *backup_path;
 	fs_offset_t backup_position;
@@ -92,6 +97,8 @@ typedef struct searchpath_s
 	int     (*pfnFindFile)( struct searchpath_s *search, const char *path, char *fixedname, size_t len );
 	void    (*pfnSearch)( struct searchpath_s *search, stringlist_t *list, const char *pattern, int caseinsensitive );
 	byte   *(*pfnLoadFile)( struct searchpath_s *search, const char *path, int pack_ind, fs_offset_t *filesize );
+	const char *(*pfnGetFileName)( struct searchpath_s *search, int pack_ind ); // NULL past the last file, unset if contents may change
+	qboolean (*pfnGetFileRegion)( struct searchpath_s *search, int pack_ind, int *handle, fs_offset_t *offset, fs_offset_t *size ); // raw stored bytes, unset if not supported
 } searchpath_t;
 
 typedef searchpath_t *(*FS_ADDARCHIVE_FULLPATH)( const char *path, int flags );
@@ -102,8 +109,20 @@ typedef struct fs_archive_s
 	int type;
 	FS_ADDARCHIVE_FULLPATH pfnAddArchive_Fullpath;
 	qboolean load_wads; // load wads from this archive
+	qboolean parallel; // pfnAddArchive_Fullpath doesn't touch searchpaths and can run on worker thread
 } fs_archive_t;
 
+typedef struct fs_mountjob_s
+{
+	const fs_archive_t *archive;
+	char        fullpath[MAX_SYSPATH];
+	int         flags;
+	searchpath_t *search; // result
+	double      time;     // spent in pfnAddArchive_Fullpath
+	char        *log;     // console output held until merge, to keep it in mount order
+	size_t      loglen;
+} fs_mountjob_t;
+
 extern fs_globals_t  FI;
 extern searchpath_t *fs_writepath;
 extern poolhandle_t  fs_mempool;
@@ -116,16 +135,39 @@ extern const fs_archive_t g_archives[];
 
 #define GI FI.GameInfo
 
+// XASH_REDUCE_FD keeps one archive handle open through fs_last_zip, not thread-safe
+#if XASH_POSIX && !XASH_DOS4GW && !defined( XASH_REDUCE_FD )
+#define XASH_FS_PARALLEL_MOUNT 1
+#endif
+
+#if XASH_POSIX && !XASH_DOS4GW && !defined( XASH_REDUCE_FD )
+#define XASH_FS_ASYNC_WRITE 1
+#endif
+
+#if XASH_FS_PARALLEL_MOUNT
+// engine allocator and console aren't thread-safe, so
+// they are serialized while archives are mounted on workers
+#define Mem_Malloc( pool, size ) FS_MemAlloc( pool, size, false, __FILE__, __LINE__ )
+#define Mem_Calloc( pool, size ) FS_MemAlloc( pool, size, true, __FILE__, __LINE__ )
+#define Mem_Realloc( pool, ptr, size ) FS_MemRealloc( pool, ptr, size, true, __FILE__, __LINE__ )
+#define Mem_Free( mem ) FS_MemFree( mem, __FILE__, __LINE__ )
+
+#define Con_Printf  FS_ConPrintf
+#define Con_DPrintf FS_ConDPrintf
+#define Con_Reportf FS_ConReportf
+#else
 #define Mem_Malloc( pool, size ) g_engfuncs._Mem_Alloc( pool, size, false, __FILE__, __LINE__ )
 #define Mem_Calloc( pool, size ) g_engfuncs._Mem_Alloc( pool, size, true, __FILE__, __LINE__ )
 #define Mem_Realloc( pool, ptr, size ) g_engfuncs._Mem_Realloc( pool, ptr, size, true, __FILE__, __LINE__ )
 #define Mem_Free( mem ) g_engfuncs._Mem_Free( mem, __FILE__, __LINE__ )
-#define Mem_AllocPool( name ) g_engfuncs._Mem_AllocPool( name, __FILE__, __LINE__ )
-#define Mem_FreePool( pool ) g_engfuncs._Mem_FreePool( pool, __FILE__, __LINE__ )
 
 #define Con_Printf  (*g_engfuncs._Con_Printf)
 #define Con_DPrintf (*g_engfuncs._Con_DPrintf)
 #define Con_Reportf (*g_engfuncs._Con_Reportf)
+#endif
+#define Mem_AllocPool( name ) g_engfuncs._Mem_AllocPool( name, __FILE__, __LINE__ )
+#define Mem_FreePool( pool ) g_engfuncs._Mem_FreePool( pool, __FILE__, __LINE__ )
+
 #define Sys_Error   (*g_engfuncs._Sys_Error)
 #define Sys_GetNativeObject (*g_engfuncs._Sys_GetNativeObject)
 
@@ -169,6 +211,9 @@ qboolean FS_FileCopy( file_t *pOutput, file_t *pInput, int fileSize );
 
 // file buffer ops
 byte *FS_LoadFile( const char *path, fs_offset_t *filesizeptr, qboolean gamedironly );
+const byte *FS_MapFile( const char *path, fs_offset_t *filesizeptr, qboolean gamedironly );
+void FS_UnmapFile( const byte *data );
+void FS_PrefetchFile( const char *path, qboolean gamedironly );
 byte *FS_LoadDirectFile( const char *path, fs_offset_t *filesizeptr );
 qboolean FS_WriteFile( const char *filename, const void *data, fs_offset_t len );
 
@@ -217,6 +262,65 @@ searchpath_t *FS_AddWad_Fullpath( const char *wadfile, int flags );
 // zip.c
 //
 searchpath_t *FS_AddZip_Fullpath( const char *zipfile, int flags );
+fs_offset_t FS_ZipStreamRead( file_t *file, void *buffer, fs_offset_t size );
+void FS_ZipStreamClose( file_t *file );
+qboolean FS_ZipInflateBuffer( const byte *in, fs_offset_t insize, byte *out, fs_offset_t outsize );
+qboolean FS_GetDeflatedInfo_ZIP( searchpath_t *search, int pack_ind, fs_offset_t *offset, fs_offset_t *size, uint32_t *crc32, time_t *filetime );
+qboolean FS_GetDeflatedRegion_ZIP( searchpath_t *search, int pack_ind, int *handle, fs_offset_t *offset, fs_offset_t *compressed_size, fs_offset_t *size );
+
+//
+// prefetch.c
+//
+void FS_PrefetchQueue( searchpath_t *search, int pack_ind, const char *name );
+byte *FS_PrefetchClaim( const searchpath_t *search, int pack_ind, const char *name, fs_offset_t *filesizeptr );
+void FS_PrefetchFlush( void );
+void FS_PrefetchShutdown( void );
+void FS_PrefetchInfo( qboolean reset );
+double FS_PrefetchTime( void );
+void FS_PrefetchAccountMiss( double start, fs_offset_t size );
+
+//
+// mount.c
+//
+int FS_MountArchives( fs_mountjob_t *jobs, int count, int *numparallel );
+void FS_FlushMountLog( fs_mountjob_t *job );
+#if XASH_FS_PARALLEL_MOUNT
+void *FS_MemAlloc( poolhandle_t pool, size_t size, qboolean clear, const char *filename, int fileline );
+void *FS_MemRealloc( poolhandle_t pool, void *memptr, size_t size, qboolean clear, const char *filename, int fileline );
+void FS_MemFree( void *data, const char *filename, int fileline );
+void FS_ConPrintf( const char *fmt, ... ) _format( 1 );
+void FS_ConDPrintf( const char *fmt, ... ) _format( 1 );
+void FS_ConReportf( const char *fmt, ... ) _format( 1 );
+#endif
+
+//
+// blobcache.c
+//
+void FS_BlobCacheSetLimit( fs_offset_t maxsize );
+byte *FS_BlobCacheLoad( searchpath_t *search, int pack_ind, fs_offset_t *sizeptr );
+void FS_BlobCacheStore( searchpath_t *search, int pack_ind, const byte *data, fs_offset_t size );
+int FS_BlobCacheOpen( searchpath_t *search, int pack_ind, fs_offset_t *offset, fs_offset_t *size );
+void FS_BlobCacheFree( void );
+
+//
+// hashcache.c
+//
+qboolean FS_GetCachedHash( const char *path, int tag, void *digest, size_t size );
+void FS_SetCachedHash( const char *path, int tag, const void *digest, size_t size );
+void FS_HashCacheForget( const char *syspath );
+void FS_HashCacheSave( void );
+void FS_HashCacheFree( void );
+
+//
+// writer.c
+//
+qboolean FS_WriterQueue( int handle, int *errors, const void *data, size_t size );
+qboolean FS_WriterClose( int handle, int *errors );
+qboolean FS_WriterStart( void );
+qboolean FS_WriterPending( void );
+qboolean FS_WriterSync( void );
+void FS_WriterEnable( qboolean enable );
+void FS_WriterShutdown( void );
 
 //
 // dir.c
@@ -63,6 +63,16 @@ extern fs_globals_t *FI;
 
 // file buffer ops
 #define FS_LoadFile (*g_fsapi.LoadFile)
+#define FS_MapFile (*g_fsapi.MapFile)
+#define FS_UnmapFile (*g_fsapi.UnmapFile)
+#define FS_PrefetchFile (*g_fsapi.PrefetchFile)
+#define FS_PrefetchInfo (*g_fsapi.PrefetchInfo)
+#define FS_PrefetchFlush (*g_fsapi.PrefetchFlush)
+#define FS_GetCachedHash (*g_fsapi.GetCachedHash)
+#define FS_SetCachedHash (*g_fsapi.SetCachedHash)
+#define FS_SetBlobCacheSize (*g_fsapi.SetBlobCacheSize)
+#define FS_SetAsyncWrite (*g_fsapi.SetAsyncWrite)
+#define FS_Sync (*g_fsapi.Sync)
 #define FS_LoadDirectFile (*g_fsapi.LoadDirectFile)
 #define FS_WriteFile (*g_fsapi.WriteFile)
 
@@ -0,0 +1,392 @@
+/*
+hashcache.c - persistent cache of file digests
+Copyright (C) 2024 Xash3D FWGS contributors
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include "build.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include STDINT_H
+#include "port.h"
+#include "filesystem_internal.h"
+#include "crtlib.h"
+#include "crclib.h"
+#include "common/com_strings.h"
+
+#define HASHCACHE_FILE	"hashcache.bin"
+#define HASHCACHE_IDENT	(('H'<<24)+('S'<<16)+('H'<<8)+'X') // "XHSH"
+#define HASHCACHE_VERSION	1
+#define HASHCACHE_BUCKETS	1024	// must be power of two
+#define HASHCACHE_MAX_DIGEST	16
+#define HASHCACHE_MAX_AGE	( 30 * 24 * 60 * 60 )	// forget entries unused for a month
+#define HASHCACHE_STAMP_STEP	( 24 * 60 * 60 )	// don't rewrite cache only to update use time
+
+/*
+file format, native byte order because the cache never leaves the machine:
+	int	ident;
+	int	version;
+	int	numentries;
+	entries[numentries]
+	{
+		int64_t	size;
+		int64_t	mtime;
+		int	tag;
+		int	stamp;
+		byte	digest[16];
+		ushort	keylen;
+		char	key[keylen];
+	}
+*/
+
+typedef struct hashcache_entry_s
+{
+	struct hashcache_entry_s *next;
+	int64_t	size;	// of the file
+	int64_t	mtime;	// of the file or the archive that has it
+	int	tag;	// FS_HASH_*
+	uint	stamp;	// last use time
+	byte	digest[HASHCACHE_MAX_DIGEST];
+	char	key[1];	// variable sized, disk path for plain files, archive:name for archived
+} hashcache_entry_t;
+
+static struct
+{
+	hashcache_entry_t	*buckets[HASHCACHE_BUCKETS];
+	int		numentries;
+	qboolean		loaded;
+	qboolean		dirty;
+} fs_hashcache;
+
+/*
+================
+FS_HashCacheFind
+================
+*/
+static hashcache_entry_t *FS_HashCacheFind( const char *key, int tag, hashcache_entry_t ***prevptr )
+{
+	hashcache_entry_t **prev = &fs_hashcache.buckets[COM_HashKey( key, HASHCACHE_BUCKETS )];
+
+	for( ; *prev; prev = &(*prev)->next )
+	{
+		if(( tag < 0 || (*prev)->tag == tag ) && !Q_strcmp( (*prev)->key, key ))
+		{
+			if( prevptr )
+				*prevptr = prev;
+			return *prev;
+		}
+	}
+
+	return NULL;
+}
+
+/*
+================
+FS_HashCacheInsert
+================
+*/
+static hashcache_entry_t *FS_HashCacheInsert( const char *key, int tag )
+{
+	size_t keylen = Q_strlen( key );
+	hashcache_entry_t *entry = Mem_Calloc( fs_mempool, sizeof( *entry ) + keylen );
+	uint hash = COM_HashKey( key, HASHCACHE_BUCKETS );
+
+	memcpy( entry->key, key, keylen + 1 );
+	entry->tag = tag;
+	entry->next = fs_hashcache.buckets[hash];
+	fs_hashcache.buckets[hash] = entry;
+	fs_hashcache.numentries++;
+
+	return entry;
+}
+
+/*
+================
+FS_HashCacheLoad
+
+cache is loaded from the current write directory on first use
+================
+*/
+static void FS_HashCacheLoad( void )
+{
+	const byte *data, *p, *end;
+	fs_offset_t len;
+	int i, numentries;
+
+	if( fs_hashcache.loaded )
+		return;
+
+	fs_hashcache.loaded = true;
+
+	if( !( data = FS_LoadFile( HASHCACHE_FILE, &len, true )))
+		return;
+
+	p = data;
+	end = data + len;
+
+	if( len < 12 || *(int *)p != HASHCACHE_IDENT || *(int *)( p + 4 ) != HASHCACHE_VERSION )
+	{
+		Con_Reportf( S_WARN "%s: %s has wrong format\n", __func__, HASHCACHE_FILE );
+		Mem_Free( (void *)data );
+		return;
+	}
+
+	numentries = *(int *)( p + 8 );
+	p += 12;
+
+	for( i = 0; i < numentries; i++ )
+	{
+		hashcache_entry_t *entry;
+		char key[MAX_SYSPATH * 2];
+		int64_t size, mtime;
+		int tag, stamp;
+		ushort keylen;
+
+		if( end - p < 8 + 8 + 4 + 4 + HASHCACHE_MAX_DIGEST + 2 )
+			break;
+
+		memcpy( &size, p, 8 );
+		memcpy( &mtime, p + 8, 8 );
+		memcpy( &tag, p + 16, 4 );
+		memcpy( &stamp, p + 20, 4 );
+		memcpy( &keylen, p + 24 + HASHCACHE_MAX_DIGEST, 2 );
+
+		if( keylen >= sizeof( key ) || end - p < 26 + HASHCACHE_MAX_DIGEST + keylen )
+			break;
+
+		memcpy( key, p + 26 + HASHCACHE_MAX_DIGEST, keylen );
+		key[keylen] = '\0';
+
+		entry = FS_HashCacheFind( key, tag, NULL );
+		if( !entry )
+			entry = FS_HashCacheInsert( key, tag );
+
+		entry->size = size;
+		entry->mtime = mtime;
+		entry->stamp = stamp;
+		memcpy( entry->digest, p + 24, HASHCACHE_MAX_DIGEST );
+
+		p += 26 + HASHCACHE_MAX_DIGEST + keylen;
+	}
+
+	Mem_Free( (void *)data );
+}
+
+/*
+================
+FS_HashCacheSave
+================
+*/
+void FS_HashCacheSave( void )
+{
+	uint now = (uint)time( NULL );
+	size_t maxsize = 12;
+	byte *data, *p;
+	int i, numentries = 0;
+
+	if( !fs_hashcache.dirty || !fs_writepath )
+		return;
+
+	for( i = 0; i < HASHCACHE_BUCKETS; i++ )
+	{
+		const hashcache_entry_t *entry;
+
+		for( entry = fs_hashcache.buckets[i]; entry; entry = entry->next )
+			maxsize += 26 + HASHCACHE_MAX_DIGEST + Q_strlen( entry->key );
+	}
+
+	p = data = Mem_Malloc( fs_mempool, maxsize );
+	p += 12;
+
+	for( i = 0; i < HASHCACHE_BUCKETS; i++ )
+	{
+		const hashcache_entry_t *entry;
+
+		for( entry = fs_hashcache.buckets[i]; entry; entry = entry->next )
+		{
+			ushort keylen = Q_strlen( entry->key );
+
+			if( now - entry->stamp > HASHCACHE_MAX_AGE )
+				continue;
+
+			memcpy( p, &entry->size, 8 );
+			memcpy( p + 8, &entry->mtime, 8 );
+			memcpy( p + 16, &entry->tag, 4 );
+			memcpy( p + 20, &entry->stamp, 4 );
+			memcpy( p + 24, entry->digest, HASHCACHE_MAX_DIGEST );
+			memcpy( p + 24 + HASHCACHE_MAX_DIGEST, &keylen, 2 );
+			memcpy( p + 26 + HASHCACHE_MAX_DIGEST, entry->key, keylen );
+			p += 26 + HASHCACHE_MAX_DIGEST + keylen;
+			numentries++;
+		}
+	}
+
+	*(int *)data = HASHCACHE_IDENT;
+	*(int *)( data + 4 ) = HASHCACHE_VERSION;
+	*(int *)( data + 8 ) = numentries;
+
+	if( FS_WriteFile( HASHCACHE_FILE, data, p - data ))
+		fs_hashcache.dirty = false;
+
+	Mem_Free( data );
+}
+
+/*
+================
+FS_HashCacheFree
+================
+*/
+void FS_HashCacheFree( void )
+{
+	int i;
+
+	for( i = 0; i < HASHCACHE_BUCKETS; i++ )
+	{
+		while( fs_hashcache.buckets[i] )
+		{
+			hashcache_entry_t *next = fs_hashcache.buckets[i]->next;
+
+			Mem_Free( fs_hashcache.buckets[i] );
+			fs_hashcache.buckets[i] = next;
+		}
+	}
+
+	memset( &fs_hashcache, 0, sizeof( fs_hashcache ));
+}
+
+/*
+================
+FS_HashCacheForget
+
+file at this disk path is being rewritten
+================
+*/
+void FS_HashCacheForget( const char *syspath )
+{
+	hashcache_entry_t *entry, **prev;
+
+	while(( entry = FS_HashCacheFind( syspath, -1, &prev )))
+	{
+		*prev = entry->next;
+		Mem_Free( entry );
+		fs_hashcache.numentries--;
+		fs_hashcache.dirty = true;
+	}
+}
+
+/*
+================
+FS_HashCacheResolve
+
+find out which file will be opened and what identifies its contents
+================
+*/
+static qboolean FS_HashCacheResolve( const char *path, char *key, size_t len, int64_t *size, int64_t *mtime )
+{
+	searchpath_t *search;
+	char netpath[MAX_SYSPATH];
+	file_t *file;
+	int pack_ind;
+
+	if( path[0] == '/' || path[0] == '\\' )
+		path++;
+
+	if( path[0] == '/' || path[0] == '\\' )
+		path++;
+
+	if( !( search = FS_FindFile( path, &pack_ind, netpath, sizeof( netpath ), false )))
+		return false;
+
+	if( search->type == SEARCHPATH_PLAIN || search->type == SEARCHPATH_PK3DIR )
+		Q_snprintf( key, len, "%s%s", search->filename, netpath );
+	else Q_snprintf( key, len, "%s:%s", search->filename, netpath );
+
+	if( !( file = search->pfnOpenFile( search, netpath, "rb", pack_ind )))
+		return false;
+
+	*size = file->real_length;
+	*mtime = search->pfnFileTime( search, netpath );
+	FS_Close( file );
+
+	return *mtime != -1;
+}
+
+/*
+================
+FS_GetCachedHash
+
+returns true if digest of unchanged file is known
+================
+*/
+qboolean FS_GetCachedHash( const char *path, int tag, void *digest, size_t size )
+{
+	hashcache_entry_t *entry;
+	char key[MAX_SYSPATH * 2];
+	int64_t filesize, mtime;
+	uint now;
+
+	if( size > HASHCACHE_MAX_DIGEST )
+		return false;
+
+	FS_HashCacheLoad();
+
+	if( !fs_hashcache.numentries || !FS_HashCacheResolve( path, key, sizeof( key ), &filesize, &mtime ))
+		return false;
+
+	entry = FS_HashCacheFind( key, tag, NULL );
+	if( !entry || entry->size != filesize || entry->mtime != mtime )
+		return false;
+
+	now = (uint)time( NULL );
+	if( now - entry->stamp > HASHCACHE_STAMP_STEP )
+	{
+		entry->stamp = now;
+		fs_hashcache.dirty = true;
+	}
+
+	memcpy( digest, entry->digest, size );
+	return true;
+}
+
+/*
+================
+FS_SetCachedHash
+
+remember digest of the file that will be opened by this path
+================
+*/
+void FS_SetCachedHash( const char *path, int tag, const void *digest, size_t size )
+{
+	hashcache_entry_t *entry;
+	char key[MAX_SYSPATH * 2];
+	int64_t filesize, mtime;
+
+	if( size > HASHCACHE_MAX_DIGEST )
+		return;
+
+	FS_HashCacheLoad();
+
+	if( !FS_HashCacheResolve( path, key, sizeof( key ), &filesize, &mtime ))
+		return;
+
+	entry = FS_HashCacheFind( key, tag, NULL );
+	if( !entry )
+		entry = FS_HashCacheInsert( key, tag );
+
+	entry->size = filesize;
+	entry->mtime = mtime;
+	entry->stamp = (uint)time( NULL );
+	memset( entry->digest, 0, sizeof( entry->digest ));
+	memcpy( entry->digest, digest, size );
+	fs_hashcache.dirty = true;
+}
@@ -0,0 +1,284 @@
+/*
+mount.c - parallel archive mounting
+Copyright (C) 2024 Xash3D FWGS contributors
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include "build.h"
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include "port.h"
+#include "filesystem_internal.h"
+#include "crtlib.h"
+#include "xash3d_mathlib.h"
+
+#define FS_MOUNT_THREADS	8
+#define FS_MOUNT_MIN_THREADS	4	// mostly waiting for disk on cold start, so don't limit by cores too much
+
+enum
+{
+	MOUNTLOG_PRINTF = 0,
+	MOUNTLOG_DPRINTF,
+	MOUNTLOG_REPORTF,
+};
+
+/*
+================
+FS_MountOne
+================
+*/
+static void FS_MountOne( fs_mountjob_t *job )
+{
+	double start = FS_PrefetchTime();
+
+	job->search = job->archive->pfnAddArchive_Fullpath( job->fullpath, job->flags );
+	job->time = FS_PrefetchTime() - start;
+}
+
+#if XASH_FS_PARALLEL_MOUNT
+#include <pthread.h>
+#include <unistd.h>
+
+static struct
+{
+	pthread_mutex_t	lock;	// serializes engine calls and job queue
+	qboolean		active;	// only changed by main thread while no workers are running
+
+	fs_mountjob_t	*jobs;
+	int		count;
+	int		next;
+} fs_mount = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+// job of the current thread, its console output is held back
+static __thread fs_mountjob_t *fs_mount_current;
+
+static void *FS_MountWorker( void *arg )
+{
+	while( 1 )
+	{
+		fs_mountjob_t *job;
+
+		pthread_mutex_lock( &fs_mount.lock );
+		job = fs_mount.next < fs_mount.count ? &fs_mount.jobs[fs_mount.next++] : NULL;
+		pthread_mutex_unlock( &fs_mount.lock );
+
+		if( !job )
+			break;
+
+		if( !job->archive->parallel )
+			continue;
+
+		fs_mount_current = job;
+		FS_MountOne( job );
+		fs_mount_current = NULL;
+	}
+
+	return NULL;
+}
+
+/*
+================
+FS_MountArchives
+
+run pfnAddArchive_Fullpath for every job of archive type that
+allows it, returns amount of threads used
+================
+*/
+int FS_MountArchives( fs_mountjob_t *jobs, int count, int *numparallel )
+{
+	pthread_t threads[FS_MOUNT_THREADS];
+	int i, numthreads = 1, numcpus = 1;
+
+	for( i = 0, *numparallel = 0; i < count; i++ )
+	{
+		if( jobs[i].archive->parallel )
+			( *numparallel )++;
+	}
+
+#ifdef _SC_NPROCESSORS_ONLN
+	numcpus = sysconf( _SC_NPROCESSORS_ONLN );
+#endif
+	numcpus = Q_max( numcpus, FS_MOUNT_MIN_THREADS );
+	numcpus = bound( 1, Q_min( numcpus, *numparallel ), FS_MOUNT_THREADS + 1 );
+
+	fs_mount.jobs = jobs;
+	fs_mount.count = count;
+	fs_mount.next = 0;
+	fs_mount.active = true;
+
+	// main thread is a worker too
+	for( i = 0; i < numcpus - 1; i++ )
+	{
+		if( pthread_create( &threads[i], NULL, FS_MountWorker, NULL ))
+			break;
+		numthreads++;
+	}
+
+	FS_MountWorker( NULL );
+
+	for( i = 0; i < numthreads - 1; i++ )
+		pthread_join( threads[i], NULL );
+
+	fs_mount.active = false;
+	fs_mount.jobs = NULL;
+	fs_mount.count = 0;
+
+	return numthreads;
+}
+
+static void FS_MountLog( int level, const char *fmt, va_list args )
+{
+	fs_mountjob_t *job = fs_mount_current;
+	char buf[4096];
+	int len;
+
+	len = Q_vsnprintf( buf, sizeof( buf ), fmt, args );
+	if( len < 0 )
+		len = Q_strlen( buf );
+
+	if( !job )
+	{
+		if( fs_mount.active )
+			pthread_mutex_lock( &fs_mount.lock );
+
+		switch( level )
+		{
+		case MOUNTLOG_PRINTF: g_engfuncs._Con_Printf( "%s", buf ); break;
+		case MOUNTLOG_DPRINTF: g_engfuncs._Con_DPrintf( "%s", buf ); break;
+		default: g_engfuncs._Con_Reportf( "%s", buf ); break;
+		}
+
+		if( fs_mount.active )
+			pthread_mutex_unlock( &fs_mount.lock );
+		return;
+	}
+
+	// level byte, message and terminator
+	job->log = realloc( job->log, job->loglen + len + 2 );
+	job->log[job->loglen] = level;
+	memcpy( job->log + job->loglen + 1, buf, len + 1 );
+	job->loglen += len + 2;
+}
+
+void FS_ConPrintf( const char *fmt, ... )
+{
+	va_list args;
+
+	va_start( args, fmt );
+	FS_MountLog( MOUNTLOG_PRINTF, fmt, args );
+	va_end( args );
+}
+
+void FS_ConDPrintf( const char *fmt, ... )
+{
+	va_list args;
+
+	va_start( args, fmt );
+	FS_MountLog( MOUNTLOG_DPRINTF, fmt, args );
+	va_end( args );
+}
+
+void FS_ConReportf( const char *fmt, ... )
+{
+	va_list args;
+
+	va_start( args, fmt );
+	FS_MountLog( MOUNTLOG_REPORTF, fmt, args );
+	va_end( args );
+}
+
+void *FS_MemAlloc( poolhandle_t pool, size_t size, qboolean clear, const char *filename, int fileline )
+{
+	void *mem;
+
+	if( !fs_mount.active )
+		return g_engfuncs._Mem_Alloc( pool, size, clear, filename, fileline );
+
+	pthread_mutex_lock( &fs_mount.lock );
+	mem = g_engfuncs._Mem_Alloc( pool, size, clear, filename, fileline );
+	pthread_mutex_unlock( &fs_mount.lock );
+
+	return mem;
+}
+
+void *FS_MemRealloc( poolhandle_t pool, void *memptr, size_t size, qboolean clear, const char *filename, int fileline )
+{
+	void *mem;
+
+	if( !fs_mount.active )
+		return g_engfuncs._Mem_Realloc( pool, memptr, size, clear, filename, fileline );
+
+	pthread_mutex_lock( &fs_mount.lock );
+	mem = g_engfuncs._Mem_Realloc( pool, memptr, size, clear, filename, fileline );
+	pthread_mutex_unlock( &fs_mount.lock );
+
+	return mem;
+}
+
+void FS_MemFree( void *data, const char *filename, int fileline )
+{
+	if( !fs_mount.active )
+	{
+		g_engfuncs._Mem_Free( data, filename, fileline );
+		return;
+	}
+
+	pthread_mutex_lock( &fs_mount.lock );
+	g_engfuncs._Mem_Free( data, filename, fileline );
+	pthread_mutex_unlock( &fs_mount.lock );
+}
+#else // !XASH_FS_PARALLEL_MOUNT
+int FS_MountArchives( fs_mountjob_t *jobs, int count, int *numparallel )
+{
+	int i;
+
+	for( i = 0, *numparallel = 0; i < count; i++ )
+	{
+		if( jobs[i].archive->parallel )
+		{
+			FS_MountOne( &jobs[i] );
+			( *numparallel )++;
+		}
+	}
+
+	return 1;
+}
+#endif // !XASH_FS_PARALLEL_MOUNT
+
+/*
+================
+FS_FlushMountLog
+
+print held back console output of the job
+================
+*/
+void FS_FlushMountLog( fs_mountjob_t *job )
+{
+	size_t i;
+
+	for( i = 0; i < job->loglen; i += Q_strlen( job->log + i + 1 ) + 2 )
+	{
+		const char *msg = job->log + i + 1;
+
+		switch( job->log[i] )
+		{
+		case MOUNTLOG_PRINTF: Con_Printf( "%s", msg ); break;
+		case MOUNTLOG_DPRINTF: Con_DPrintf( "%s", msg ); break;
+		default: Con_Reportf( "%s", msg ); break;
+		}
+	}
+
+	free( job->log );
+	job->log = NULL;
+	job->loglen = 0;
+}
@@ -70,6 +70,7 @@ struct pack_s
 	int		handle;
 	int		numfiles;
 	time_t		filetime;			// common for all packed files
+	fs_offset_t	length;			// of the pak file when it was mounted
 	dpackfile_t files[1]; // flexible
 };
 
@@ -99,6 +100,7 @@ of the list so they override previous pack files.
 static pack_t *FS_LoadPackPAK( const char *packfile, int *error )
 {
 	dpackheader_t header;
+	struct stat st;
 	int         packhandle;
 	int         numpackfiles;
 	pack_t      *pack;
@@ -164,6 +166,8 @@ static pack_t *FS_LoadPackPAK( const char *packfile, int *error )
 
 	// TODO: validate directory?
 
+	// file regions are checked against it, so truncated pak can't be mapped past the end
+	pack->length = fstat( packhandle, &st ) == 0 ? st.st_size : 0;
 	pack->filetime = FS_SysFileTime( packfile );
 	pack->handle = packhandle;
 	pack->numfiles = numpackfiles;
@@ -234,6 +238,40 @@ static int FS_FindFile_PAK( searchpath_t *search, const char *path, char *fixedn
 	return -1;
 }
 
+/*
+===========
+FS_GetFileName_PAK
+
+===========
+*/
+static const char *FS_GetFileName_PAK( searchpath_t *search, int pack_ind )
+{
+	if( pack_ind < 0 || pack_ind >= search->pack->numfiles )
+		return NULL;
+
+	return search->pack->files[pack_ind].name;
+}
+
+/*
+===========
+FS_GetFileRegion_PAK
+
+===========
+*/
+static qboolean FS_GetFileRegion_PAK( searchpath_t *search, int pack_ind, int *handle, fs_offset_t *offset, fs_offset_t *size )
+{
+	const dpackfile_t *pfile = &search->pack->files[pack_ind];
+
+	if( pfile->filepos < 0 || pfile->filelen < 0 || (fs_offset_t)pfile->filepos + pfile->filelen > search->pack->length )
+		return false;
+
+	*handle = search->pack->handle;
+	*offset = pfile->filepos;
+	*size = pfile->filelen;
+
+	return true;
+}
+
 /*
 ===========
 FS_Search_PAK
@@ -357,6 +395,8 @@ searchpath_t *FS_AddPak_Fullpath( const char *pakfile, int flags )
 	search->pfnFileTime = FS_FileTime_PAK;
 	search->pfnFindFile = FS_FindFile_PAK;
 	search->pfnSearch = FS_Search_PAK;
+	search->pfnGetFileName = FS_GetFileName_PAK;
+	search->pfnGetFileRegion = FS_GetFileRegion_PAK;
 
 	Con_Reportf( "Adding pakfile: %s (%i files)\n", pakfile, pak->numfiles );
 
@@ -0,0 +1,670 @@
+/*
+prefetch.c - background file loading
+Copyright (C) 2024 Xash3D FWGS contributors
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include "build.h"
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "port.h"
+#include "filesystem_internal.h"
+#include "crtlib.h"
+#include "common/com_strings.h"
+
+#if XASH_POSIX && !XASH_DOS4GW && !defined( XASH_REDUCE_FD )
+#define XASH_FS_PREFETCH 1
+#endif
+
+static struct
+{
+	int	queued;	// files accepted into the queue
+	int	read;	// files read by workers
+	fs_offset_t	readbytes;
+	double	readtime;	// spent in workers, summed over all threads
+	int	failed;
+	int	evicted;	// cached but skipped by the loader
+	int	stalls;	// workers waited for the loader to free the budget
+
+	int	hits;	// loads served from the cache
+	int	waits;	// of them had to wait for a worker
+	fs_offset_t	hitbytes;
+	double	hittime;
+	int	misses;	// loads read on the caller thread
+	fs_offset_t	missbytes;
+	double	misstime;
+} fs_prefetch_stats;
+
+#if XASH_FS_PREFETCH
+#include <pthread.h>
+#include <unistd.h>
+
+#define FS_PREFETCH_THREADS	2
+#define FS_PREFETCH_JOBS	2048
+#define FS_PREFETCH_BUDGET	( 64 * 1024 * 1024 )	// limit for read but not yet claimed data
+
+enum
+{
+	PREFETCH_FREE = 0,
+	PREFETCH_QUEUED,
+	PREFETCH_READING,
+	PREFETCH_DONE,
+};
+
+typedef struct prefetch_job_s
+{
+	int		state;
+	uint		sequence;	// queue order
+	const searchpath_t	*search;
+	int		pack_ind;
+	string		name;	// resolved name in the searchpath
+
+	// source, handle is -1 for plain files, which size is checked again on read
+	int		handle;
+	fs_offset_t	offset;
+	fs_offset_t	packed_size;	// zero if stored
+	fs_offset_t	size;
+
+	// result, allocated with malloc because memory pools aren't thread-safe
+	byte		*data;
+	time_t		mtime;
+} prefetch_job_t;
+
+static struct
+{
+	pthread_t		threads[FS_PREFETCH_THREADS];
+	int		num_threads;
+	qboolean		quit;
+
+	pthread_mutex_t	lock;
+	pthread_cond_t	wake;	// job was queued
+	pthread_cond_t	done;	// job has left READING state or cached data was claimed
+
+	prefetch_job_t	jobs[FS_PREFETCH_JOBS];
+	int		queue[FS_PREFETCH_JOBS];	// indices into jobs, may contain cancelled ones
+	int		head, tail, count;
+	uint		sequence;
+	uint		claimed;	// sequence of the last claimed job, zero if none
+	fs_offset_t	cached;	// bytes held by READING and DONE jobs
+} fs_prefetch = { .lock = PTHREAD_MUTEX_INITIALIZER, .wake = PTHREAD_COND_INITIALIZER, .done = PTHREAD_COND_INITIALIZER };
+#endif // XASH_FS_PREFETCH
+
+/*
+================
+FS_PrefetchTime
+================
+*/
+double FS_PrefetchTime( void )
+{
+#if XASH_POSIX
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+#else
+	return 0.0;
+#endif
+}
+
+/*
+================
+FS_PrefetchAccountMiss
+
+load that wasn't served from the cache
+================
+*/
+void FS_PrefetchAccountMiss( double start, fs_offset_t size )
+{
+	fs_prefetch_stats.misses++;
+	fs_prefetch_stats.missbytes += size;
+	fs_prefetch_stats.misstime += FS_PrefetchTime() - start;
+}
+
+#if XASH_FS_PREFETCH
+/*
+================
+FS_PrefetchEvict
+
+loader takes files in the queue order, so unclaimed files
+queued before the last claimed one were skipped and won't
+be needed, drop them until size fits, lock must be held
+================
+*/
+static qboolean FS_PrefetchEvict( fs_offset_t size )
+{
+	int i;
+
+	if( !fs_prefetch.claimed )
+		return fs_prefetch.cached + size <= FS_PREFETCH_BUDGET;
+
+	for( i = 0; i < FS_PREFETCH_JOBS && fs_prefetch.cached + size > FS_PREFETCH_BUDGET; i++ )
+	{
+		prefetch_job_t *job = &fs_prefetch.jobs[i];
+
+		if( job->state != PREFETCH_DONE || (int)( job->sequence - fs_prefetch.claimed ) >= 0 )
+			continue;
+
+		free( job->data );
+		fs_prefetch.cached -= job->size;
+		job->data = NULL;
+		job->state = PREFETCH_FREE;
+		fs_prefetch_stats.evicted++;
+	}
+
+	return fs_prefetch.cached + size <= FS_PREFETCH_BUDGET;
+}
+
+/*
+================
+FS_PrefetchReadRange
+================
+*/
+static qboolean FS_PrefetchReadRange( int handle, fs_offset_t offset, byte *buf, fs_offset_t size )
+{
+	while( size > 0 )
+	{
+		ssize_t nb = pread( handle, buf, size, offset );
+
+		if( nb <= 0 )
+			return false;
+
+		buf += nb;
+		offset += nb;
+		size -= nb;
+	}
+
+	return true;
+}
+
+/*
+================
+FS_PrefetchReadPlain
+
+worker opens plain files itself, so nothing is shared with the caller thread
+================
+*/
+static byte *FS_PrefetchReadPlain( prefetch_job_t *job )
+{
+	char path[MAX_SYSPATH];
+	struct stat st;
+	byte *buf = NULL;
+	int handle;
+
+	Q_snprintf( path, sizeof( path ), "%s%s", job->search->filename, job->name );
+
+	if(( handle = open( path, O_RDONLY )) < 0 )
+		return NULL;
+
+	// budget was reserved for the size it had when it was queued
+	if( fstat( handle, &st ) == 0 && st.st_size == job->size && ( buf = malloc( job->size + 1 )))
+	{
+		job->mtime = st.st_mtime;
+
+		if( !FS_PrefetchReadRange( handle, 0, buf, job->size ))
+		{
+			free( buf );
+			buf = NULL;
+		}
+	}
+
+	close( handle );
+	return buf;
+}
+
+/*
+================
+FS_PrefetchReadPacked
+================
+*/
+static byte *FS_PrefetchReadPacked( prefetch_job_t *job )
+{
+	byte *buf, *packed;
+	qboolean result;
+
+	if( !( buf = malloc( job->size + 1 )))
+		return NULL;
+
+	if( !job->packed_size )
+	{
+		if( FS_PrefetchReadRange( job->handle, job->offset, buf, job->size ))
+			return buf;
+
+		free( buf );
+		return NULL;
+	}
+
+	if( !( packed = malloc( job->packed_size )))
+	{
+		free( buf );
+		return NULL;
+	}
+
+	if( !FS_PrefetchReadRange( job->handle, job->offset, packed, job->packed_size ))
+	{
+		free( packed );
+		free( buf );
+		return NULL;
+	}
+
+	result = FS_ZipInflateBuffer( packed, job->packed_size, buf, job->size );
+	free( packed );
+
+	if( !result )
+	{
+		free( buf );
+		return NULL;
+	}
+
+	return buf;
+}
+
+static void *FS_PrefetchWorker( void *arg )
+{
+	pthread_mutex_lock( &fs_prefetch.lock );
+
+	while( 1 )
+	{
+		prefetch_job_t *job;
+		double start;
+		byte *data;
+
+		while( !fs_prefetch.quit && !fs_prefetch.count )
+			pthread_cond_wait( &fs_prefetch.wake, &fs_prefetch.lock );
+
+		if( fs_prefetch.quit )
+			break;
+
+		job = &fs_prefetch.jobs[fs_prefetch.queue[fs_prefetch.head]];
+
+		// cancelled by claim or flush
+		if( job->state != PREFETCH_QUEUED )
+		{
+			fs_prefetch.head = ( fs_prefetch.head + 1 ) % FS_PREFETCH_JOBS;
+			fs_prefetch.count--;
+			continue;
+		}
+
+		// cached files are needed before this one, wait until loader
+		// takes them, job stays queued so loader can read it by itself
+		if( !FS_PrefetchEvict( job->size ))
+		{
+			fs_prefetch_stats.stalls++;
+			pthread_cond_wait( &fs_prefetch.done, &fs_prefetch.lock );
+			continue;
+		}
+
+		fs_prefetch.head = ( fs_prefetch.head + 1 ) % FS_PREFETCH_JOBS;
+		fs_prefetch.count--;
+		job->state = PREFETCH_READING;
+		fs_prefetch.cached += job->size;
+
+		pthread_mutex_unlock( &fs_prefetch.lock );
+
+		start = FS_PrefetchTime();
+		data = job->handle >= 0 ? FS_PrefetchReadPacked( job ) : FS_PrefetchReadPlain( job );
+
+		pthread_mutex_lock( &fs_prefetch.lock );
+
+		fs_prefetch_stats.readtime += FS_PrefetchTime() - start;
+
+		if( data )
+		{
+			data[job->size] = '\0';
+			job->data = data;
+			job->state = PREFETCH_DONE;
+			fs_prefetch_stats.read++;
+			fs_prefetch_stats.readbytes += job->size;
+		}
+		else
+		{
+			fs_prefetch.cached -= job->size;
+			fs_prefetch_stats.failed++;
+			job->state = PREFETCH_FREE;
+		}
+
+		pthread_cond_broadcast( &fs_prefetch.done );
+	}
+
+	pthread_mutex_unlock( &fs_prefetch.lock );
+
+	return NULL;
+}
+
+/*
+================
+FS_PrefetchFindJob
+
+lock must be held
+================
+*/
+static prefetch_job_t *FS_PrefetchFindJob( const searchpath_t *search, int pack_ind, const char *name )
+{
+	int i;
+
+	for( i = 0; i < FS_PREFETCH_JOBS; i++ )
+	{
+		prefetch_job_t *job = &fs_prefetch.jobs[i];
+
+		if( job->state != PREFETCH_FREE && job->search == search && job->pack_ind == pack_ind && !Q_strcmp( job->name, name ))
+			return job;
+	}
+
+	return NULL;
+}
+#endif // XASH_FS_PREFETCH
+
+/*
+================
+FS_PrefetchQueue
+
+called from FS_PrefetchFile with already resolved file
+================
+*/
+void FS_PrefetchQueue( searchpath_t *search, int pack_ind, const char *name )
+{
+#if XASH_FS_PREFETCH
+	prefetch_job_t *job = NULL;
+	fs_offset_t offset = 0, packed_size = 0, size = 0;
+	int i, handle = -1;
+
+	if( Q_strlen( name ) >= sizeof( job->name ))
+		return;
+
+	// workers open plain files by themselves
+	if( FS_WriterPending( ))
+		FS_WriterSync();
+
+	if( search->type == SEARCHPATH_PLAIN || search->type == SEARCHPATH_PK3DIR )
+	{
+		char path[MAX_SYSPATH];
+		struct stat st;
+
+		// size is needed to reserve the budget before reading
+		Q_snprintf( path, sizeof( path ), "%s%s", search->filename, name );
+
+		if( stat( path, &st ) != 0 )
+			return;
+
+		size = st.st_size;
+	}
+	else
+	{
+		if( pack_ind < 0 )
+			return;
+
+		// workers use pread on archive handles, so the file position is never touched
+		if( !search->pfnGetFileRegion || !search->pfnGetFileRegion( search, pack_ind, &handle, &offset, &size ))
+		{
+			if( search->type != SEARCHPATH_ZIP || !FS_GetDeflatedRegion_ZIP( search, pack_ind, &handle, &offset, &packed_size, &size ))
+				return;
+		}
+	}
+
+	if( size < 0 || size > FS_PREFETCH_BUDGET )
+		return;
+
+	pthread_mutex_lock( &fs_prefetch.lock );
+
+	if( fs_prefetch.count == FS_PREFETCH_JOBS || FS_PrefetchFindJob( search, pack_ind, name ))
+	{
+		pthread_mutex_unlock( &fs_prefetch.lock );
+		return;
+	}
+
+	for( i = 0; i < FS_PREFETCH_JOBS; i++ )
+	{
+		if( fs_prefetch.jobs[i].state == PREFETCH_FREE )
+		{
+			job = &fs_prefetch.jobs[i];
+			break;
+		}
+	}
+
+	if( !job )
+	{
+		pthread_mutex_unlock( &fs_prefetch.lock );
+		return;
+	}
+
+	// start workers on first use
+	while( fs_prefetch.num_threads < FS_PREFETCH_THREADS )
+	{
+		if( pthread_create( &fs_prefetch.threads[fs_prefetch.num_threads], NULL, FS_PrefetchWorker, NULL ))
+			break;
+		fs_prefetch.num_threads++;
+	}
+
+	if( !fs_prefetch.num_threads )
+	{
+		pthread_mutex_unlock( &fs_prefetch.lock );
+		return;
+	}
+
+	memset( job, 0, sizeof( *job ));
+	job->state = PREFETCH_QUEUED;
+	job->search = search;
+	job->pack_ind = pack_ind;
+	Q_strncpy( job->name, name, sizeof( job->name ));
+	job->handle = handle;
+	job->offset = offset;
+	job->packed_size = packed_size;
+	job->size = size;
+	job->sequence = ++fs_prefetch.sequence;
+
+	// zero is reserved for nothing claimed
+	if( !job->sequence )
+		job->sequence = ++fs_prefetch.sequence;
+
+	fs_prefetch.queue[fs_prefetch.tail] = job - fs_prefetch.jobs;
+	fs_prefetch.tail = ( fs_prefetch.tail + 1 ) % FS_PREFETCH_JOBS;
+	fs_prefetch.count++;
+	fs_prefetch_stats.queued++;
+
+	pthread_cond_signal( &fs_prefetch.wake );
+	pthread_mutex_unlock( &fs_prefetch.lock );
+#endif // XASH_FS_PREFETCH
+}
+
+/*
+================
+FS_PrefetchClaim
+
+take file from the cache, returned buffer is
+owned by the caller and is 0 terminated
+================
+*/
+byte *FS_PrefetchClaim( const searchpath_t *search, int pack_ind, const char *name, fs_offset_t *filesizeptr )
+{
+#if XASH_FS_PREFETCH
+	prefetch_job_t *job;
+	double start = FS_PrefetchTime();
+	qboolean waited = false;
+	fs_offset_t size;
+	time_t mtime;
+	byte *data, *buf;
+	int handle;
+
+	pthread_mutex_lock( &fs_prefetch.lock );
+
+	while(( job = FS_PrefetchFindJob( search, pack_ind, name )) && job->state == PREFETCH_READING )
+	{
+		// it will be ready sooner than we could read it again
+		pthread_cond_wait( &fs_prefetch.done, &fs_prefetch.lock );
+		waited = true;
+	}
+
+	if( !job )
+	{
+		pthread_mutex_unlock( &fs_prefetch.lock );
+		return NULL;
+	}
+
+	if( !fs_prefetch.claimed || (int)( job->sequence - fs_prefetch.claimed ) > 0 )
+		fs_prefetch.claimed = job->sequence;
+
+	if( job->state == PREFETCH_QUEUED )
+	{
+		// caller is going to read it anyway
+		job->state = PREFETCH_FREE;
+		pthread_cond_broadcast( &fs_prefetch.done );
+		pthread_mutex_unlock( &fs_prefetch.lock );
+		return NULL;
+	}
+
+	data = job->data;
+	size = job->size;
+	mtime = job->mtime;
+	handle = job->handle;
+	job->data = NULL;
+	job->state = PREFETCH_FREE;
+	fs_prefetch.cached -= size;
+
+	// wake up workers waiting for the budget
+	pthread_cond_broadcast( &fs_prefetch.done );
+	pthread_mutex_unlock( &fs_prefetch.lock );
+
+	// plain file could be changed after it was read
+	if( handle < 0 )
+	{
+		char path[MAX_SYSPATH];
+		struct stat st;
+
+		Q_snprintf( path, sizeof( path ), "%s%s", search->filename, name );
+
+		if( stat( path, &st ) != 0 || st.st_size != size || st.st_mtime != mtime )
+		{
+			free( data );
+			return NULL;
+		}
+	}
+
+	buf = Mem_Malloc( fs_mempool, size + 1 );
+	memcpy( buf, data, size + 1 );
+	free( data );
+
+	if( filesizeptr )
+		*filesizeptr = size;
+
+	fs_prefetch_stats.hits++;
+	fs_prefetch_stats.hitbytes += size;
+	fs_prefetch_stats.hittime += FS_PrefetchTime() - start;
+	if( waited )
+		fs_prefetch_stats.waits++;
+
+	return buf;
+#else // !XASH_FS_PREFETCH
+	return NULL;
+#endif // !XASH_FS_PREFETCH
+}
+
+/*
+================
+FS_PrefetchFlush
+
+cancel pending reads and drop cached data,
+must be called before any searchpath is closed
+================
+*/
+void FS_PrefetchFlush( void )
+{
+#if XASH_FS_PREFETCH
+	int i;
+
+	if( !fs_prefetch.num_threads )
+		return;
+
+	pthread_mutex_lock( &fs_prefetch.lock );
+
+	for( i = 0; i < FS_PREFETCH_JOBS; i++ )
+	{
+		prefetch_job_t *job = &fs_prefetch.jobs[i];
+
+		while( job->state == PREFETCH_READING )
+			pthread_cond_wait( &fs_prefetch.done, &fs_prefetch.lock );
+
+		if( job->state == PREFETCH_DONE )
+			free( job->data );
+
+		job->data = NULL;
+		job->state = PREFETCH_FREE;
+	}
+
+	fs_prefetch.head = fs_prefetch.tail = fs_prefetch.count = 0;
+	fs_prefetch.cached = 0;
+	fs_prefetch.claimed = 0;
+	pthread_cond_broadcast( &fs_prefetch.done );
+
+	pthread_mutex_unlock( &fs_prefetch.lock );
+#endif // XASH_FS_PREFETCH
+}
+
+/*
+================
+FS_PrefetchShutdown
+================
+*/
+void FS_PrefetchShutdown( void )
+{
+#if XASH_FS_PREFETCH
+	int i;
+
+	FS_PrefetchFlush();
+
+	pthread_mutex_lock( &fs_prefetch.lock );
+	fs_prefetch.quit = true;
+	pthread_cond_broadcast( &fs_prefetch.wake );
+	pthread_mutex_unlock( &fs_prefetch.lock );
+
+	for( i = 0; i < fs_prefetch.num_threads; i++ )
+		pthread_join( fs_prefetch.threads[i], NULL );
+
+	fs_prefetch.num_threads = 0;
+	fs_prefetch.quit = false;
+#endif // XASH_FS_PREFETCH
+}
+
+/*
+================
+FS_PrefetchInfo
+
+cold loads are read by the caller, warm loads are served from the cache
+================
+*/
+void FS_PrefetchInfo( qboolean reset )
+{
+#if XASH_FS_PREFETCH
+	pthread_mutex_lock( &fs_prefetch.lock );
+	Con_Printf( "prefetch: %d threads, %d queued, %d pending, %.2f MiB cached\n", fs_prefetch.num_threads,
+		fs_prefetch_stats.queued, fs_prefetch.count, fs_prefetch.cached / ( 1024.0 * 1024.0 ));
+	Con_Printf( "  read %d files (%.2f MiB) in %.3f sec, %d failed, %d evicted, %d stalls\n", fs_prefetch_stats.read,
+		fs_prefetch_stats.readbytes / ( 1024.0 * 1024.0 ), fs_prefetch_stats.readtime,
+		fs_prefetch_stats.failed, fs_prefetch_stats.evicted, fs_prefetch_stats.stalls );
+#else
+	Con_Printf( "prefetch: not supported on this platform\n" );
+#endif // XASH_FS_PREFETCH
+
+	Con_Printf( "  warm loads: %d (%.2f MiB) in %.3f sec, %d waited for worker\n", fs_prefetch_stats.hits,
+		fs_prefetch_stats.hitbytes / ( 1024.0 * 1024.0 ), fs_prefetch_stats.hittime, fs_prefetch_stats.waits );
+	Con_Printf( "  cold loads: %d (%.2f MiB) in %.3f sec\n", fs_prefetch_stats.misses,
+		fs_prefetch_stats.missbytes / ( 1024.0 * 1024.0 ), fs_prefetch_stats.misstime );
+
+	if( reset )
+		memset( &fs_prefetch_stats, 0, sizeof( fs_prefetch_stats ));
+
+#if XASH_FS_PREFETCH
+	pthread_mutex_unlock( &fs_prefetch.lock );
+#endif // XASH_FS_PREFETCH
+}
@@ -0,0 +1,229 @@
+/*
+archives.h - archive writers shared by filesystem tests
+Copyright (C) 2024 Xash3D FWGS contributors
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+#ifndef ARCHIVES_H
+#define ARCHIVES_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "miniz.h"
+
+typedef struct
+{
+	const char *name;
+	const char *data;	// 0 terminated
+} archentry_t;
+
+static inline void WriteShort( FILE *f, int value )
+{
+	byte b[2] = { value & 0xFF, ( value >> 8 ) & 0xFF };
+
+	fwrite( b, sizeof( b ), 1, f );
+}
+
+static inline void WriteInt( FILE *f, int value )
+{
+	WriteShort( f, value & 0xFFFF );
+	WriteShort( f, ( value >> 16 ) & 0xFFFF );
+}
+
+static inline qboolean WriteLoose( const char *path, const char *data )
+{
+	FILE *f = fopen( path, "wb" );
+
+	if( !f )
+		return false;
+
+	fwrite( data, strlen( data ), 1, f );
+	fclose( f );
+	return true;
+}
+
+static inline qboolean WritePak( const char *path, const archentry_t *entries, int count )
+{
+	int i, ofs = 12;
+	FILE *f = fopen( path, "wb" );
+
+	if( !f )
+		return false;
+
+	fwrite( "PACK", 4, 1, f );
+	for( i = 0; i < count; i++ )
+		ofs += strlen( entries[i].data );
+	WriteInt( f, ofs );
+	WriteInt( f, count * 64 );
+
+	for( i = 0; i < count; i++ )
+		fwrite( entries[i].data, strlen( entries[i].data ), 1, f );
+
+	for( i = 0, ofs = 12; i < count; i++ )
+	{
+		char name[56] = { 0 };
+
+		strncpy( name, entries[i].name, sizeof( name ) - 1 );
+		fwrite( name, sizeof( name ), 1, f );
+		WriteInt( f, ofs );
+		WriteInt( f, strlen( entries[i].data ));
+		ofs += strlen( entries[i].data );
+	}
+
+	fclose( f );
+	return true;
+}
+
+// stored entries only
+static inline qboolean WriteStoredZip( const char *path, const archentry_t *entries, int count )
+{
+	int i, offsets[16], cdf_offset;
+	FILE *f;
+
+	if( count > 16 || !( f = fopen( path, "wb" )))
+		return false;
+
+	for( i = 0; i < count; i++ )
+	{
+		int size = strlen( entries[i].data ), namelen = strlen( entries[i].name );
+
+		offsets[i] = ftell( f );
+		WriteInt( f, 0x04034b50 );
+		WriteShort( f, 20 );
+		WriteShort( f, 0 );
+		WriteShort( f, 0 ); // stored
+		WriteInt( f, 0 );
+		WriteInt( f, 0 ); // crc32 isn't checked for stored files opened as streams
+		WriteInt( f, size );
+		WriteInt( f, size );
+		WriteShort( f, namelen );
+		WriteShort( f, 0 );
+		fwrite( entries[i].name, namelen, 1, f );
+		fwrite( entries[i].data, size, 1, f );
+	}
+
+	cdf_offset = ftell( f );
+	for( i = 0; i < count; i++ )
+	{
+		int size = strlen( entries[i].data ), namelen = strlen( entries[i].name );
+
+		WriteInt( f, 0x02014b50 );
+		WriteShort( f, 20 );
+		WriteShort( f, 20 );
+		WriteShort( f, 0 );
+		WriteShort( f, 0 );
+		WriteShort( f, 0 );
+		WriteShort( f, 0 );
+		WriteInt( f, 0 );
+		WriteInt( f, size );
+		WriteInt( f, size );
+		WriteShort( f, namelen );
+		WriteShort( f, 0 );
+		WriteShort( f, 0 );
+		WriteShort( f, 0 );
+		WriteShort( f, 0 );
+		WriteInt( f, 0 );
+		WriteInt( f, offsets[i] );
+		fwrite( entries[i].name, namelen, 1, f );
+	}
+
+	WriteInt( f, 0x06054b50 );
+	WriteShort( f, 0 );
+	WriteShort( f, 0 );
+	WriteShort( f, count );
+	WriteShort( f, count );
+	WriteInt( f, ftell( f ) - cdf_offset - 12 );
+	WriteInt( f, cdf_offset );
+	WriteShort( f, 0 );
+
+	fclose( f );
+	return true;
+}
+
+// single deflated entry
+static inline qboolean WriteDeflatedZip( const char *path, const char *name, const byte *data, int size )
+{
+	mz_stream stream;
+	byte *compressed;
+	int compressed_size, cdf_offset, namelen = strlen( name );
+	FILE *f;
+
+	memset( &stream, 0, sizeof( stream ));
+	if( deflateInit2( &stream, MZ_DEFAULT_COMPRESSION, MZ_DEFLATED, -MZ_DEFAULT_WINDOW_BITS, 9, MZ_DEFAULT_STRATEGY ) != Z_OK )
+		return false;
+
+	compressed = malloc( deflateBound( &stream, size ));
+	stream.next_in = data;
+	stream.avail_in = size;
+	stream.next_out = compressed;
+	stream.avail_out = deflateBound( &stream, size );
+
+	if( deflate( &stream, Z_FINISH ) != Z_STREAM_END )
+		return false;
+
+	compressed_size = stream.total_out;
+	deflateEnd( &stream );
+
+	if( !( f = fopen( path, "wb" )))
+		return false;
+
+	// local file header
+	WriteInt( f, 0x04034b50 );
+	WriteShort( f, 20 );
+	WriteShort( f, 0 );
+	WriteShort( f, 8 ); // deflated
+	WriteInt( f, 0 );
+	WriteInt( f, 0 ); // crc32 isn't checked
+	WriteInt( f, compressed_size );
+	WriteInt( f, size );
+	WriteShort( f, namelen );
+	WriteShort( f, 0 );
+	fwrite( name, namelen, 1, f );
+	fwrite( compressed, compressed_size, 1, f );
+	free( compressed );
+
+	// central directory
+	cdf_offset = ftell( f );
+	WriteInt( f, 0x02014b50 );
+	WriteShort( f, 20 );
+	WriteShort( f, 20 );
+	WriteShort( f, 0 );
+	WriteShort( f, 8 );
+	WriteShort( f, 0 );
+	WriteShort( f, 0 );
+	WriteInt( f, 0 );
+	WriteInt( f, compressed_size );
+	WriteInt( f, size );
+	WriteShort( f, namelen );
+	WriteShort( f, 0 );
+	WriteShort( f, 0 );
+	WriteShort( f, 0 );
+	WriteShort( f, 0 );
+	WriteInt( f, 0 );
+	WriteInt( f, 0 ); // local header offset
+	fwrite( name, namelen, 1, f );
+
+	// end of central directory
+	WriteInt( f, 0x06054b50 );
+	WriteShort( f, 0 );
+	WriteShort( f, 0 );
+	WriteShort( f, 1 );
+	WriteShort( f, 1 );
+	WriteInt( f, ftell( f ) - cdf_offset - 12 );
+	WriteInt( f, cdf_offset );
+	WriteShort( f, 0 );
+
+	fclose( f );
+	return true;
+}
+
+#endif // ARCHIVES_H
@@ -0,0 +1,162 @@
+#include "port.h"
+#include "build.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "filesystem.h"
+#if XASH_POSIX
+#include <dlfcn.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define LoadLibrary( x ) dlopen( x, RTLD_NOW )
+#define GetProcAddress( x, y ) dlsym( x, y )
+#define FreeLibrary( x ) dlclose( x )
+#define MakeDirectory( x ) mkdir( x, 0777 )
+#elif XASH_WIN32
+#include <windows.h>
+#include <direct.h>
+#define MakeDirectory( x ) _mkdir( x )
+#endif
+
+#define TEST_DIR  "asyncwrite/"
+#define TEST_SIZE ( 3 * 1024 * 1024 + 123 )
+
+void *g_hModule;
+FSAPI g_pfnGetFSAPI;
+fs_api_t g_fs;
+fs_globals_t *g_nullglobals;
+
+static qboolean LoadFilesystem( void )
+{
+	g_hModule = LoadLibrary( "filesystem_stdio." OS_LIB_EXT );
+	if( !g_hModule )
+		return false;
+
+	g_pfnGetFSAPI = (void*)GetProcAddress( g_hModule, GET_FS_API );
+	if( !g_pfnGetFSAPI )
+		return false;
+
+	if( !g_pfnGetFSAPI( FS_API_VERSION, &g_fs, &g_nullglobals, NULL ))
+		return false;
+
+	return true;
+}
+
+static qboolean CheckFile( const char *path, const byte *expected, fs_offset_t size )
+{
+	fs_offset_t len;
+	byte *data = g_fs.LoadFile( path, &len, true );
+	qboolean ok = data && len == size && !memcmp( data, expected, size );
+
+	if( !ok )
+		printf( "%s has wrong contents\n", path );
+
+	free( data );
+	return ok;
+}
+
+static qboolean TestAsyncWrite( void )
+{
+	byte *data = malloc( TEST_SIZE ), header[4] = { 'T', 'E', 'S', 'T' };
+	fs_offset_t pos;
+	file_t *f;
+	int i;
+
+	for( i = 0; i < TEST_SIZE; i++ )
+		data[i] = ( i * 31 ) ^ ( i >> 11 );
+
+	MakeDirectory( TEST_DIR );
+	g_fs.AddGameDirectory( TEST_DIR, FS_GAMEDIR_PATH );
+	g_fs.SetAsyncWrite( true );
+
+	if( !( f = g_fs.Open( "test.bin", "wb", true )))
+		return false;
+
+	// small writes are batched, big ones wrap around the queue
+	for( pos = 0, i = 1; pos < TEST_SIZE; pos += i, i = ( i * 7 + 3 ) % 300000 + 1 )
+	{
+		if( pos + i > TEST_SIZE )
+			i = TEST_SIZE - pos;
+
+		if( g_fs.Write( f, data + pos, i ) != i || g_fs.Tell( f ) != pos + i )
+		{
+			printf( "Write fail at %d\n", (int)pos );
+			return false;
+		}
+	}
+
+	if( g_fs.FileLength( f ) != TEST_SIZE )
+	{
+		printf( "FileLength fail\n" );
+		return false;
+	}
+
+	// rewrite beginning after queued data
+	g_fs.Seek( f, 0, SEEK_SET );
+	g_fs.Write( f, header, sizeof( header ));
+	memcpy( data, header, sizeof( header ));
+
+	// close waits for the writer to report errors
+	if( g_fs.Close( f ))
+	{
+		printf( "Close fail\n" );
+		return false;
+	}
+
+	// opening waits for queued data
+	if( !CheckFile( "test.bin", data, TEST_SIZE ))
+		return false;
+
+	if( !( f = g_fs.Open( "test.txt", "w", true )))
+		return false;
+
+	for( i = 0; i < 1000; i++ )
+		g_fs.Printf( f, "line %d\n", i );
+
+	pos = g_fs.Tell( f );
+	g_fs.Close( f );
+
+	if( !g_fs.Sync( ) || g_fs.FileSize( "test.txt", true ) != pos )
+	{
+		printf( "Printf fail\n" );
+		return false;
+	}
+
+#if XASH_LINUX
+	// failed background write is reported by close
+	if( !symlink( "/dev/full", TEST_DIR "full.bin" ) && ( f = g_fs.Open( "full.bin", "wb", true )))
+	{
+		g_fs.Write( f, data, TEST_SIZE );
+
+		if( g_fs.Close( f ) != EOF )
+		{
+			printf( "Close of failed file fail\n" );
+			return false;
+		}
+	}
+	remove( TEST_DIR "full.bin" );
+#endif
+
+	g_fs.SetAsyncWrite( false );
+	g_fs.ClearSearchPath();
+
+	remove( TEST_DIR "test.bin" );
+	remove( TEST_DIR "test.txt" );
+	remove( TEST_DIR );
+	free( data );
+
+	return true;
+}
+
+int main( void )
+{
+	if( !LoadFilesystem() )
+		return EXIT_FAILURE;
+
+	if( !TestAsyncWrite())
+		return EXIT_FAILURE;
+
+	printf( "success\n" );
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,208 @@
+#include "port.h"
+#include "build.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "filesystem.h"
+#include "archives.h"
+#if XASH_POSIX
+#include <dlfcn.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#define LoadLibrary( x ) dlopen( x, RTLD_NOW )
+#define GetProcAddress( x, y ) dlsym( x, y )
+#define FreeLibrary( x ) dlclose( x )
+#define MakeDirectory( x ) mkdir( x, 0777 )
+#elif XASH_WIN32
+#include <windows.h>
+#include <direct.h>
+#define MakeDirectory( x ) _mkdir( x )
+#endif
+
+#define TEST_DIR  "blobcache/"
+#define CACHE_DIR TEST_DIR "cache/inflated/"
+#define TEST_SIZE ( 256 * 1024 )
+
+void *g_hModule;
+FSAPI g_pfnGetFSAPI;
+fs_api_t g_fs;
+fs_globals_t *g_nullglobals;
+
+static qboolean LoadFilesystem( void )
+{
+	g_hModule = LoadLibrary( "filesystem_stdio." OS_LIB_EXT );
+	if( !g_hModule )
+		return false;
+
+	g_pfnGetFSAPI = (void*)GetProcAddress( g_hModule, GET_FS_API );
+	if( !g_pfnGetFSAPI )
+		return false;
+
+	if( !g_pfnGetFSAPI( FS_API_VERSION, &g_fs, &g_nullglobals, NULL ))
+		return false;
+
+	return true;
+}
+
+#if XASH_POSIX
+// returns amount of cached blobs, optionally removes them
+static int CountBlobs( qboolean remove_all, char *first, size_t len )
+{
+	struct dirent *entry;
+	int count = 0;
+	DIR *dir;
+
+	if( !( dir = opendir( CACHE_DIR )))
+		return 0;
+
+	while(( entry = readdir( dir )))
+	{
+		char path[512];
+
+		if( !strstr( entry->d_name, ".blob" ))
+			continue;
+
+		snprintf( path, sizeof( path ), CACHE_DIR "%s", entry->d_name );
+
+		if( first && !count )
+			snprintf( first, len, "%s", path );
+
+		if( remove_all )
+			remove( path );
+
+		count++;
+	}
+
+	closedir( dir );
+	return count;
+}
+
+static qboolean CheckLoad( const char *path, const byte *expected )
+{
+	fs_offset_t len;
+	byte *data = g_fs.LoadFile( path, &len, false );
+	qboolean ok = data && len == TEST_SIZE && !memcmp( data, expected, TEST_SIZE );
+
+	if( !ok )
+		printf( "LoadFile %s fail\n", path );
+
+	free( data );
+	return ok;
+}
+
+// flips last byte of the cached payload
+static qboolean DamageBlob( const char *path )
+{
+	FILE *f;
+
+	if( !( f = fopen( path, "r+b" )))
+		return false;
+
+	fseek( f, -1, SEEK_END );
+	fputc( 0xFF, f );
+	fclose( f );
+
+	return true;
+}
+
+static qboolean TestBlobCache( void )
+{
+	byte *data = malloc( TEST_SIZE );
+	const byte *mapped;
+	char blob[512];
+	fs_offset_t len;
+	int i;
+
+	for( i = 0; i < TEST_SIZE; i++ )
+		data[i] = (( i * 13 ) ^ ( i >> 7 )) & 0x3F;
+
+	MakeDirectory( TEST_DIR );
+
+	if( !WriteDeflatedZip( TEST_DIR "a.pk3", "maps/a.bsp", data, TEST_SIZE )
+		|| !WriteDeflatedZip( TEST_DIR "b.pk3", "maps/b.bsp", data, TEST_SIZE ))
+		return false;
+
+	g_fs.AddGameDirectory( TEST_DIR, FS_GAMEDIR_PATH );
+
+	// disabled by default
+	if( !CheckLoad( "maps/a.bsp", data ) || CountBlobs( false, NULL, 0 ) != 0 )
+		return false;
+
+	g_fs.SetBlobCacheSize( 16 * 1024 * 1024 );
+
+	if( !CheckLoad( "maps/a.bsp", data ) || CountBlobs( false, blob, sizeof( blob )) != 1 )
+	{
+		printf( "inflated entry wasn't stored\n" );
+		return false;
+	}
+
+	if( !CheckLoad( "maps/a.bsp", data ))
+	{
+		printf( "cached copy wasn't used\n" );
+		return false;
+	}
+
+	// damaged copy is dropped and entry is inflated again
+	if( !DamageBlob( blob ) || !CheckLoad( "maps/a.bsp", data ) || CountBlobs( false, NULL, 0 ) != 1 )
+	{
+		printf( "damaged cached copy was used\n" );
+		return false;
+	}
+
+	// mapping goes through cache file too and checks it the same way
+	if( !DamageBlob( blob ))
+		return false;
+
+	mapped = g_fs.MapFile( "maps/a.bsp", &len, false );
+	if( !mapped || len != TEST_SIZE || memcmp( mapped, data, TEST_SIZE ))
+	{
+		printf( "MapFile fail\n" );
+		return false;
+	}
+	g_fs.UnmapFile( mapped );
+
+	mapped = g_fs.MapFile( "maps/b.bsp", &len, false );
+	if( !mapped || len != TEST_SIZE || CountBlobs( false, NULL, 0 ) != 2 )
+	{
+		printf( "MapFile didn't store inflated entry\n" );
+		return false;
+	}
+	g_fs.UnmapFile( mapped );
+
+	// shrinking the limit evicts
+	g_fs.SetBlobCacheSize( TEST_SIZE + 4096 );
+	if( CountBlobs( false, NULL, 0 ) != 1 )
+	{
+		printf( "eviction fail\n" );
+		return false;
+	}
+
+	g_fs.SetBlobCacheSize( 0 );
+	g_fs.ClearSearchPath();
+
+	CountBlobs( true, NULL, 0 );
+	remove( CACHE_DIR );
+	remove( TEST_DIR "cache/" );
+	remove( TEST_DIR "a.pk3" );
+	remove( TEST_DIR "b.pk3" );
+	remove( TEST_DIR );
+	free( data );
+
+	return true;
+}
+#endif // XASH_POSIX
+
+int main( void )
+{
+	if( !LoadFilesystem() )
+		return EXIT_FAILURE;
+
+#if XASH_POSIX
+	if( !TestBlobCache())
+		return EXIT_FAILURE;
+#endif
+
+	printf( "success\n" );
+
+	return EXIT_SUCCESS;
+}
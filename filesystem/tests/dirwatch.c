@@ -0,0 +1,134 @@
+#include "port.h"
+#include "build.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "filesystem.h"
+#include "archives.h"
+#if XASH_POSIX
+#include <dlfcn.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define LoadLibrary( x ) dlopen( x, RTLD_NOW )
+#define GetProcAddress( x, y ) dlsym( x, y )
+#define FreeLibrary( x ) dlclose( x )
+#define MakeDirectory( x ) mkdir( x, 0777 )
+#define RemoveDirectory( x ) rmdir( x )
+#elif XASH_WIN32
+#include <windows.h>
+#include <direct.h>
+#define MakeDirectory( x ) _mkdir( x )
+#define RemoveDirectory( x ) _rmdir( x )
+#endif
+
+#define TEST_DIR "dirwatch/"
+
+void *g_hModule;
+FSAPI g_pfnGetFSAPI;
+fs_api_t g_fs;
+fs_globals_t *g_nullglobals;
+
+static qboolean LoadFilesystem( void )
+{
+	g_hModule = LoadLibrary( "filesystem_stdio." OS_LIB_EXT );
+	if( !g_hModule )
+		return false;
+
+	g_pfnGetFSAPI = (void*)GetProcAddress( g_hModule, GET_FS_API );
+	if( !g_pfnGetFSAPI )
+		return false;
+
+	if( !g_pfnGetFSAPI( FS_API_VERSION, &g_fs, &g_nullglobals, NULL ))
+		return false;
+
+	return true;
+}
+
+static qboolean CheckExists( const char *path, qboolean expected )
+{
+	if( !!g_fs.FileExists( path, false ) != expected )
+	{
+		printf( "FileExists %s returned %d, expected %d\n", path, !expected, expected );
+		return false;
+	}
+
+	return true;
+}
+
+static qboolean TestDirWatch( void )
+{
+	MakeDirectory( TEST_DIR );
+	MakeDirectory( TEST_DIR "Maps" );
+
+	if( !WriteLoose( TEST_DIR "Maps/Old.bsp", "old" ))
+		return false;
+
+	g_fs.AddGameDirectory( TEST_DIR, FS_GAMEDIR_PATH );
+
+	if( !CheckExists( "maps/old.bsp", true ) || !CheckExists( "maps/new.bsp", false ))
+		return false;
+
+	// files appearing behind our back must be found
+	if( !WriteLoose( TEST_DIR "Maps/New.bsp", "new" ) || !CheckExists( "maps/new.bsp", true ))
+		return false;
+
+	// and disappearing ones must not
+	remove( TEST_DIR "Maps/Old.bsp" );
+	if( !CheckExists( "maps/old.bsp", false ) || !CheckExists( "maps/new.bsp", true ))
+		return false;
+
+	// new directories are scanned and watched too
+	if( !CheckExists( "sound/ambience/wind.wav", false ))
+		return false;
+
+	MakeDirectory( TEST_DIR "Sound" );
+	MakeDirectory( TEST_DIR "Sound/Ambience" );
+
+	if( !WriteLoose( TEST_DIR "Sound/Ambience/Wind.wav", "wind" ) || !CheckExists( "sound/ambience/wind.wav", true ))
+		return false;
+
+	if( !WriteLoose( TEST_DIR "Sound/Ambience/Rain.wav", "rain" ) || !CheckExists( "sound/ambience/rain.wav", true ))
+		return false;
+
+	// directory replaced with a new one
+	remove( TEST_DIR "Sound/Ambience/Wind.wav" );
+	remove( TEST_DIR "Sound/Ambience/Rain.wav" );
+	RemoveDirectory( TEST_DIR "Sound/Ambience" );
+
+	if( !CheckExists( "sound/ambience/rain.wav", false ))
+		return false;
+
+	MakeDirectory( TEST_DIR "Sound/AMBIENCE" );
+
+	if( !WriteLoose( TEST_DIR "Sound/AMBIENCE/Rain.wav", "rain" ) || !CheckExists( "sound/ambience/rain.wav", true ))
+		return false;
+
+	// files written through filesystem
+	if( !g_fs.WriteFile( "maps/written.txt", "text", 4 ) || !CheckExists( "Maps/Written.txt", true ))
+		return false;
+
+	g_fs.ClearSearchPath();
+
+	remove( TEST_DIR "Sound/AMBIENCE/Rain.wav" );
+	RemoveDirectory( TEST_DIR "Sound/AMBIENCE" );
+	RemoveDirectory( TEST_DIR "Sound" );
+	remove( TEST_DIR "Maps/New.bsp" );
+	remove( TEST_DIR "Maps/written.txt" );
+	RemoveDirectory( TEST_DIR "Maps" );
+	RemoveDirectory( TEST_DIR );
+
+	return true;
+}
+
+int main( void )
+{
+	if( !LoadFilesystem() )
+		return EXIT_FAILURE;
+
+	if( !TestDirWatch())
+		return EXIT_FAILURE;
+
+	printf( "success\n" );
+
+	return EXIT_SUCCESS;
+}
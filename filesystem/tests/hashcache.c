@@ -0,0 +1,147 @@
+#include "port.h"
+#include "build.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "filesystem.h"
+#if XASH_POSIX
+#include <dlfcn.h>
+#include <sys/stat.h>
+#define LoadLibrary( x ) dlopen( x, RTLD_NOW )
+#define GetProcAddress( x, y ) dlsym( x, y )
+#define FreeLibrary( x ) dlclose( x )
+#define MakeDirectory( x ) mkdir( x, 0777 )
+#elif XASH_WIN32
+#include <windows.h>
+#include <direct.h>
+#define MakeDirectory( x ) _mkdir( x )
+#endif
+
+#define TEST_DIR "hashcache/"
+
+void *g_hModule;
+FSAPI g_pfnGetFSAPI;
+fs_api_t g_fs;
+fs_globals_t *g_nullglobals;
+
+static qboolean LoadFilesystem( void )
+{
+	g_hModule = LoadLibrary( "filesystem_stdio." OS_LIB_EXT );
+	if( !g_hModule )
+		return false;
+
+	g_pfnGetFSAPI = (void*)GetProcAddress( g_hModule, GET_FS_API );
+	if( !g_pfnGetFSAPI )
+		return false;
+
+	if( !g_pfnGetFSAPI( FS_API_VERSION, &g_fs, &g_nullglobals, NULL ))
+		return false;
+
+	return true;
+}
+
+static qboolean WriteThroughFS( const char *path, const char *data )
+{
+	file_t *f = g_fs.Open( path, "wb", true );
+
+	if( !f )
+		return false;
+
+	g_fs.Write( f, data, strlen( data ));
+	g_fs.Close( f );
+	return true;
+}
+
+static qboolean TestHashCache( void )
+{
+	byte digest[16], cached[16];
+	dword crc, cachedcrc;
+
+	MakeDirectory( TEST_DIR );
+	g_fs.AddGameDirectory( TEST_DIR, FS_GAMEDIR_PATH );
+
+	if( !WriteThroughFS( "test.txt", "hash me once" ))
+		return false;
+
+	if( g_fs.GetCachedHash( "test.txt", FS_HASH_CRC32, &cachedcrc, sizeof( cachedcrc )))
+	{
+		printf( "GetCachedHash hit before hashing\n" );
+		return false;
+	}
+
+	if( !g_fs.CRC32_File( &crc, "test.txt" ) || !g_fs.MD5_HashFile( digest, "test.txt", NULL ))
+		return false;
+
+	// hashing functions never use the cache by themselves
+	if( g_fs.GetCachedHash( "test.txt", FS_HASH_CRC32, &cachedcrc, sizeof( cachedcrc )))
+	{
+		printf( "CRC32_File filled the cache\n" );
+		return false;
+	}
+
+	g_fs.SetCachedHash( "test.txt", FS_HASH_CRC32, &crc, sizeof( crc ));
+	g_fs.SetCachedHash( "test.txt", FS_HASH_MD5, digest, sizeof( digest ));
+
+	// cache must survive search path reset, it's stored in write directory
+	g_fs.ClearSearchPath();
+	g_fs.AddGameDirectory( TEST_DIR, FS_GAMEDIR_PATH );
+
+	if( !g_fs.GetCachedHash( "test.txt", FS_HASH_CRC32, &cachedcrc, sizeof( cachedcrc )) || cachedcrc != crc )
+	{
+		printf( "CRC32 wasn't cached\n" );
+		return false;
+	}
+
+	if( !g_fs.GetCachedHash( "test.txt", FS_HASH_MD5, cached, sizeof( cached )) || memcmp( cached, digest, 16 ))
+	{
+		printf( "MD5 wasn't cached\n" );
+		return false;
+	}
+
+	// client checks hash files directly, forged entry must not be used
+	cachedcrc = crc ^ 1;
+	g_fs.SetCachedHash( "test.txt", FS_HASH_CRC32, &cachedcrc, sizeof( cachedcrc ));
+
+	if( !g_fs.CRC32_File( &cachedcrc, "test.txt" ) || cachedcrc != crc )
+	{
+		printf( "CRC32_File returned value from cache\n" );
+		return false;
+	}
+
+	// rewriting the file drops its digests
+	if( !WriteThroughFS( "test.txt", "hash me twice" ))
+		return false;
+
+	if( g_fs.GetCachedHash( "test.txt", FS_HASH_CRC32, &cachedcrc, sizeof( cachedcrc )))
+	{
+		printf( "GetCachedHash hit after rewrite\n" );
+		return false;
+	}
+
+	if( !g_fs.CRC32_File( &cachedcrc, "test.txt" ) || cachedcrc == crc )
+	{
+		printf( "CRC32_File returned wrong value\n" );
+		return false;
+	}
+
+	g_fs.ClearSearchPath();
+
+	remove( TEST_DIR "test.txt" );
+	remove( TEST_DIR "hashcache.bin" );
+	remove( TEST_DIR );
+
+	return true;
+}
+
+int main( void )
+{
+	if( !LoadFilesystem() )
+		return EXIT_FAILURE;
+
+	if( !TestHashCache())
+		return EXIT_FAILURE;
+
+	printf( "success\n" );
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,169 @@
+#include "port.h"
+#include "build.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "filesystem.h"
+#include "archives.h"
+#if XASH_POSIX
+#include <dlfcn.h>
+#include <sys/stat.h>
+#define LoadLibrary( x ) dlopen( x, RTLD_NOW )
+#define GetProcAddress( x, y ) dlsym( x, y )
+#define FreeLibrary( x ) dlclose( x )
+#define MakeDirectory( x ) mkdir( x, 0777 )
+#elif XASH_WIN32
+#include <windows.h>
+#include <direct.h>
+#define MakeDirectory( x ) _mkdir( x )
+#endif
+
+#define TEST_DIR "mapfile/"
+
+void *g_hModule;
+FSAPI g_pfnGetFSAPI;
+fs_api_t g_fs;
+fs_globals_t *g_nullglobals;
+
+static qboolean LoadFilesystem( void )
+{
+	g_hModule = LoadLibrary( "filesystem_stdio." OS_LIB_EXT );
+	if( !g_hModule )
+		return false;
+
+	g_pfnGetFSAPI = (void*)GetProcAddress( g_hModule, GET_FS_API );
+	if( !g_pfnGetFSAPI )
+		return false;
+
+	if( !g_pfnGetFSAPI( FS_API_VERSION, &g_fs, &g_nullglobals, NULL ))
+		return false;
+
+	return true;
+}
+
+static qboolean CheckMapping( const char *path, const char *expected, const byte **out )
+{
+	fs_offset_t len;
+	const byte *data;
+
+	data = g_fs.MapFile( path, &len, false );
+	if( !data )
+	{
+		printf( "MapFile %s fail\n", path );
+		return false;
+	}
+
+	if( len != strlen( expected ) || memcmp( data, expected, len ))
+	{
+		printf( "%s has wrong contents: %.*s, expected %s\n", path, (int)len, data, expected );
+		return false;
+	}
+
+	*out = data;
+	return true;
+}
+
+static qboolean TestMapFile( void )
+{
+	const archentry_t pak0[] = { { "models/a.mdl", "pak0-model-a" }, { "gfx/b.lmp", "pak0-lump-b" } };
+	const byte *a1, *a2, *b, *loose;
+
+	MakeDirectory( TEST_DIR );
+
+	if( !WritePak( TEST_DIR "pak0.pak", pak0, 2 ) || !WriteLoose( TEST_DIR "loose.txt", "loose-file" ))
+		return false;
+
+	g_fs.AddGameDirectory( TEST_DIR, FS_GAMEDIR_PATH );
+
+	if( !CheckMapping( "models/a.mdl", "pak0-model-a", &a1 ) || !CheckMapping( "/models/A.mdl", "pak0-model-a", &a2 ))
+		return false;
+
+	// same archive entry shares the view
+	if( a1 != a2 )
+	{
+		printf( "views of models/a.mdl aren't shared\n" );
+		return false;
+	}
+
+	if( !CheckMapping( "gfx/b.lmp", "pak0-lump-b", &b ) || !CheckMapping( "loose.txt", "loose-file", &loose ))
+		return false;
+
+	g_fs.UnmapFile( a1 );
+
+	// still referenced
+	if( memcmp( a2, "pak0-model-a", 12 ))
+	{
+		printf( "models/a.mdl view was released too early\n" );
+		return false;
+	}
+
+	g_fs.UnmapFile( a2 );
+	g_fs.UnmapFile( b );
+	g_fs.UnmapFile( loose );
+
+	if( g_fs.MapFile( "models/c.mdl", NULL, false ))
+	{
+		printf( "MapFile models/c.mdl fail\n" );
+		return false;
+	}
+
+	g_fs.ClearSearchPath();
+
+	remove( TEST_DIR "loose.txt" );
+	remove( TEST_DIR "pak0.pak" );
+	remove( TEST_DIR );
+
+	return true;
+}
+
+static qboolean TestMapCorrupted( void )
+{
+	const archentry_t pak0[] = { { "models/d.mdl", "pak0-model-d" } };
+	const byte *data;
+	fs_offset_t len;
+	FILE *f;
+
+	MakeDirectory( TEST_DIR );
+
+	if( !WritePak( TEST_DIR "pak0.pak", pak0, 1 ) || !( f = fopen( TEST_DIR "pak0.pak", "r+b" )))
+		return false;
+
+	// directory claims entry goes far past the end of the pak
+	fseek( f, 12 + strlen( pak0[0].data ) + 60, SEEK_SET );
+	WriteInt( f, 1024 * 1024 );
+	fclose( f );
+
+	g_fs.AddGameDirectory( TEST_DIR, FS_GAMEDIR_PATH );
+
+	// must not be mapped, touching the end would crash
+	if(( data = g_fs.MapFile( "models/d.mdl", &len, false )))
+	{
+		volatile byte last = len > 0 ? data[len - 1] : 0;
+
+		(void)last;
+		g_fs.UnmapFile( data );
+	}
+
+	g_fs.ClearSearchPath();
+
+	remove( TEST_DIR "pak0.pak" );
+	remove( TEST_DIR );
+
+	return true;
+}
+
+int main( void )
+{
+	if( !LoadFilesystem() )
+		return EXIT_FAILURE;
+
+	if( !TestMapFile())
+		return EXIT_FAILURE;
+
+	if( !TestMapCorrupted())
+		return EXIT_FAILURE;
+
+	printf( "success\n" );
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,146 @@
+#include "port.h"
+#include "build.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "filesystem.h"
+#include "archives.h"
+#if XASH_POSIX
+#include <dlfcn.h>
+#include <sys/stat.h>
+#define LoadLibrary( x ) dlopen( x, RTLD_NOW )
+#define GetProcAddress( x, y ) dlsym( x, y )
+#define FreeLibrary( x ) dlclose( x )
+#define MakeDirectory( x ) mkdir( x, 0777 )
+#elif XASH_WIN32
+#include <windows.h>
+#include <direct.h>
+#define MakeDirectory( x ) _mkdir( x )
+#endif
+
+#define TEST_DIR "mount/"
+#define NUM_ARCHIVES 12
+
+void *g_hModule;
+FSAPI g_pfnGetFSAPI;
+fs_api_t g_fs;
+fs_globals_t *g_nullglobals;
+
+static qboolean LoadFilesystem( void )
+{
+	g_hModule = LoadLibrary( "filesystem_stdio." OS_LIB_EXT );
+	if( !g_hModule )
+		return false;
+
+	g_pfnGetFSAPI = (void*)GetProcAddress( g_hModule, GET_FS_API );
+	if( !g_pfnGetFSAPI )
+		return false;
+
+	if( !g_pfnGetFSAPI( FS_API_VERSION, &g_fs, &g_nullglobals, NULL ))
+		return false;
+
+	return true;
+}
+
+static qboolean CheckFile( const char *path, const char *expected )
+{
+	char buf[64] = { 0 };
+	file_t *f = g_fs.Open( path, "rb", false );
+
+	if( !f )
+	{
+		printf( "Open %s fail\n", path );
+		return false;
+	}
+
+	g_fs.Read( f, buf, sizeof( buf ) - 1 );
+	g_fs.Close( f );
+
+	if( strcmp( buf, expected ))
+	{
+		printf( "%s has %s, expected %s\n", path, buf, expected );
+		return false;
+	}
+
+	return true;
+}
+
+static qboolean TestMount( void )
+{
+	char path[64], expected[64], unique[64], data[32];
+	int i;
+
+	MakeDirectory( TEST_DIR );
+
+	for( i = 0; i < NUM_ARCHIVES; i++ )
+	{
+		archentry_t entries[3] = { { "shared.txt", data }, { "pakonly.txt", data }, { unique, data } };
+
+		snprintf( data, sizeof( data ), "pak%02d", i );
+		snprintf( unique, sizeof( unique ), "unique/pak%02d.txt", i );
+		snprintf( path, sizeof( path ), TEST_DIR "pak%02d.pak", i );
+
+		if( !WritePak( path, entries, 3 ))
+			return false;
+
+		entries[1].name = "ziponly.txt";
+		snprintf( data, sizeof( data ), "zip%02d", i );
+		snprintf( unique, sizeof( unique ), "unique/zip%02d.txt", i );
+		snprintf( path, sizeof( path ), TEST_DIR "zip%02d.pk3", i );
+
+		if( !WriteStoredZip( path, entries, 3 ))
+			return false;
+	}
+
+	g_fs.AddGameDirectory( TEST_DIR, FS_GAMEDIR_PATH );
+
+	// priority is same as if archives were mounted one by one:
+	// sorted by name, pk3 over pak
+	snprintf( expected, sizeof( expected ), "zip%02d", NUM_ARCHIVES - 1 );
+	if( !CheckFile( "shared.txt", expected ) || !CheckFile( "ziponly.txt", expected ))
+		return false;
+
+	snprintf( expected, sizeof( expected ), "pak%02d", NUM_ARCHIVES - 1 );
+	if( !CheckFile( "pakonly.txt", expected ))
+		return false;
+
+	for( i = 0; i < NUM_ARCHIVES; i++ )
+	{
+		snprintf( path, sizeof( path ), "unique/pak%02d.txt", i );
+		snprintf( expected, sizeof( expected ), "pak%02d", i );
+		if( !CheckFile( path, expected ))
+			return false;
+
+		snprintf( path, sizeof( path ), "unique/zip%02d.txt", i );
+		snprintf( expected, sizeof( expected ), "zip%02d", i );
+		if( !CheckFile( path, expected ))
+			return false;
+	}
+
+	g_fs.ClearSearchPath();
+
+	for( i = 0; i < NUM_ARCHIVES; i++ )
+	{
+		snprintf( path, sizeof( path ), TEST_DIR "pak%02d.pak", i );
+		remove( path );
+		snprintf( path, sizeof( path ), TEST_DIR "zip%02d.pk3", i );
+		remove( path );
+	}
+
+	remove( TEST_DIR );
+
+	return true;
+}
+
+int main( void )
+{
+	if( !LoadFilesystem() )
+		return EXIT_FAILURE;
+
+	if( !TestMount())
+		return EXIT_FAILURE;
+
+	printf( "success\n" );
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,125 @@
+#include "port.h"
+#include "build.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "filesystem.h"
+#include "archives.h"
+#if XASH_POSIX
+#include <dlfcn.h>
+#include <sys/stat.h>
+#define LoadLibrary( x ) dlopen( x, RTLD_NOW )
+#define GetProcAddress( x, y ) dlsym( x, y )
+#define FreeLibrary( x ) dlclose( x )
+#define MakeDirectory( x ) mkdir( x, 0777 )
+#elif XASH_WIN32
+#include <windows.h>
+#include <direct.h>
+#define MakeDirectory( x ) _mkdir( x )
+#endif
+
+#define TEST_DIR "pathindex/"
+
+void *g_hModule;
+FSAPI g_pfnGetFSAPI;
+fs_api_t g_fs;
+fs_globals_t *g_nullglobals;
+
+static qboolean LoadFilesystem( void )
+{
+	g_hModule = LoadLibrary( "filesystem_stdio." OS_LIB_EXT );
+	if( !g_hModule )
+		return false;
+
+	g_pfnGetFSAPI = (void*)GetProcAddress( g_hModule, GET_FS_API );
+	if( !g_pfnGetFSAPI )
+		return false;
+
+	if( !g_pfnGetFSAPI( FS_API_VERSION, &g_fs, &g_nullglobals, NULL ))
+		return false;
+
+	return true;
+}
+
+static qboolean CheckFileContents( const char *path, const char *expected )
+{
+	fs_offset_t len;
+	byte *data;
+	qboolean ok;
+
+	data = g_fs.LoadFile( path, &len, false );
+	if( !data )
+	{
+		printf( "LoadFile %s fail\n", path );
+		return false;
+	}
+
+	ok = len == strlen( expected ) && !memcmp( data, expected, len );
+	if( !ok )
+		printf( "%s has wrong contents: %.*s, expected %s\n", path, (int)len, data, expected );
+
+	free( data );
+	return ok;
+}
+
+static qboolean TestPathIndex( void )
+{
+	// pak files are mounted in sorted order, so the last one wins
+	const archentry_t pak0[] = { { "a.txt", "pak0-a" }, { "dir/shared.txt", "pak0-shared" } };
+	const archentry_t pak1[] = { { "B.txt", "pak1-b" }, { "dir/shared.txt", "pak1-shared" } };
+
+	MakeDirectory( TEST_DIR );
+
+	if( !WritePak( TEST_DIR "pak0.pak", pak0, 2 ) || !WritePak( TEST_DIR "pak1.pak", pak1, 2 ))
+		return false;
+
+	// unpacked files have the priority over packed files
+	if( !WriteLoose( TEST_DIR "a.txt", "dir-a" ))
+		return false;
+
+	g_fs.AddGameDirectory( TEST_DIR, FS_GAMEDIR_PATH );
+
+	if( !CheckFileContents( "A.TXT", "dir-a" ))
+		return false;
+
+	if( !CheckFileContents( "Dir/Shared.txt", "pak1-shared" ))
+		return false;
+
+	if( !CheckFileContents( "b.txt", "pak1-b" ))
+		return false;
+
+	if( g_fs.FileExists( "c.txt", false ))
+	{
+		printf( "FileExists c.txt fail\n" );
+		return false;
+	}
+
+	// directory contents can change while archives are indexed
+	remove( TEST_DIR "a.txt" );
+
+	if( !CheckFileContents( "a.txt", "pak0-a" ))
+		return false;
+
+	if( !WriteLoose( TEST_DIR "c.txt", "dir-c" ) || !CheckFileContents( "c.txt", "dir-c" ))
+		return false;
+
+	remove( TEST_DIR "c.txt" );
+	remove( TEST_DIR "pak0.pak" );
+	remove( TEST_DIR "pak1.pak" );
+	remove( TEST_DIR );
+
+	return true;
+}
+
+int main( void )
+{
+	if( !LoadFilesystem() )
+		return EXIT_FAILURE;
+
+	if( !TestPathIndex())
+		return EXIT_FAILURE;
+
+	printf( "success\n" );
+
+	return EXIT_SUCCESS;
+}
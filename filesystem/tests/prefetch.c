@@ -0,0 +1,150 @@
+#include "port.h"
+#include "build.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+#include "filesystem.h"
+#include "archives.h"
+#if XASH_POSIX
+#include <dlfcn.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+#define LoadLibrary( x ) dlopen( x, RTLD_NOW )
+#define GetProcAddress( x, y ) dlsym( x, y )
+#define FreeLibrary( x ) dlclose( x )
+#define MakeDirectory( x ) mkdir( x, 0777 )
+#define Sleep( x ) usleep(( x ) * 1000 )
+#elif XASH_WIN32
+#include <windows.h>
+#include <direct.h>
+#include <sys/utime.h>
+#define MakeDirectory( x ) _mkdir( x )
+#endif
+
+#define TEST_DIR  "prefetch/"
+#define TEST_SIZE ( 256 * 1024 )
+
+void *g_hModule;
+FSAPI g_pfnGetFSAPI;
+fs_api_t g_fs;
+fs_globals_t *g_nullglobals;
+
+static qboolean LoadFilesystem( void )
+{
+	g_hModule = LoadLibrary( "filesystem_stdio." OS_LIB_EXT );
+	if( !g_hModule )
+		return false;
+
+	g_pfnGetFSAPI = (void*)GetProcAddress( g_hModule, GET_FS_API );
+	if( !g_pfnGetFSAPI )
+		return false;
+
+	if( !g_pfnGetFSAPI( FS_API_VERSION, &g_fs, &g_nullglobals, NULL ))
+		return false;
+
+	return true;
+}
+
+static qboolean CheckFile( const char *path, const byte *expected, fs_offset_t size )
+{
+	fs_offset_t len;
+	byte *data;
+
+	data = g_fs.LoadFile( path, &len, false );
+	if( !data )
+	{
+		printf( "LoadFile %s fail\n", path );
+		return false;
+	}
+
+	if( len != size || memcmp( data, expected, size ) || data[size] != 0 )
+	{
+		printf( "%s has wrong contents\n", path );
+		return false;
+	}
+
+	free( data );
+	return true;
+}
+
+static qboolean TestPrefetch( void )
+{
+	byte *data = malloc( TEST_SIZE );
+	struct utimbuf times;
+	int i;
+
+	for( i = 0; i < TEST_SIZE; i++ )
+		data[i] = (( i * 13 ) ^ ( i >> 7 )) & 0x7F;
+
+	MakeDirectory( TEST_DIR );
+
+	if( !WriteDeflatedZip( TEST_DIR "test.pk3", "sound/big.wav", data, TEST_SIZE ) || !WriteLoose( TEST_DIR "loose.txt", "before" ))
+		return false;
+
+	g_fs.AddGameDirectory( TEST_DIR, FS_GAMEDIR_PATH );
+
+	// not existing files are ignored
+	g_fs.PrefetchFile( "sound/big.wav", false );
+	g_fs.PrefetchFile( "/loose.txt", false );
+	g_fs.PrefetchFile( "sound/missing.wav", false );
+
+	// let workers finish, so files are served from the cache
+	Sleep( 200 );
+
+	if( !CheckFile( "sound/big.wav", data, TEST_SIZE ))
+		return false;
+
+	// second load reads file as usual
+	if( !CheckFile( "sound/big.wav", data, TEST_SIZE ))
+		return false;
+
+	// cached copy of changed file must not be used
+	g_fs.PrefetchFile( "loose.txt", false );
+	Sleep( 200 );
+
+	if( !WriteLoose( TEST_DIR "loose.txt", "after!" ))
+		return false;
+
+	times.actime = times.modtime = time( NULL ) + 10;
+	utime( TEST_DIR "loose.txt", &times );
+
+	if( !CheckFile( "loose.txt", (const byte *)"after!", 6 ))
+		return false;
+
+	// loaded before workers could pick it up
+	g_fs.PrefetchFile( "sound/big.wav", false );
+	if( !CheckFile( "sound/big.wav", data, TEST_SIZE ))
+		return false;
+
+	// unclaimed files are dropped, loads read them again
+	g_fs.PrefetchFile( "sound/big.wav", false );
+	Sleep( 200 );
+	g_fs.PrefetchFlush();
+
+	if( !CheckFile( "sound/big.wav", data, TEST_SIZE ))
+		return false;
+
+	g_fs.PrefetchInfo( true );
+
+	remove( TEST_DIR "loose.txt" );
+	remove( TEST_DIR "test.pk3" );
+	remove( TEST_DIR );
+	free( data );
+
+	return true;
+}
+
+int main( void )
+{
+	if( !LoadFilesystem() )
+		return EXIT_FAILURE;
+
+	if( !TestPrefetch())
+		return EXIT_FAILURE;
+
+	printf( "success\n" );
+
+	return EXIT_SUCCESS;
+}
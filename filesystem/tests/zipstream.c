@@ -0,0 +1,142 @@
+#include "port.h"
+#include "build.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "filesystem.h"
+#include "archives.h"
+#if XASH_POSIX
+#include <dlfcn.h>
+#include <sys/stat.h>
+#define LoadLibrary( x ) dlopen( x, RTLD_NOW )
+#define GetProcAddress( x, y ) dlsym( x, y )
+#define FreeLibrary( x ) dlclose( x )
+#define MakeDirectory( x ) mkdir( x, 0777 )
+#elif XASH_WIN32
+#include <windows.h>
+#include <direct.h>
+#define MakeDirectory( x ) _mkdir( x )
+#endif
+
+#define TEST_DIR  "zipstream/"
+#define TEST_SIZE ( 256 * 1024 )
+
+void *g_hModule;
+FSAPI g_pfnGetFSAPI;
+fs_api_t g_fs;
+fs_globals_t *g_nullglobals;
+
+static qboolean LoadFilesystem( void )
+{
+	g_hModule = LoadLibrary( "filesystem_stdio." OS_LIB_EXT );
+	if( !g_hModule )
+		return false;
+
+	g_pfnGetFSAPI = (void*)GetProcAddress( g_hModule, GET_FS_API );
+	if( !g_pfnGetFSAPI )
+		return false;
+
+	if( !g_pfnGetFSAPI( FS_API_VERSION, &g_fs, &g_nullglobals, NULL ))
+		return false;
+
+	return true;
+}
+
+static qboolean CheckRead( file_t *f, const byte *expected, fs_offset_t pos, int size )
+{
+	byte buf[8192];
+
+	if( g_fs.Tell( f ) != pos )
+	{
+		printf( "Tell fail at %d\n", (int)pos );
+		return false;
+	}
+
+	if( g_fs.Read( f, buf, size ) != size || memcmp( buf, expected + pos, size ))
+	{
+		printf( "Read fail at %d size %d\n", (int)pos, size );
+		return false;
+	}
+
+	return true;
+}
+
+static qboolean TestZipStream( void )
+{
+	byte *data = malloc( TEST_SIZE );
+	fs_offset_t pos;
+	file_t *f;
+	int i, c;
+
+	for( i = 0; i < TEST_SIZE; i++ )
+		data[i] = (( i * 7 ) ^ ( i >> 9 )) & 0x3F;
+
+	MakeDirectory( TEST_DIR );
+
+	if( !WriteDeflatedZip( TEST_DIR "test.pk3", "sound/big.bin", data, TEST_SIZE ))
+		return false;
+
+	g_fs.AddGameDirectory( TEST_DIR, FS_GAMEDIR_PATH );
+
+	f = g_fs.Open( "sound/big.bin", "rb", false );
+	if( !f )
+	{
+		printf( "Open fail\n" );
+		return false;
+	}
+
+	if( g_fs.FileLength( f ) != TEST_SIZE )
+	{
+		printf( "FileLength fail\n" );
+		return false;
+	}
+
+	// small reads go through file buffer, big reads go directly
+	for( pos = 0, i = 1; pos + i < TEST_SIZE / 2; pos += i, i = ( i * 3 + 1 ) % 5000 + 1 )
+	{
+		if( !CheckRead( f, data, pos, i ))
+			return false;
+	}
+
+	c = g_fs.Getc( f );
+	if( c != data[pos] )
+	{
+		printf( "Getc fail\n" );
+		return false;
+	}
+
+	// forward skip
+	g_fs.Seek( f, TEST_SIZE - 1000, SEEK_SET );
+	if( !CheckRead( f, data, TEST_SIZE - 1000, 1000 ) || !g_fs.Eof( f ))
+		return false;
+
+	// backward seek restarts the stream
+	g_fs.Seek( f, 12345, SEEK_SET );
+	if( !CheckRead( f, data, 12345, 4000 ))
+		return false;
+
+	g_fs.Seek( f, -100, SEEK_CUR );
+	if( !CheckRead( f, data, 12345 + 3900, 100 ))
+		return false;
+
+	g_fs.Close( f );
+
+	remove( TEST_DIR "test.pk3" );
+	remove( TEST_DIR );
+	free( data );
+
+	return true;
+}
+
+int main( void )
+{
+	if( !LoadFilesystem() )
+		return EXIT_FAILURE;
+
+	if( !TestZipStream())
+		return EXIT_FAILURE;
+
+	printf( "success\n" );
+
+	return EXIT_SUCCESS;
+}
@@ -630,6 +630,31 @@ static byte *W_ReadLump( searchpath_t *search, const char *path, int pack_ind, f
 	return buf;
 }
 
+/*
+===========
+FS_GetFileRegion_WAD
+
+lumps are stored as is, but wad itself may be inside compressed archive
+===========
+*/
+static qboolean FS_GetFileRegion_WAD( searchpath_t *search, int pack_ind, int *handle, fs_offset_t *offset, fs_offset_t *size )
+{
+	const wfile_t *wad = search->wad;
+	const dlumpinfo_t *lump = &wad->lumps[pack_ind];
+
+	if( wad->handle->zstream || lump->filepos < 0 || lump->disksize < 0 )
+		return false;
+
+	if( (fs_offset_t)lump->filepos + lump->disksize > wad->handle->real_length )
+		return false;
+
+	*handle = wad->handle->handle;
+	*offset = wad->handle->offset + lump->filepos;
+	*size = lump->disksize;
+
+	return true;
+}
+
 /*
 ====================
 FS_AddWad_Fullpath
@@ -663,6 +688,7 @@ searchpath_t *FS_AddWad_Fullpath( const char *wadfile, int flags )
 	search->pfnFindFile = FS_FindFile_WAD;
 	search->pfnSearch = FS_Search_WAD;
 	search->pfnLoadFile = W_ReadLump;
+	search->pfnGetFileRegion = FS_GetFileRegion_WAD;
 
 	Con_Reportf( "Adding wadfile: %s (%i files)\n", wadfile, wad->numlumps );
 	return search;
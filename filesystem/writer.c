@@ -0,0 +1,462 @@
+/*
+writer.c - background file writing
+Copyright (C) 2024 Xash3D FWGS contributors
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include "build.h"
+#include <sys/types.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include "port.h"
+#include "filesystem_internal.h"
+#include "crtlib.h"
+#include "xash3d_mathlib.h"
+#include "common/com_strings.h"
+
+#if XASH_FS_ASYNC_WRITE
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#define FS_WRITER_RING	( 1024 * 1024 )	// must be power of two
+#define FS_WRITER_CHUNK	( FS_WRITER_RING / 8 )	// bigger writes are split
+#define FS_WRITER_IOV	64	// buffers per writev call
+#define FS_WRITER_ALIGN( x )	((( x ) + 31 ) & ~31 ) // padding always fits a record
+
+enum
+{
+	WRITEREC_DATA = 0,
+	WRITEREC_CLOSE,	// close handle after preceding data is written
+	WRITEREC_PAD,	// skip to the start of the ring
+};
+
+// followed by data, always 32 byte aligned in the ring
+typedef struct writerec_s
+{
+	int	*errors;	// failed writes counter of the file, it's kept until close is done
+	int	handle;
+	short	op;
+	short	reserved;
+	int	len;	// of data, or whole record size for padding
+} writerec_t;
+
+// single producer, single consumer ring, producer owns head and consumer owns tail
+static struct
+{
+	byte		ring[FS_WRITER_RING];
+	size_t		head;	// total bytes published, only grows
+	size_t		tail;	// total bytes consumed
+	int		sleeping;	// consumer waits for wake
+	int		errors;	// failed writes since last sync
+
+	pthread_t		thread;
+	pthread_t		owner;	// the only thread allowed to queue
+	pthread_mutex_t	lock;	// only used to sleep and wake up
+	pthread_cond_t	wake;	// record was queued
+	pthread_cond_t	progress;	// records were consumed
+	qboolean		started;
+	qboolean		enabled;
+	int		quit;
+} fs_writer = { .lock = PTHREAD_MUTEX_INITIALIZER, .wake = PTHREAD_COND_INITIALIZER, .progress = PTHREAD_COND_INITIALIZER };
+
+/*
+================
+FS_WriterWritev
+
+write all buffers, handling short writes
+================
+*/
+static qboolean FS_WriterWritev( int handle, struct iovec *iov, int count )
+{
+	while( count > 0 )
+	{
+		ssize_t ret = writev( handle, iov, count );
+
+		if( ret < 0 )
+			return false;
+
+		while( count > 0 && (size_t)ret >= iov->iov_len )
+		{
+			ret -= iov->iov_len;
+			iov++;
+			count--;
+		}
+
+		if( count > 0 )
+		{
+			iov->iov_base = (byte *)iov->iov_base + ret;
+			iov->iov_len -= ret;
+		}
+	}
+
+	return true;
+}
+
+static void *FS_WriterThread( void *arg )
+{
+	size_t tail = fs_writer.tail;
+
+	while( 1 )
+	{
+		struct iovec iov[FS_WRITER_IOV];
+		size_t head = __atomic_load_n( &fs_writer.head, __ATOMIC_ACQUIRE );
+		int handle = -1, count = 0, *errors = NULL;
+
+		if( head == tail )
+		{
+			pthread_mutex_lock( &fs_writer.lock );
+			__atomic_store_n( &fs_writer.sleeping, 1, __ATOMIC_SEQ_CST );
+
+			if( __atomic_load_n( &fs_writer.head, __ATOMIC_SEQ_CST ) == tail )
+			{
+				if( fs_writer.quit )
+				{
+					pthread_mutex_unlock( &fs_writer.lock );
+					break;
+				}
+
+				pthread_cond_wait( &fs_writer.wake, &fs_writer.lock );
+			}
+
+			__atomic_store_n( &fs_writer.sleeping, 0, __ATOMIC_SEQ_CST );
+			pthread_mutex_unlock( &fs_writer.lock );
+			continue;
+		}
+
+		// gather consecutive records of the same file into one call
+		while( tail != head && count < FS_WRITER_IOV )
+		{
+			const writerec_t *rec = (const writerec_t *)&fs_writer.ring[tail & ( FS_WRITER_RING - 1 )];
+
+			if( rec->op == WRITEREC_PAD )
+			{
+				tail += rec->len;
+				continue;
+			}
+
+			if( handle >= 0 && rec->handle != handle )
+				break;
+
+			handle = rec->handle;
+			errors = rec->errors;
+
+			if( rec->op == WRITEREC_CLOSE )
+			{
+				if( count > 0 )
+					break; // flush data first
+
+				if( close( handle ))
+					__atomic_add_fetch( errors, 1, __ATOMIC_RELAXED );
+				handle = -1;
+				tail += FS_WRITER_ALIGN( sizeof( *rec ));
+				continue;
+			}
+
+			iov[count].iov_base = (void *)( rec + 1 );
+			iov[count].iov_len = rec->len;
+			count++;
+			tail += FS_WRITER_ALIGN( sizeof( *rec ) + rec->len );
+		}
+
+		if( count > 0 && !FS_WriterWritev( handle, iov, count ))
+		{
+			__atomic_add_fetch( errors, 1, __ATOMIC_RELAXED );
+			__atomic_add_fetch( &fs_writer.errors, 1, __ATOMIC_RELAXED );
+		}
+
+		__atomic_store_n( &fs_writer.tail, tail, __ATOMIC_RELEASE );
+
+		pthread_mutex_lock( &fs_writer.lock );
+		pthread_cond_broadcast( &fs_writer.progress );
+		pthread_mutex_unlock( &fs_writer.lock );
+	}
+
+	return NULL;
+}
+
+/*
+================
+FS_WriterWaitTail
+
+block until consumer reaches the position
+================
+*/
+static void FS_WriterWaitTail( size_t pos )
+{
+	// distance handles counter wraparound
+	if((ssize_t)( __atomic_load_n( &fs_writer.tail, __ATOMIC_ACQUIRE ) - pos ) >= 0 )
+		return;
+
+	pthread_mutex_lock( &fs_writer.lock );
+	while((ssize_t)( __atomic_load_n( &fs_writer.tail, __ATOMIC_ACQUIRE ) - pos ) < 0 )
+		pthread_cond_wait( &fs_writer.progress, &fs_writer.lock );
+	pthread_mutex_unlock( &fs_writer.lock );
+}
+
+/*
+================
+FS_WriterPublish
+================
+*/
+static void FS_WriterPublish( size_t head )
+{
+	__atomic_store_n( &fs_writer.head, head, __ATOMIC_SEQ_CST );
+
+	if( __atomic_load_n( &fs_writer.sleeping, __ATOMIC_SEQ_CST ))
+	{
+		pthread_mutex_lock( &fs_writer.lock );
+		pthread_cond_signal( &fs_writer.wake );
+		pthread_mutex_unlock( &fs_writer.lock );
+	}
+}
+
+/*
+================
+FS_WriterReserve
+
+returns record in the ring with enough contiguous space after it
+================
+*/
+static writerec_t *FS_WriterReserve( size_t size )
+{
+	size_t head = fs_writer.head;
+	size_t offset = head & ( FS_WRITER_RING - 1 );
+
+	if( offset + size > FS_WRITER_RING )
+	{
+		writerec_t *pad = (writerec_t *)&fs_writer.ring[offset];
+		size_t padsize = FS_WRITER_RING - offset;
+
+		FS_WriterWaitTail( head + padsize - FS_WRITER_RING );
+		pad->op = WRITEREC_PAD;
+		pad->len = padsize;
+		FS_WriterPublish( head + padsize );
+		head += padsize;
+		offset = 0;
+	}
+
+	FS_WriterWaitTail( head + size - FS_WRITER_RING );
+
+	return (writerec_t *)&fs_writer.ring[offset];
+}
+
+static qboolean FS_WriterOwner( void )
+{
+	return fs_writer.started && pthread_equal( pthread_self(), fs_writer.owner );
+}
+
+/*
+================
+FS_WriterQueue
+
+copy data into the ring, returns false if caller must write it by itself,
+failed writes are counted in errors
+================
+*/
+qboolean FS_WriterQueue( int handle, int *errors, const void *data, size_t size )
+{
+	const byte *src = data;
+
+	if( !FS_WriterOwner( ))
+	{
+		// keep order of the data already queued for this file
+		FS_WriterSync();
+		return false;
+	}
+
+	while( size > 0 )
+	{
+		size_t len = Q_min( size, FS_WRITER_CHUNK );
+		writerec_t *rec = FS_WriterReserve( FS_WRITER_ALIGN( sizeof( *rec ) + len ));
+
+		rec->errors = errors;
+		rec->handle = handle;
+		rec->op = WRITEREC_DATA;
+		rec->len = len;
+		memcpy( rec + 1, src, len );
+		FS_WriterPublish( fs_writer.head + FS_WRITER_ALIGN( sizeof( *rec ) + len ));
+
+		src += len;
+		size -= len;
+	}
+
+	return true;
+}
+
+/*
+================
+FS_WriterClose
+
+waits until all queued data of the handle is written and it's closed,
+so errors counter is final, returns false if caller must close it
+================
+*/
+qboolean FS_WriterClose( int handle, int *errors )
+{
+	writerec_t *rec;
+
+	if( !FS_WriterOwner( ))
+	{
+		FS_WriterSync();
+		return false;
+	}
+
+	rec = FS_WriterReserve( FS_WRITER_ALIGN( sizeof( *rec )));
+	rec->errors = errors;
+	rec->handle = handle;
+	rec->op = WRITEREC_CLOSE;
+	rec->len = 0;
+	FS_WriterPublish( fs_writer.head + FS_WRITER_ALIGN( sizeof( *rec )));
+	FS_WriterWaitTail( fs_writer.head );
+
+	return true;
+}
+
+/*
+================
+FS_WriterStart
+
+returns true if newly opened files can be written in background
+================
+*/
+qboolean FS_WriterStart( void )
+{
+	if( !fs_writer.enabled )
+		return false;
+
+	if( fs_writer.started )
+		return FS_WriterOwner();
+
+	if( pthread_create( &fs_writer.thread, NULL, FS_WriterThread, NULL ))
+	{
+		Con_Reportf( S_WARN "%s: can't create writer thread, writing synchronously\n", __func__ );
+		fs_writer.enabled = false;
+		return false;
+	}
+
+	fs_writer.owner = pthread_self();
+	fs_writer.started = true;
+	return true;
+}
+
+/*
+================
+FS_WriterPending
+
+any data isn't on disk yet
+================
+*/
+qboolean FS_WriterPending( void )
+{
+	return fs_writer.started && __atomic_load_n( &fs_writer.tail, __ATOMIC_ACQUIRE ) != __atomic_load_n( &fs_writer.head, __ATOMIC_ACQUIRE );
+}
+
+/*
+================
+FS_WriterSync
+
+wait until all queued data is written and queued handles are closed,
+returns false if any write failed since last sync
+================
+*/
+qboolean FS_WriterSync( void )
+{
+	int errors;
+
+	if( !fs_writer.started )
+		return true;
+
+	FS_WriterWaitTail( __atomic_load_n( &fs_writer.head, __ATOMIC_ACQUIRE ));
+
+	errors = __atomic_exchange_n( &fs_writer.errors, 0, __ATOMIC_RELAXED );
+	if( errors )
+	{
+		Con_Reportf( S_ERROR "%s: %d background writes failed\n", __func__, errors );
+		return false;
+	}
+
+	return true;
+}
+
+/*
+================
+FS_WriterEnable
+
+files that are already open keep their mode
+================
+*/
+void FS_WriterEnable( qboolean enable )
+{
+	if( !enable )
+		FS_WriterSync();
+
+	fs_writer.enabled = enable;
+}
+
+/*
+================
+FS_WriterShutdown
+================
+*/
+void FS_WriterShutdown( void )
+{
+	if( !fs_writer.started )
+		return;
+
+	FS_WriterSync();
+
+	pthread_mutex_lock( &fs_writer.lock );
+	fs_writer.quit = true;
+	pthread_cond_signal( &fs_writer.wake );
+	pthread_mutex_unlock( &fs_writer.lock );
+
+	pthread_join( fs_writer.thread, NULL );
+
+	fs_writer.started = false;
+	fs_writer.quit = false;
+}
+#else // !XASH_FS_ASYNC_WRITE
+qboolean FS_WriterQueue( int handle, int *errors, const void *data, size_t size )
+{
+	return false;
+}
+
+qboolean FS_WriterClose( int handle, int *errors )
+{
+	return false;
+}
+
+qboolean FS_WriterStart( void )
+{
+	return false;
+}
+
+qboolean FS_WriterPending( void )
+{
+	return false;
+}
+
+qboolean FS_WriterSync( void )
+{
+	return true;
+}
+
+void FS_WriterEnable( qboolean enable )
+{
+}
+
+void FS_WriterShutdown( void )
+{
+}
+#endif // !XASH_FS_ASYNC_WRITE
@@ -26,6 +26,7 @@ GNU General Public License for more details.
 #include "port.h"
 #include "filesystem_internal.h"
 #include "crtlib.h"
+#include "xash3d_mathlib.h"
 #include "common/com_strings.h"
 #include "miniz.h"
 
@@ -40,6 +41,8 @@ GNU General Public License for more details.
 
 #define ZIP_ZIP64 0xffffffff
 
+#define ZIP_STREAM_BUFFER	(16 * 1024)	// compressed data read at once
+
 #pragma pack( push, 1 )
 typedef struct zip_header_s
 {
@@ -118,6 +121,7 @@ typedef struct zipfile_s
 	fs_offset_t	offset; // offset of local file header
 	fs_offset_t	size; //original file size
 	fs_offset_t	compressed_size; // compressed file size
+	uint32_t	crc32;
 	uint16_t flags;
 } zipfile_t;
 
@@ -126,9 +130,19 @@ struct zip_s
 	int		handle;
 	int		numfiles;
 	time_t		filetime;
+	fs_offset_t	length;	// of the zip file when it was mounted
 	zipfile_t	*files;
 };
 
+struct zipstream_s
+{
+	z_stream		stream;
+	fs_offset_t	compressed_size;
+	fs_offset_t	compressed_pos;	// compressed bytes read from file
+	fs_offset_t	position;		// uncompressed bytes produced
+	byte		in[ZIP_STREAM_BUFFER];
+};
+
 #ifdef XASH_REDUCE_FD
 static void FS_EnsureOpenZip( zip_t *zip )
 {
@@ -337,6 +351,7 @@ static zip_t *FS_LoadZip( const char *zipfile, int *error )
 
 			info[numpackfiles].size = header_cdf.uncompressed_size;
 			info[numpackfiles].compressed_size = header_cdf.compressed_size;
+			info[numpackfiles].crc32 = header_cdf.crc32;
 			info[numpackfiles].offset = header_cdf.local_header_offset;
 			numpackfiles++;
 		}
@@ -375,6 +390,7 @@ static zip_t *FS_LoadZip( const char *zipfile, int *error )
 	}
 
 	zip->filetime = FS_SysFileTime( zipfile );
+	zip->length = length;
 	zip->numfiles = numpackfiles;
 	zip->files = info;
 
@@ -392,6 +408,128 @@ static zip_t *FS_LoadZip( const char *zipfile, int *error )
 	return zip;
 }
 
+/*
+===========
+FS_ZipStreamInit
+
+deflated entries are inflated on read, file offset points to compressed data
+===========
+*/
+static qboolean FS_ZipStreamInit( file_t *file, fs_offset_t compressed_size )
+{
+	zipstream_t	*zs = Mem_Calloc( fs_mempool, sizeof( *zs ));
+
+	zs->compressed_size = compressed_size;
+
+	if( inflateInit2( &zs->stream, -MAX_WBITS ) != Z_OK )
+	{
+		Mem_Free( zs );
+		return false;
+	}
+
+	file->zstream = zs;
+	return true;
+}
+
+/*
+===========
+FS_ZipStreamInflate
+
+continue inflating from where the stream stopped
+===========
+*/
+static fs_offset_t FS_ZipStreamInflate( file_t *file, byte *out, fs_offset_t size )
+{
+	zipstream_t	*zs = file->zstream;
+	fs_offset_t	done;
+	int		ret;
+
+	zs->stream.next_out = out;
+	zs->stream.avail_out = size;
+
+	while( zs->stream.avail_out )
+	{
+		if( !zs->stream.avail_in && zs->compressed_pos < zs->compressed_size )
+		{
+			fs_offset_t	count = Q_min( zs->compressed_size - zs->compressed_pos, (fs_offset_t)sizeof( zs->in ));
+			fs_offset_t	nb;
+
+			lseek( file->handle, file->offset + zs->compressed_pos, SEEK_SET );
+			nb = read( file->handle, zs->in, count );
+
+			if( nb <= 0 )
+				break;
+
+			zs->compressed_pos += nb;
+			zs->stream.next_in = zs->in;
+			zs->stream.avail_in = nb;
+		}
+
+		ret = inflate( &zs->stream, Z_NO_FLUSH );
+
+		if( ret == Z_STREAM_END )
+			break;
+
+		if( ret != Z_OK )
+		{
+			// Z_BUF_ERROR when compressed data ends early
+			if( ret != Z_BUF_ERROR )
+				Con_Reportf( S_ERROR "%s: error while file decompressing. Zlib return code %d.\n", __func__, ret );
+			break;
+		}
+	}
+
+	done = size - zs->stream.avail_out;
+	zs->position += done;
+
+	return done;
+}
+
+/*
+===========
+FS_ZipStreamRead
+
+read uncompressed data at file position, seeking back restarts
+the stream from beginning, seeking forward skips the data
+===========
+*/
+fs_offset_t FS_ZipStreamRead( file_t *file, void *buffer, fs_offset_t size )
+{
+	zipstream_t	*zs = file->zstream;
+
+	if( zs->position > file->position )
+	{
+		inflateReset( &zs->stream );
+		zs->stream.avail_in = 0;
+		zs->compressed_pos = 0;
+		zs->position = 0;
+	}
+
+	while( zs->position < file->position )
+	{
+		byte		skip[4096];
+		fs_offset_t	count = Q_min( file->position - zs->position, (fs_offset_t)sizeof( skip ));
+
+		if( FS_ZipStreamInflate( file, skip, count ) != count )
+			return 0;
+	}
+
+	return FS_ZipStreamInflate( file, buffer, size );
+}
+
+/*
+===========
+FS_ZipStreamClose
+
+===========
+*/
+void FS_ZipStreamClose( file_t *file )
+{
+	inflateEnd( &file->zstream->stream );
+	Mem_Free( file->zstream );
+	file->zstream = NULL;
+}
+
 /*
 ===========
 FS_OpenZipFile
@@ -402,16 +540,26 @@ Open a packed file using its package file descriptor
 static file_t *FS_OpenFile_ZIP( searchpath_t *search, const char *filename, const char *mode, int pack_ind )
 {
 	zipfile_t	*pfile;
+	file_t	*file;
+
 	pfile = &search->zip->files[pack_ind];
 
-	// compressed files handled in Zip_LoadFile
-	if( pfile->flags != ZIP_COMPRESSION_NO_COMPRESSION )
+	if( pfile->flags != ZIP_COMPRESSION_NO_COMPRESSION && pfile->flags != ZIP_COMPRESSION_DEFLATED )
 	{
-		Con_Printf( S_ERROR "%s: can't open compressed file %s\n", __FUNCTION__, pfile->name );
+		Con_Printf( S_ERROR "%s: %s compressed with unknown algorithm\n", __FUNCTION__, pfile->name );
 		return NULL;
 	}
 
-	return FS_OpenHandle( search->filename, search->zip->handle, pfile->offset, pfile->size );
+	file = FS_OpenHandle( search->filename, search->zip->handle, pfile->offset, pfile->size );
+
+	if( file && pfile->flags == ZIP_COMPRESSION_DEFLATED && !FS_ZipStreamInit( file, pfile->compressed_size ))
+	{
+		Con_Printf( S_ERROR "%s: inflateInit2 failed for %s\n", __FUNCTION__, pfile->name );
+		FS_Close( file );
+		return NULL;
+	}
+
+	return file;
 }
 
 /*
@@ -480,6 +628,13 @@ static byte *FS_LoadZIPFile( searchpath_t *search, const char *path, int pack_in
 	}
 	else if( file->flags == ZIP_COMPRESSION_DEFLATED )
 	{
+		// inflated earlier
+		if(( decompressed_buffer = FS_BlobCacheLoad( search, pack_ind, sizeptr )))
+		{
+			FS_EnsureOpenZip( NULL );
+			return decompressed_buffer;
+		}
+
 		compressed_buffer = Mem_Malloc( fs_mempool, file->compressed_size + 1 );
 		decompressed_buffer = Mem_Malloc( fs_mempool, file->size + 1 );
 		decompressed_buffer[file->size] = '\0';
@@ -532,6 +687,10 @@ static byte *FS_LoadZIPFile( searchpath_t *search, const char *path, int pack_in
 			if( sizeptr ) *sizeptr = file->size;
 
 			FS_EnsureOpenZip( NULL );
+
+			// truncated streams are still returned as before, but never cached
+			if( zlib_result == Z_STREAM_END && decompress_stream.total_out == file->size )
+				FS_BlobCacheStore( search, pack_ind, decompressed_buffer, file->size );
 			return decompressed_buffer;
 		}
 		else
@@ -612,6 +771,119 @@ static int FS_FindFile_ZIP( searchpath_t *search, const char *path, char *fixedn
 	return -1;
 }
 
+/*
+===========
+FS_GetFileName_ZIP
+
+===========
+*/
+static const char *FS_GetFileName_ZIP( searchpath_t *search, int pack_ind )
+{
+	if( pack_ind < 0 || pack_ind >= search->zip->numfiles )
+		return NULL;
+
+	return search->zip->files[pack_ind].name;
+}
+
+/*
+===========
+FS_ZipInflateBuffer
+
+whole raw deflate stream at once, doesn't touch any global state
+===========
+*/
+qboolean FS_ZipInflateBuffer( const byte *in, fs_offset_t insize, byte *out, fs_offset_t outsize )
+{
+	z_stream	stream;
+	int	result;
+
+	memset( &stream, 0, sizeof( stream ));
+	stream.next_in = in;
+	stream.avail_in = insize;
+	stream.next_out = out;
+	stream.avail_out = outsize;
+
+	if( inflateInit2( &stream, -MAX_WBITS ) != Z_OK )
+		return false;
+
+	result = inflate( &stream, Z_FINISH );
+	inflateEnd( &stream );
+
+	return result == Z_STREAM_END && stream.total_out == outsize;
+}
+
+/*
+===========
+FS_GetDeflatedRegion_ZIP
+
+compressed data location of deflated entry
+===========
+*/
+qboolean FS_GetDeflatedRegion_ZIP( searchpath_t *search, int pack_ind, int *handle, fs_offset_t *offset, fs_offset_t *compressed_size, fs_offset_t *size )
+{
+	const zipfile_t *pfile = &search->zip->files[pack_ind];
+
+	if( pfile->flags != ZIP_COMPRESSION_DEFLATED )
+		return false;
+
+	if( pfile->offset < 0 || pfile->compressed_size < 0 || pfile->offset + pfile->compressed_size > search->zip->length )
+		return false;
+
+	*handle = search->zip->handle;
+	*offset = pfile->offset;
+	*compressed_size = pfile->compressed_size;
+	*size = pfile->size;
+
+	return true;
+}
+
+/*
+===========
+FS_GetDeflatedInfo_ZIP
+
+identity of deflated entry for caching its contents
+===========
+*/
+qboolean FS_GetDeflatedInfo_ZIP( searchpath_t *search, int pack_ind, fs_offset_t *offset, fs_offset_t *size, uint32_t *crc32, time_t *filetime )
+{
+	const zipfile_t *pfile = &search->zip->files[pack_ind];
+
+	if( pfile->flags != ZIP_COMPRESSION_DEFLATED )
+		return false;
+
+	*offset = pfile->offset;
+	*size = pfile->size;
+	*crc32 = pfile->crc32;
+	*filetime = search->zip->filetime;
+
+	return true;
+}
+
+/*
+===========
+FS_GetFileRegion_ZIP
+
+only stored entries can be used in place
+===========
+*/
+static qboolean FS_GetFileRegion_ZIP( searchpath_t *search, int pack_ind, int *handle, fs_offset_t *offset, fs_offset_t *size )
+{
+	const zipfile_t *pfile = &search->zip->files[pack_ind];
+
+	if( pfile->flags != ZIP_COMPRESSION_NO_COMPRESSION )
+		return false;
+
+	// directory isn't checked against the file, truncated zip can't be mapped past the end
+	if( pfile->offset < 0 || pfile->size < 0 || pfile->offset + pfile->size > search->zip->length )
+		return false;
+
+	*handle = search->zip->handle;
+	*offset = pfile->offset;
+	*size = pfile->size;
+
+	return true;
+}
+
 /*
 ===========
 FS_Search_ZIP
@@ -692,6 +964,8 @@ searchpath_t *FS_AddZip_Fullpath( const char *zipfile, int flags )
 	search->pfnFindFile = FS_FindFile_ZIP;
 	search->pfnSearch = FS_Search_ZIP;
 	search->pfnLoadFile = FS_LoadZIPFile;
+	search->pfnGetFileName = FS_GetFileName_ZIP;
+	search->pfnGetFileRegion = FS_GetFileRegion_ZIP;
 
 	Con_Reportf( "Adding zipfile: %s (%i files)\n", zipfile, zip->numfiles );
 	return search;
@@ -13,11 +13,37 @@ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
 GNU General Public License for more details.
 */
 
+#include "build.h"
 #include "crclib.h"
 #include "crtlib.h"
 #include <string.h>
 #include <stdlib.h>
 
+#if defined( __GNUC__ ) && ( XASH_AMD64 || XASH_X86 )
+#define XASH_CRC32_PCLMUL 1
+#include <cpuid.h>
+#include <emmintrin.h>
+#include <wmmintrin.h>
+#endif
+
+#if defined( __GNUC__ ) && XASH_ARM == 8 && XASH_64BIT
+#if defined( __ARM_FEATURE_CRC32 )
+#define XASH_CRC32_ARMV8 1
+#define CRC32_ARMV8_TARGET
+#elif XASH_LINUX && ( defined( __clang__ ) || __GNUC__ >= 10 )
+#define XASH_CRC32_ARMV8 1
+#include <sys/auxv.h>
+#ifdef __clang__
+#define CRC32_ARMV8_TARGET __attribute__(( target( "crc" )))
+#else
+#define CRC32_ARMV8_TARGET __attribute__(( target( "+crc" )))
+#endif
+#endif
+#if XASH_CRC32_ARMV8
+#include <arm_acle.h>
+#endif
+#endif
+
 #define NUM_BYTES		256
 #define CRC32_INIT_VALUE	0xFFFFFFFFUL
 #define CRC32_XOR_VALUE	0xFFFFFFFFUL
@@ -107,47 +133,297 @@ void GAME_EXPORT CRC32_ProcessByte( uint32_t *pulCRC, byte ch )
 	*pulCRC = crc32table[((byte)ulCrc ^ ch)] ^ (ulCrc >> 8);
 }
 
-void GAME_EXPORT CRC32_ProcessBuffer( uint32_t *pulCRC, const void *pBuffer, int nBuffer )
+/*
+====================
+CRC32_ProcessTable
+
+one table lookup per byte, reference implementation
+====================
+*/
+static uint32_t CRC32_ProcessTable( uint32_t ulCrc, const byte *pb, size_t nBuffer )
 {
-	uint32_t	ulCrc = *pulCRC, tmp;
-	byte	*pb = (byte *)pBuffer;
+	while( nBuffer-- )
+		ulCrc = crc32table[((byte)ulCrc ^ *pb++)] ^ (ulCrc >> 8);
+
+	return ulCrc;
+}
+
+/*
+====================
+CRC32_ProcessSlice8
+
+eight table lookups per eight bytes without dependency between them
+====================
+*/
+static uint32_t crc32slice[8][NUM_BYTES];
+
+static uint32_t CRC32_ProcessSlice8( uint32_t ulCrc, const byte *pb, size_t nBuffer )
+{
+	uint32_t	one, two;
 
 	while( nBuffer >= sizeof( uint64_t ))
 	{
-		memcpy( &tmp, pb, sizeof( tmp ));
-		ulCrc ^= LittleLong( tmp );
-		ulCrc  = crc32table[(byte)ulCrc] ^ (ulCrc >> 8);
-		ulCrc  = crc32table[(byte)ulCrc] ^ (ulCrc >> 8);
-		ulCrc  = crc32table[(byte)ulCrc] ^ (ulCrc >> 8);
-		ulCrc  = crc32table[(byte)ulCrc] ^ (ulCrc >> 8);
-		memcpy( &tmp, pb + sizeof( tmp ), sizeof( tmp ));
-		ulCrc ^= LittleLong( tmp );
-		ulCrc  = crc32table[(byte)ulCrc] ^ (ulCrc >> 8);
-		ulCrc  = crc32table[(byte)ulCrc] ^ (ulCrc >> 8);
-		ulCrc  = crc32table[(byte)ulCrc] ^ (ulCrc >> 8);
-		ulCrc  = crc32table[(byte)ulCrc] ^ (ulCrc >> 8);
+		memcpy( &one, pb, sizeof( one ));
+		memcpy( &two, pb + sizeof( one ), sizeof( two ));
+		one = LittleLong( one ) ^ ulCrc;
+		two = LittleLong( two );
+
+		ulCrc = crc32slice[7][one & 0xFF] ^ crc32slice[6][(one >> 8) & 0xFF]
+			^ crc32slice[5][(one >> 16) & 0xFF] ^ crc32slice[4][one >> 24]
+			^ crc32slice[3][two & 0xFF] ^ crc32slice[2][(two >> 8) & 0xFF]
+			^ crc32slice[1][(two >> 16) & 0xFF] ^ crc32slice[0][two >> 24];
+
 		nBuffer -= sizeof( uint64_t );
 		pb += sizeof( uint64_t );
 	}
 
-	if( nBuffer & sizeof( uint32_t ))
+	return CRC32_ProcessTable( ulCrc, pb, nBuffer );
+}
+
+#if XASH_CRC32_PCLMUL
+/*
+====================
+CRC32_ProcessPCLMUL
+
+carry-less multiplication folding, see Intel's
+"Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction"
+====================
+*/
+static const uint64_t crc32_k1k2[2] __attribute__(( aligned( 16 ))) = { 0x0154442bd4, 0x01c6e41596 };
+static const uint64_t crc32_k3k4[2] __attribute__(( aligned( 16 ))) = { 0x01751997d0, 0x00ccaa009e };
+static const uint64_t crc32_k5k0[2] __attribute__(( aligned( 16 ))) = { 0x0163cd6124, 0x0000000000 };
+static const uint64_t crc32_poly[2] __attribute__(( aligned( 16 ))) = { 0x01db710641, 0x01f7011641 };
+
+#define CRC32_FOLD( x, k, y ) _mm_xor_si128( _mm_xor_si128( _mm_clmulepi64_si128( x, k, 0x11 ), _mm_clmulepi64_si128( x, k, 0x00 )), y )
+
+__attribute__(( target( "sse2,pclmul" )))
+static uint32_t CRC32_ProcessPCLMUL( uint32_t ulCrc, const byte *pb, size_t nBuffer )
+{
+	__m128i	x0, x1, x2, x3, x4, mask;
+
+	if( nBuffer < 64 )
+		return CRC32_ProcessSlice8( ulCrc, pb, nBuffer );
+
+	x1 = _mm_xor_si128( _mm_loadu_si128( (const __m128i *)( pb + 0x00 )), _mm_cvtsi32_si128( ulCrc ));
+	x2 = _mm_loadu_si128( (const __m128i *)( pb + 0x10 ));
+	x3 = _mm_loadu_si128( (const __m128i *)( pb + 0x20 ));
+	x4 = _mm_loadu_si128( (const __m128i *)( pb + 0x30 ));
+	pb += 64;
+	nBuffer -= 64;
+
+	// fold four 128-bit lanes in parallel
+	x0 = _mm_load_si128( (const __m128i *)crc32_k1k2 );
+
+	while( nBuffer >= 64 )
+	{
+		x1 = CRC32_FOLD( x1, x0, _mm_loadu_si128( (const __m128i *)( pb + 0x00 )));
+		x2 = CRC32_FOLD( x2, x0, _mm_loadu_si128( (const __m128i *)( pb + 0x10 )));
+		x3 = CRC32_FOLD( x3, x0, _mm_loadu_si128( (const __m128i *)( pb + 0x20 )));
+		x4 = CRC32_FOLD( x4, x0, _mm_loadu_si128( (const __m128i *)( pb + 0x30 )));
+		pb += 64;
+		nBuffer -= 64;
+	}
+
+	// fold lanes into one, then the rest of full blocks
+	x0 = _mm_load_si128( (const __m128i *)crc32_k3k4 );
+	x1 = CRC32_FOLD( x1, x0, x2 );
+	x1 = CRC32_FOLD( x1, x0, x3 );
+	x1 = CRC32_FOLD( x1, x0, x4 );
+
+	while( nBuffer >= 16 )
+	{
+		x1 = CRC32_FOLD( x1, x0, _mm_loadu_si128( (const __m128i *)pb ));
+		pb += 16;
+		nBuffer -= 16;
+	}
+
+	// 128 bits to 64 bits
+	mask = _mm_setr_epi32( ~0, 0, ~0, 0 );
+	x2 = _mm_clmulepi64_si128( x1, x0, 0x10 );
+	x1 = _mm_xor_si128( _mm_srli_si128( x1, 8 ), x2 );
+
+	x0 = _mm_loadl_epi64( (const __m128i *)crc32_k5k0 );
+	x2 = _mm_srli_si128( x1, 4 );
+	x1 = _mm_and_si128( x1, mask );
+	x1 = _mm_xor_si128( _mm_clmulepi64_si128( x1, x0, 0x00 ), x2 );
+
+	// Barrett reduction to 32 bits
+	x0 = _mm_load_si128( (const __m128i *)crc32_poly );
+	x2 = _mm_and_si128( x1, mask );
+	x2 = _mm_clmulepi64_si128( x2, x0, 0x10 );
+	x2 = _mm_and_si128( x2, mask );
+	x2 = _mm_clmulepi64_si128( x2, x0, 0x00 );
+	x1 = _mm_xor_si128( x1, x2 );
+
+	ulCrc = _mm_cvtsi128_si32( _mm_srli_si128( x1, 4 ));
+
+	return CRC32_ProcessSlice8( ulCrc, pb, nBuffer );
+}
+
+#undef CRC32_FOLD
+
+static qboolean CRC32_HavePCLMUL( void )
+{
+	unsigned int eax, ebx, ecx, edx;
+
+	if( !__get_cpuid( 1, &eax, &ebx, &ecx, &edx ))
+		return false;
+
+	return FBitSet( ecx, BIT( 1 )) && FBitSet( edx, BIT( 26 )); // PCLMULQDQ and SSE2
+}
+#endif // XASH_CRC32_PCLMUL
+
+#if XASH_CRC32_ARMV8
+/*
+====================
+CRC32_ProcessARMv8
+
+ARMv8 CRC32 extension implements the same polynomial
+====================
+*/
+CRC32_ARMV8_TARGET
+static uint32_t CRC32_ProcessARMv8( uint32_t ulCrc, const byte *pb, size_t nBuffer )
+{
+	uint64_t	tmp;
+
+	while( nBuffer >= sizeof( uint64_t ))
 	{
 		memcpy( &tmp, pb, sizeof( tmp ));
-		ulCrc ^= LittleLong( tmp );
-		ulCrc  = crc32table[(byte)ulCrc] ^ (ulCrc >> 8);
-		ulCrc  = crc32table[(byte)ulCrc] ^ (ulCrc >> 8);
-		ulCrc  = crc32table[(byte)ulCrc] ^ (ulCrc >> 8);
-		ulCrc  = crc32table[(byte)ulCrc] ^ (ulCrc >> 8);
-		nBuffer -= sizeof( uint32_t );
-		pb += sizeof( uint32_t );
+		ulCrc = __crc32d( ulCrc, tmp );
+		nBuffer -= sizeof( uint64_t );
+		pb += sizeof( uint64_t );
 	}
 
 	while( nBuffer-- )
+		ulCrc = __crc32b( ulCrc, *pb++ );
+
+	return ulCrc;
+}
+
+static qboolean CRC32_HaveARMv8( void )
+{
+#if defined( __ARM_FEATURE_CRC32 )
+	return true;
+#else
+	return FBitSet( getauxval( AT_HWCAP ), BIT( 7 )); // HWCAP_CRC32
+#endif
+}
+#endif // XASH_CRC32_ARMV8
+
+static const struct
+{
+	const char *name;
+	uint32_t (*process)( uint32_t ulCrc, const byte *pb, size_t nBuffer );
+} crc32backends[CRC32_BACKEND_COUNT] =
+{
+	{ "table", CRC32_ProcessTable },
+	{ "slice8", CRC32_ProcessSlice8 },
+#if XASH_CRC32_PCLMUL
+	{ "pclmul", CRC32_ProcessPCLMUL },
+#else
+	{ "pclmul", NULL },
+#endif
+#if XASH_CRC32_ARMV8
+	{ "armv8", CRC32_ProcessARMv8 },
+#else
+	{ "armv8", NULL },
+#endif
+};
+
+static uint32_t (*crc32process)( uint32_t ulCrc, const byte *pb, size_t nBuffer );
+
+static void CRC32_InitSlices( void )
+{
+	int	i, j;
+
+	if( crc32slice[0][1] )
+		return;
+
+	for( i = 0; i < NUM_BYTES; i++ )
+		crc32slice[0][i] = crc32table[i];
+
+	for( j = 1; j < 8; j++ )
+	{
+		for( i = 0; i < NUM_BYTES; i++ )
+			crc32slice[j][i] = ( crc32slice[j - 1][i] >> 8 ) ^ crc32table[(byte)crc32slice[j - 1][i]];
+	}
+}
+
+/*
+====================
+CRC32_BackendSupported
+====================
+*/
+qboolean CRC32_BackendSupported( int backend )
+{
+	if( backend < 0 || backend >= CRC32_BACKEND_COUNT || !crc32backends[backend].process )
+		return false;
+
+#if XASH_CRC32_PCLMUL
+	if( backend == CRC32_BACKEND_PCLMUL )
+		return CRC32_HavePCLMUL();
+#endif
+
+#if XASH_CRC32_ARMV8
+	if( backend == CRC32_BACKEND_ARMV8 )
+		return CRC32_HaveARMv8();
+#endif
+
+	return true;
+}
+
+/*
+====================
+CRC32_BackendName
+====================
+*/
+const char *CRC32_BackendName( int backend )
+{
+	if( backend < 0 || backend >= CRC32_BACKEND_COUNT )
+		return "unknown";
+
+	return crc32backends[backend].name;
+}
+
+/*
+====================
+CRC32_SetBackend
+
+pass -1 to pick the fastest one supported by this CPU,
+tables are built here, so modules that hash on several
+threads must call it before they start any of them
+====================
+*/
+int CRC32_SetBackend( int backend )
+{
+	// fallback of every other backend
+	CRC32_InitSlices();
+
+	if( backend < 0 )
 	{
-		ulCrc  = crc32table[((byte)ulCrc ^ *pb++)] ^ (ulCrc >> 8);
+		for( backend = CRC32_BACKEND_COUNT - 1; backend > CRC32_BACKEND_SLICE8; backend-- )
+		{
+			if( CRC32_BackendSupported( backend ))
+				break;
+		}
 	}
+	else if( !CRC32_BackendSupported( backend ))
+		return -1;
+
+	crc32process = crc32backends[backend].process;
+	return backend;
+}
+
+void GAME_EXPORT CRC32_ProcessBuffer( uint32_t *pulCRC, const void *pBuffer, int nBuffer )
+{
+	if( nBuffer <= 0 )
+		return;
+
+	// single threaded users may skip CRC32_SetBackend
+	if( !crc32process )
+		CRC32_SetBackend( -1 );
 
-	*pulCRC = ulCrc;
+	*pulCRC = crc32process( *pulCRC, pBuffer, nBuffer );
 }
 
 /*
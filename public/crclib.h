@@ -26,11 +26,23 @@ typedef struct
 	uint	in[16];
 } MD5Context_t;
 
+enum
+{
+	CRC32_BACKEND_TABLE = 0,
+	CRC32_BACKEND_SLICE8,
+	CRC32_BACKEND_PCLMUL,
+	CRC32_BACKEND_ARMV8,
+	CRC32_BACKEND_COUNT
+};
+
 void CRC32_Init( uint32_t *pulCRC );
 byte CRC32_BlockSequence( byte *base, int length, int sequence );
 void CRC32_ProcessBuffer( uint32_t *pulCRC, const void *pBuffer, int nBuffer );
 void CRC32_ProcessByte( uint32_t *pulCRC, byte ch );
 uint32_t CRC32_Final( uint32_t pulCRC );
+qboolean CRC32_BackendSupported( int backend );
+const char *CRC32_BackendName( int backend );
+int CRC32_SetBackend( int backend );
 void MD5Init( MD5Context_t *ctx );
 void MD5Update( MD5Context_t *ctx, const byte *buf, uint len );
 void MD5Final( byte digest[16], MD5Context_t *ctx );
@@ -0,0 +1,125 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include "crtlib.h"
+#include "crclib.h"
+
+#define BUFFER_SIZE ( 8 * 1024 * 1024 )
+#define BENCH_PASSES 8
+
+static uint32_t CRC32_Reference( const byte *data, int size )
+{
+	uint32_t crc;
+	int i;
+
+	CRC32_Init( &crc );
+	for( i = 0; i < size; i++ )
+		CRC32_ProcessByte( &crc, data[i] );
+
+	return CRC32_Final( crc );
+}
+
+static uint32_t CRC32_Buffer( const byte *data, int size )
+{
+	uint32_t crc;
+
+	CRC32_Init( &crc );
+	CRC32_ProcessBuffer( &crc, data, size );
+
+	return CRC32_Final( crc );
+}
+
+static int Test_Backend( int backend, const byte *data )
+{
+	uint32_t crc;
+	int ofs, len, split;
+
+	// check value from the CRC catalogue
+	if( CRC32_Buffer( (const byte *)"123456789", 9 ) != 0xCBF43926 )
+	{
+		printf( "%s: check value mismatch\n", CRC32_BackendName( backend ));
+		return 1;
+	}
+
+	// every tail length with every misalignment
+	for( ofs = 0; ofs < 16; ofs++ )
+	{
+		for( len = 0; len < 1100; len++ )
+		{
+			if( CRC32_Buffer( data + ofs, len ) != CRC32_Reference( data + ofs, len ))
+			{
+				printf( "%s: mismatch at offset %d length %d\n", CRC32_BackendName( backend ), ofs, len );
+				return 2;
+			}
+		}
+	}
+
+	// processing in pieces must give the same result
+	for( split = 1; split < 200; split += 13 )
+	{
+		CRC32_Init( &crc );
+		CRC32_ProcessBuffer( &crc, data + 3, split );
+		CRC32_ProcessBuffer( &crc, data + 3 + split, 65536 - split );
+
+		if( CRC32_Final( crc ) != CRC32_Reference( data + 3, 65536 ))
+		{
+			printf( "%s: split at %d mismatch\n", CRC32_BackendName( backend ), split );
+			return 3;
+		}
+	}
+
+	if( CRC32_Buffer( data, BUFFER_SIZE ) != CRC32_Reference( data, BUFFER_SIZE ))
+	{
+		printf( "%s: large buffer mismatch\n", CRC32_BackendName( backend ));
+		return 4;
+	}
+
+	return 0;
+}
+
+static void Bench_Backend( int backend, const byte *data )
+{
+	volatile uint32_t sink = 0;
+	clock_t start = clock();
+	double seconds;
+	int i;
+
+	for( i = 0; i < BENCH_PASSES; i++ )
+		sink ^= CRC32_Buffer( data, BUFFER_SIZE );
+
+	seconds = (double)( clock() - start ) / CLOCKS_PER_SEC;
+
+	if( seconds > 0 )
+		printf( "%8s: %8.1f MiB/s\n", CRC32_BackendName( backend ), ( BUFFER_SIZE / 1048576.0 * BENCH_PASSES ) / seconds );
+}
+
+int main( void )
+{
+	byte *data = malloc( BUFFER_SIZE );
+	int i, best;
+
+	for( i = 0; i < BUFFER_SIZE; i++ )
+		data[i] = ( i * 2654435761u ) >> 24;
+
+	best = CRC32_SetBackend( -1 );
+	printf( "default backend: %s\n", CRC32_BackendName( best ));
+
+	for( i = 0; i < CRC32_BACKEND_COUNT; i++ )
+	{
+		if( CRC32_SetBackend( i ) < 0 )
+		{
+			printf( "%8s: not supported\n", CRC32_BackendName( i ));
+			continue;
+		}
+
+		if( Test_Backend( i, data ))
+			return EXIT_FAILURE;
+
+		Bench_Backend( i, data );
+	}
+
+	CRC32_SetBackend( best );
+	free( data );
+
+	return EXIT_SUCCESS;
+}